@@ -2,10 +2,19 @@
 
 #include <utility>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstring>
 #include <functional>
+#include <limits>
+#include <type_traits>
+#include <vector>
 #include "utility.h"
 
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+
 namespace str2d
 { 
 
@@ -34,6 +43,45 @@ struct find_adaptor_binary
 	}
 };
 
+// Probes "first + 1", "first + 2", "first + 4", ... until one doesn't satisfy "p", and then searches binary
+// between the last two probes; cost is logarithmic in the distance of the partition point from "first".
+struct find_adaptor_galloping
+{
+	template<typename I, typename Pred>
+	// I models RandomAccessIterator
+	// Pred models UnaryPredicate
+	// IteratorValueType<I> == Domain<Pred>
+	I operator()(I first, I last, Pred p) const {
+		IteratorDifferenceType<I> n = std::distance(first, last);
+		IteratorDifferenceType<I> lo = 0;
+		IteratorDifferenceType<I> step = 1;
+		while (step <= n && p(*std::next(first, step - 1))) {
+			lo = step;
+			step = step << 1;
+		}
+		return std::partition_point(std::next(first, lo), std::next(first, std::min(step - 1, n)), p);
+	}
+};
+
+// Same as "find_adaptor_galloping", but probes "last - 1", "last - 2", "last - 4", ... until one satisfies "p"
+struct find_adaptor_galloping_backward
+{
+	template<typename I, typename Pred>
+	// I models RandomAccessIterator
+	// Pred models UnaryPredicate
+	// IteratorValueType<I> == Domain<Pred>
+	I operator()(I first, I last, Pred p) const {
+		IteratorDifferenceType<I> n = std::distance(first, last);
+		IteratorDifferenceType<I> hi = n;
+		IteratorDifferenceType<I> step = 1;
+		while (step <= n && !p(*std::next(first, n - step))) {
+			hi = n - step;
+			step = step << 1;
+		}
+		return std::partition_point(std::next(first, step <= n ? n - step + 1 : 0), std::next(first, hi), p);
+	}
+};
+
 struct equal_range_adaptor_linear
 {
 	template<typename I, typename Cmp>
@@ -58,6 +106,467 @@ struct equal_range_adaptor_binary
 };
 
 
+// Whether "Cmp" orders keys as "std::less"; comparison adaptors which forward keys unchanged
+// name the comparison they forward to as "forwarded_compare"
+template<typename Cmp, typename = void>
+struct is_less_compare : std::false_type {};
+
+template<typename T>
+struct is_less_compare<std::less<T>, void> : std::true_type {};
+
+template<typename Cmp>
+struct is_less_compare<Cmp, std::void_t<typename Cmp::forwarded_compare>> : is_less_compare<typename Cmp::forwarded_compare> {};
+
+// Key and kind of a bound predicate over arithmetic keys ordered by "std::less";
+// "upper" is true if the predicate is "y <= x" and false if it's "y < x"
+template<typename P, typename = void>
+struct arithmetic_bound
+{
+	static constexpr bool value = false;
+};
+
+template<typename T, typename Cmp>
+struct arithmetic_bound<lower_bound_predicate<T, Cmp>, void>
+{
+	using key_type = T;
+	static constexpr bool value = is_less_compare<Cmp>::value && std::is_arithmetic_v<T>;
+	static constexpr bool upper = false;
+	static const T& key(const lower_bound_predicate<T, Cmp>& p) { return *p.x; }
+};
+
+template<typename T, typename Cmp>
+struct arithmetic_bound<upper_bound_predicate<T, Cmp>, void>
+{
+	using key_type = T;
+	static constexpr bool value = is_less_compare<Cmp>::value && std::is_arithmetic_v<T>;
+	static constexpr bool upper = true;
+	static const T& key(const upper_bound_predicate<T, Cmp>& p) { return *p.x; }
+};
+
+// Value to key projections which return the value itself
+template<typename P, typename VK>
+struct arithmetic_bound<value_key_predicate<P, VK>, std::enable_if_t<
+	arithmetic_bound<P>::value &&
+	std::is_same_v<decltype(VK::get(std::declval<const typename arithmetic_bound<P>::key_type&>())), const typename arithmetic_bound<P>::key_type&>>>
+	: arithmetic_bound<P>
+{
+	static const typename arithmetic_bound<P>::key_type& key(const value_key_predicate<P, VK>& p) { return arithmetic_bound<P>::key(p.p); }
+};
+
+// SIMD adaptors search arrays of integral(32 or 64 bit) or floating keys which are ordered by "std::less".
+// Range is first narrowed by a binary search without branches down to "simd_window_bytes", and then
+// the keys of the window which come before the partition point are counted with AVX2 or SSE4.2 comparisons.
+// Without either of them, or for any other keys or orderings, they fall back to a binary search.
+
+constexpr std::size_t simd_window_bytes = 256;
+
+template<typename T>
+struct is_simd_key : std::bool_constant<
+	(std::is_integral_v<T> && !std::is_same_v<T, bool> && (sizeof(T) == 4 || sizeof(T) == 8)) ||
+	std::is_same_v<T, float> || std::is_same_v<T, double>> {};
+
+// Number of the first "n" keys starting at "f" which are smaller than "x", or not greater if "U" is true.
+// Integral keys are compared as signed ones, after their bits are xor-ed with "bias".
+template<bool U, typename T>
+// T models SignedIntegral
+inline
+std::size_t simd_count_signed(const T* f, std::size_t n, T x, T bias) {
+	std::size_t i = 0;
+	std::size_t c = 0;
+	T _x = static_cast<T>(x ^ bias);
+#if defined(__AVX2__)
+	if constexpr (sizeof(T) == 8) {
+		__m256i b = _mm256_set1_epi64x(bias);
+		__m256i xv = _mm256_set1_epi64x(_x);
+		for (; i + 4 <= n; i = i + 4) {
+			__m256i y = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(f + i)), b);
+			__m256i m = U ? _mm256_cmpgt_epi64(y, xv) : _mm256_cmpgt_epi64(xv, y);
+			c = c + popcount(static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(m))));
+		}
+	}
+	else {
+		__m256i b = _mm256_set1_epi32(bias);
+		__m256i xv = _mm256_set1_epi32(_x);
+		for (; i + 8 <= n; i = i + 8) {
+			__m256i y = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(f + i)), b);
+			__m256i m = U ? _mm256_cmpgt_epi32(y, xv) : _mm256_cmpgt_epi32(xv, y);
+			c = c + popcount(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(m))));
+		}
+	}
+#elif defined(__SSE4_2__)
+	if constexpr (sizeof(T) == 8) {
+		__m128i b = _mm_set1_epi64x(bias);
+		__m128i xv = _mm_set1_epi64x(_x);
+		for (; i + 2 <= n; i = i + 2) {
+			__m128i y = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(f + i)), b);
+			__m128i m = U ? _mm_cmpgt_epi64(y, xv) : _mm_cmpgt_epi64(xv, y);
+			c = c + popcount(static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(m))));
+		}
+	}
+	else {
+		__m128i b = _mm_set1_epi32(bias);
+		__m128i xv = _mm_set1_epi32(_x);
+		for (; i + 4 <= n; i = i + 4) {
+			__m128i y = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(f + i)), b);
+			__m128i m = U ? _mm_cmpgt_epi32(y, xv) : _mm_cmpgt_epi32(xv, y);
+			c = c + popcount(static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(m))));
+		}
+	}
+#endif
+	for (; i < n; ++i) {
+		T y = static_cast<T>(f[i] ^ bias);
+		c = c + static_cast<std::size_t>(U ? _x < y : y < _x);
+	}
+	// for "U" the keys greater than "x" were counted
+	return U ? n - c : c;
+}
+
+template<bool U>
+inline
+std::size_t simd_count(const float* f, std::size_t n, float x) {
+	std::size_t i = 0;
+	std::size_t c = 0;
+#if defined(__AVX2__)
+	__m256 xv = _mm256_set1_ps(x);
+	for (; i + 8 <= n; i = i + 8) {
+		__m256 m = _mm256_cmp_ps(_mm256_loadu_ps(f + i), xv, U ? _CMP_LE_OQ : _CMP_LT_OQ);
+		c = c + popcount(static_cast<unsigned>(_mm256_movemask_ps(m)));
+	}
+#elif defined(__SSE4_2__)
+	__m128 xv = _mm_set1_ps(x);
+	for (; i + 4 <= n; i = i + 4) {
+		__m128 y = _mm_loadu_ps(f + i);
+		__m128 m = U ? _mm_cmple_ps(y, xv) : _mm_cmplt_ps(y, xv);
+		c = c + popcount(static_cast<unsigned>(_mm_movemask_ps(m)));
+	}
+#endif
+	for (; i < n; ++i) c = c + static_cast<std::size_t>(U ? !(x < f[i]) : f[i] < x);
+	return c;
+}
+
+template<bool U>
+inline
+std::size_t simd_count(const double* f, std::size_t n, double x) {
+	std::size_t i = 0;
+	std::size_t c = 0;
+#if defined(__AVX2__)
+	__m256d xv = _mm256_set1_pd(x);
+	for (; i + 4 <= n; i = i + 4) {
+		__m256d m = _mm256_cmp_pd(_mm256_loadu_pd(f + i), xv, U ? _CMP_LE_OQ : _CMP_LT_OQ);
+		c = c + popcount(static_cast<unsigned>(_mm256_movemask_pd(m)));
+	}
+#elif defined(__SSE4_2__)
+	__m128d xv = _mm_set1_pd(x);
+	for (; i + 2 <= n; i = i + 2) {
+		__m128d y = _mm_loadu_pd(f + i);
+		__m128d m = U ? _mm_cmple_pd(y, xv) : _mm_cmplt_pd(y, xv);
+		c = c + popcount(static_cast<unsigned>(_mm_movemask_pd(m)));
+	}
+#endif
+	for (; i < n; ++i) c = c + static_cast<std::size_t>(U ? !(x < f[i]) : f[i] < x);
+	return c;
+}
+
+template<bool U, typename T>
+// T models Integral
+inline
+std::size_t simd_count(const T* f, std::size_t n, T x) {
+	using S = std::make_signed_t<T>;
+	// unsigned keys keep their order as signed ones once their highest bit is flipped
+	S bias = std::is_signed_v<T> ? S(0) : std::numeric_limits<S>::min();
+	return simd_count_signed<U>(reinterpret_cast<const S*>(f), n, static_cast<S>(x), bias);
+}
+
+// Partition point of "y < x", or of "y <= x" if "U" is true, over the sorted range [first, last)
+template<bool U, typename T>
+// is_simd_key<T>::value
+inline
+T* simd_partition_point(T* first, T* last, const std::remove_const_t<T>& x) {
+	constexpr std::size_t window = simd_window_bytes / sizeof(T);
+	std::size_t n = static_cast<std::size_t>(last - first);
+	while (n > window) {
+		std::size_t h = n >> 1;
+		// partition point is in [first, first + n]
+		bool before = U ? !(x < first[h]) : first[h] < x;
+		first = before ? first + (n - h) : first;
+		n = h;
+	}
+	return first + simd_count<U>(static_cast<const std::remove_const_t<T>*>(first), n, x);
+}
+
+struct find_adaptor_simd
+{
+	template<typename I, typename Pred>
+	// I models ForwardIterator
+	// Pred models UnaryPredicate
+	// IteratorValueType<I> == Domain<Pred>
+	I operator()(I first, I last, Pred p) const {
+		if constexpr (arithmetic_bound<Pred>::value && std::is_pointer_v<I>) {
+			using K = typename arithmetic_bound<Pred>::key_type;
+			if constexpr (is_simd_key<K>::value && std::is_same_v<IteratorValueType<I>, K>)
+				return simd_partition_point<arithmetic_bound<Pred>::upper>(first, last, arithmetic_bound<Pred>::key(p));
+			else return std::partition_point(first, last, p);
+		}
+		else return std::partition_point(first, last, p);
+	}
+};
+
+struct equal_range_adaptor_simd
+{
+	template<typename I, typename Cmp>
+	// I models ForwardIterator
+	// Cmp models StrictWeakOrdering
+	// IteratorValueType<I> == Domain<Cmp>
+	std::pair<I, I> operator()(I first, I last, const IteratorValueType<I>& x, Cmp cmp) const {
+		if constexpr (is_less_compare<Cmp>::value && is_simd_key<IteratorValueType<I>>::value && std::is_pointer_v<I>) {
+			I lower_bound = simd_partition_point<false>(first, last, x);
+			return { lower_bound, simd_partition_point<true>(lower_bound, last, x) };
+		}
+		else return std::equal_range(first, last, x, cmp);
+	}
+};
+
+
+// Interpolation adaptors search arrays of arithmetic keys ordered by "std::less", which are expected to be
+// close to uniformly distributed. Every probe is placed where the key would be if the keys between the ends
+// of the range were evenly spaced. Once a probe doesn't at least halve the range the keys are taken to be
+// skewed, and the rest of the search is binary.
+// Last "interpolation_sequential_size" keys are searched linearly.
+// For any other keys or orderings they fall back to a binary search.
+// "find_adaptor_interpolation" is used for the search over segments by "seg::partition_point" as well.
+
+constexpr std::size_t interpolation_sequential_size = 8;
+
+// Position among "n" evenly spaced keys, from "a" to "b", of the key "x"
+inline
+std::size_t interpolation_index(double x, double a, double b, std::size_t n) {
+	// precondition: n != 0
+	if (!(a < b)) return n >> 1;
+	double i = (x - a) / (b - a) * static_cast<double>(n - 1);
+	if (!(i > 0.0)) return 0;
+	if (i >= static_cast<double>(n - 1)) return n - 1;
+	return static_cast<std::size_t>(i);
+}
+
+// Partition point of "y < x", or of "y <= x" if "U" is true, over the sorted range [first, last)
+template<bool U, typename I>
+// I models RandomAccessIterator
+// std::is_arithmetic_v<IteratorValueType<I>>
+inline
+I interpolation_partition_point(I first, I last, const IteratorValueType<I>& x) {
+	auto before = [&x](const IteratorValueType<I>& y) { return U ? !(x < y) : y < x; };
+	std::size_t n = static_cast<std::size_t>(last - first);
+	double _x = static_cast<double>(x);
+	bool interpolate = true;
+	while (n > interpolation_sequential_size) {
+		// partition point is in [first, first + n]
+		std::size_t h = interpolate ?
+			interpolation_index(_x, static_cast<double>(first[0]), static_cast<double>(first[n - 1]), n) :
+			n >> 1;
+		std::size_t _n = n;
+		if (before(first[h])) {
+			first = first + (h + 1);
+			n = n - (h + 1);
+		}
+		else n = h;
+		interpolate = interpolate && n <= (_n >> 1);
+	}
+	return std::find_if_not(first, first + n, before);
+}
+
+struct find_adaptor_interpolation
+{
+	template<typename I, typename Pred>
+	// I models ForwardIterator
+	// Pred models UnaryPredicate
+	// IteratorValueType<I> == Domain<Pred>
+	I operator()(I first, I last, Pred p) const {
+		if constexpr (arithmetic_bound<Pred>::value && std::is_pointer_v<I>) {
+			if constexpr (std::is_same_v<IteratorValueType<I>, typename arithmetic_bound<Pred>::key_type>)
+				return interpolation_partition_point<arithmetic_bound<Pred>::upper>(first, last, arithmetic_bound<Pred>::key(p));
+			else return std::partition_point(first, last, p);
+		}
+		else return std::partition_point(first, last, p);
+	}
+};
+
+struct equal_range_adaptor_interpolation
+{
+	template<typename I, typename Cmp>
+	// I models ForwardIterator
+	// Cmp models StrictWeakOrdering
+	// IteratorValueType<I> == Domain<Cmp>
+	std::pair<I, I> operator()(I first, I last, const IteratorValueType<I>& x, Cmp cmp) const {
+		if constexpr (is_less_compare<Cmp>::value && std::is_arithmetic_v<IteratorValueType<I>> && std::is_pointer_v<I>) {
+			I lower_bound = interpolation_partition_point<false>(first, last, x);
+			return { lower_bound, interpolation_partition_point<true>(lower_bound, last, x) };
+		}
+		else return std::equal_range(first, last, x, cmp);
+	}
+};
+
+// Whether "Proc" searches for the partition point of "Pred" over segments by interpolation
+template<typename Proc, typename Pred>
+struct interpolates_segments : std::bool_constant<
+	std::is_same_v<Proc, find_adaptor_interpolation> && arithmetic_bound<Pred>::value> {};
+
+
+// Segment search policy for find adaptors and equal range adaptors; "seg::partition_point" and "seg::equal_range"
+// given "branchless_segments<F>" search over segments without branches and with prefetching
+// (see "seg::partition_point_segments_branchless"), and "F" searches inside the located segment.
+template<typename F = find_adaptor_binary>
+struct branchless_segments : F {};
+
+template<typename Proc>
+struct searches_segments_branchless : std::false_type {};
+
+template<typename F>
+struct searches_segments_branchless<branchless_segments<F>> : std::true_type {};
+
+
+// Adaptive adaptors search ranges of at most "adaptive_crossover<T>()" keys linearly, and longer ones by
+// a binary search. For arithmetic keys the crossover is "adaptive_arithmetic_crossover" until "calibrate" measures
+// it on the machine the program runs on, by timing both searches over sorted arrays of growing sizes. Lookups never
+// calibrate by themselves, so the program decides when the measurement(some 10 milliseconds per key type) is paid.
+// Comparisons of other keys are taken to be more expensive, and their crossover is "adaptive_default_crossover".
+// Keys are those of the bound predicates(see "arithmetic_bound"), or the values of the range otherwise.
+
+constexpr std::size_t adaptive_default_crossover = 8;
+constexpr std::size_t adaptive_arithmetic_crossover = 32;
+// Largest buffer the searched arrays are spread over while calibrating(4 MB)
+constexpr std::size_t adaptive_calibration_bytes = std::size_t(1) << 22;
+
+template<typename T>
+// T models Arithmetic
+inline std::atomic<std::size_t> adaptive_crossover_value{ adaptive_arithmetic_crossover };
+
+template<typename T>
+// T models Arithmetic
+std::size_t calibrate_adaptive_crossover(std::size_t buffer_bytes = adaptive_calibration_bytes) {
+	constexpr std::size_t max_size = 2048;
+	constexpr std::size_t nm_queries = 1024;
+	constexpr int nm_rounds = 3;
+	std::size_t _max_size = max_size;
+	if constexpr (std::is_integral_v<T>) {
+		if (static_cast<std::uintmax_t>(std::numeric_limits<T>::max()) < max_size)
+			_max_size = static_cast<std::size_t>(std::numeric_limits<T>::max());
+	}
+
+	// searched ranges are spread over more memory than the inner caches hold, as segments found by lookups usually aren't cached;
+	// buffer is made of ascending runs of "_max_size" keys
+	std::vector<T> keys(std::max(std::min(buffer_bytes, adaptive_calibration_bytes) / sizeof(T), _max_size));
+	for (std::size_t i = 0; i < keys.size(); ++i) keys[i] = static_cast<T>(i % _max_size);
+	std::size_t nm_runs = keys.size() / _max_size;
+	std::vector<std::pair<const T*, T>> queries(nm_queries);
+	std::uint32_t r = 1;
+	auto next = [&r]() {
+		r = r * 1664525u + 1013904223u;
+		return static_cast<std::size_t>(r >> 8);
+	};
+	volatile std::size_t sink = 0;
+
+	// Fastest of "nm_rounds" runs of "search" over all queries
+	auto time = [&](std::size_t n, auto search) {
+		auto best = std::chrono::steady_clock::duration::max();
+		for (int i = 0; i < nm_rounds; ++i) {
+			auto start = std::chrono::steady_clock::now();
+			std::size_t s = 0;
+			for (const auto& q : queries) s = s + search(q.first, q.first + n, q.second);
+			best = std::min(best, std::chrono::steady_clock::now() - start);
+			sink = sink + s;
+		}
+		return best;
+	};
+	auto linear = [](const T* first, const T* last, const T& x) {
+		return static_cast<std::size_t>(std::find_if_not(first, last, [&x](const T& y) { return y < x; }) - first);
+	};
+	auto binary = [](const T* first, const T* last, const T& x) {
+		return static_cast<std::size_t>(std::partition_point(first, last, [&x](const T& y) { return y < x; }) - first);
+	};
+
+	// a single size where the binary search wins may be noise, so sizes are measured until it wins twice in a row
+	std::size_t crossover = 0;
+	int losses = 0;
+	for (std::size_t n = 4; n <= _max_size && losses < 2; n = n << 1) {
+		for (auto& q : queries) {
+			q.first = keys.data() + (next() % nm_runs) * _max_size;
+			q.second = static_cast<T>(next() % n);
+		}
+		if (time(n, binary) < time(n, linear)) ++losses;
+		else {
+			crossover = n;
+			losses = 0;
+		}
+	}
+	return crossover;
+}
+
+template<typename T>
+inline
+std::size_t adaptive_crossover() {
+	if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>) return adaptive_crossover_value<T>.load(std::memory_order_relaxed);
+	else return adaptive_default_crossover;
+}
+
+// Measures the crossovers of the key types "Ts", or of all arithmetic types if none are given.
+// Lookups running at the same time keep using either the old or the new crossover.
+template<typename... Ts>
+void calibrate() {
+	if constexpr (sizeof...(Ts) == 0) {
+		calibrate<
+			char, signed char, unsigned char, short, unsigned short, int, unsigned int, long, unsigned long,
+			long long, unsigned long long, float, double, long double>();
+	}
+	else {
+		static_assert((std::is_arithmetic_v<Ts> && ...), "Only crossovers of arithmetic keys are measured");
+		(adaptive_crossover_value<Ts>.store(calibrate_adaptive_crossover<Ts>(), std::memory_order_relaxed), ...);
+	}
+}
+
+template<typename I, typename Pred, typename = void>
+struct adaptive_key
+{
+	using type = IteratorValueType<I>;
+};
+
+template<typename I, typename Pred>
+struct adaptive_key<I, Pred, std::enable_if_t<arithmetic_bound<Pred>::value>>
+{
+	using type = typename arithmetic_bound<Pred>::key_type;
+};
+
+struct find_adaptor_adaptive
+{
+	template<typename I, typename Pred>
+	// I models ForwardIterator
+	// Pred models UnaryPredicate
+	// IteratorValueType<I> == Domain<Pred>
+	I operator()(I first, I last, Pred p) const {
+		if constexpr (std::is_base_of_v<std::random_access_iterator_tag, IteratorCategory<I>>) {
+			if (static_cast<std::size_t>(last - first) <= adaptive_crossover<typename adaptive_key<I, Pred>::type>())
+				return std::find_if_not(first, last, p);
+		}
+		return std::partition_point(first, last, p);
+	}
+};
+
+struct equal_range_adaptor_adaptive
+{
+	template<typename I, typename Cmp>
+	// I models ForwardIterator
+	// Cmp models StrictWeakOrdering
+	// IteratorValueType<I> == Domain<Cmp>
+	std::pair<I, I> operator()(I first, I last, const IteratorValueType<I>& x, Cmp cmp) const {
+		using K = typename adaptive_key<I, lower_bound_predicate<IteratorValueType<I>, Cmp>>::type;
+		if constexpr (std::is_base_of_v<std::random_access_iterator_tag, IteratorCategory<I>>) {
+			if (static_cast<std::size_t>(last - first) <= adaptive_crossover<K>())
+				return equal_range_adaptor_linear()(first, last, x, cmp);
+		}
+		return std::equal_range(first, last, x, cmp);
+	}
+};
+
+
 template<typename T, typename N>
 // T models TriviallyCopyable
 // N models Integer
@@ -689,6 +1198,52 @@ bool equal(I0 first0, I0 last0, I1 first1) {
 	return flat::equal(first0, last0, first1, std::equal_to<>());
 }
 
+// Maps an integral key to an unsigned one of the same width, so that the order of the keys is kept
+template<typename T>
+// T models Integral
+inline
+std::make_unsigned_t<T> radix_key(T x) {
+	using U = std::make_unsigned_t<T>;
+	if constexpr (std::is_signed_v<T>) return static_cast<U>(x) ^ (U(1) << (std::numeric_limits<U>::digits - 1));
+	else return static_cast<U>(x);
+}
+
+// Stable least significant digit radix sort of [first, last) by "key", a byte at a time. [buffer, buffer + (last - first))
+// is used as the scratch space. Counts of all bytes are taken in one pass, and bytes which are the same in all keys are skipped.
+template<typename T, typename K>
+// T models Movable
+// K models UnaryFunction
+// Domain<K> == T
+// Codomain<K> models UnsignedIntegral
+void radix_sort(T* first, T* last, T* buffer, K key) {
+	using U = decltype(key(*first));
+	constexpr std::size_t digits = sizeof(U);
+	std::size_t n = static_cast<std::size_t>(last - first);
+	if (n < 2) return;
+
+	std::vector<std::size_t> counts(digits * 256, 0);
+	for (T* it = first; it != last; ++it) {
+		U k = key(*it);
+		for (std::size_t d = 0; d < digits; ++d) ++counts[d * 256 + ((k >> (8 * d)) & 0xff)];
+	}
+
+	T* src = first;
+	T* dst = buffer;
+	for (std::size_t d = 0; d < digits; ++d) {
+		std::size_t* c = counts.data() + d * 256;
+		if (c[(key(*first) >> (8 * d)) & 0xff] == n) continue;
+		std::size_t sum = 0;
+		for (std::size_t i = 0; i < 256; ++i) {
+			std::size_t t = c[i];
+			c[i] = sum;
+			sum = sum + t;
+		}
+		for (T* it = src; it != src + n; ++it) dst[c[(key(*it) >> (8 * d)) & 0xff]++] = std::move(*it);
+		std::swap(src, dst);
+	}
+	if (src != first) std::move(src, src + n, first);
+}
+
 
 
 } // namespace flat
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace str2d
+{
+
+// Array of trivially copyable values held in memory which is mapped directly from the operating system.
+// On Linux the array is an anonymous private mapping; it's resized with "mremap(MREMAP_MAYMOVE)", and
+// "grow_centered" moves the pages of the used range into the middle of a larger mapping with
+// "mremap(MREMAP_FIXED)". In both cases page table entries are moved instead of the values being copied.
+// Elsewhere the values are copied into a new allocation.
+// New values are zero.
+template<typename T>
+// T models TriviallyCopyable
+class mapped_array
+{
+	static_assert(std::is_trivially_copyable_v<T>, "mapped_array holds only trivially copyable values");
+
+public:
+	using value_type = T;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference = T&;
+	using const_reference = const T&;
+	using pointer = T*;
+	using const_pointer = const T*;
+	using iterator = T*;
+	using const_iterator = const T*;
+
+private:
+	T* p = nullptr;
+	size_type n = 0;
+	// size of the mapping in bytes, a multiple of the page size
+	size_type bytes = 0;
+
+	static size_type page_size() {
+#if defined(__linux__)
+		static const size_type s = static_cast<size_type>(sysconf(_SC_PAGESIZE));
+		return s;
+#else
+		return 4096;
+#endif
+	}
+
+	static size_type round_to_pages(size_type b) {
+		size_type s = page_size();
+		return (b + s - 1) / s * s;
+	}
+
+	static size_type mapping_size(size_type n) {
+		return round_to_pages(n * sizeof(T));
+	}
+
+	static T* map(size_type bytes) {
+		if (bytes == 0) return nullptr;
+#if defined(__linux__)
+		void* q = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (q == MAP_FAILED) throw std::bad_alloc();
+#else
+		void* q = std::calloc(bytes, 1);
+		if (q == nullptr) throw std::bad_alloc();
+#endif
+		return static_cast<T*>(q);
+	}
+
+	static void unmap(T* q, size_type bytes) {
+		if (q == nullptr) return;
+#if defined(__linux__)
+		munmap(q, bytes);
+#else
+		std::free(q);
+#endif
+	}
+
+	static char* byte_pointer(T* q) { return reinterpret_cast<char*>(q); }
+
+	void release() {
+		unmap(p, bytes);
+		p = nullptr;
+		n = 0;
+		bytes = 0;
+	}
+
+	void move_from(mapped_array& other) {
+		p = other.p;
+		n = other.n;
+		bytes = other.bytes;
+		other.p = nullptr;
+		other.n = 0;
+		other.bytes = 0;
+	}
+
+public:
+	mapped_array() = default;
+	explicit mapped_array(size_type n) : p(map(mapping_size(n))), n(n), bytes(mapping_size(n)) {}
+	mapped_array(const mapped_array& other) : mapped_array(other.n) {
+		if (n) std::memcpy(p, other.p, n * sizeof(T));
+	}
+	mapped_array(mapped_array&& other) noexcept { move_from(other); }
+	~mapped_array() { release(); }
+
+	mapped_array& operator=(const mapped_array& other) {
+		if (this == &other) return *this;
+		mapped_array tmp(other);
+		release();
+		move_from(tmp);
+		return *this;
+	}
+	mapped_array& operator=(mapped_array&& other) noexcept {
+		if (this == &other) return *this;
+		release();
+		move_from(other);
+		return *this;
+	}
+
+	// Changes the number of values to "m"; first "min(m, size())" values are kept
+	void resize(size_type m) {
+		size_type b = mapping_size(m);
+		size_type old_bytes = bytes;
+		if (b != bytes) {
+			if (p == nullptr || b == 0) {
+				T* q = map(b);
+				release();
+				p = q;
+			}
+			else {
+#if defined(__linux__)
+				void* q = mremap(p, bytes, b, MREMAP_MAYMOVE);
+				if (q == MAP_FAILED) throw std::bad_alloc();
+				p = static_cast<T*>(q);
+#else
+				T* q = map(b);
+				std::memcpy(q, p, std::min(bytes, b));
+				unmap(p, bytes);
+				p = q;
+#endif
+			}
+			bytes = b;
+		}
+		// values between the old and the new size may be left over from a larger size; pages which were
+		// added to the mapping are already zero
+		if (m > n) {
+			size_type stale_last = std::min(m * sizeof(T), old_bytes);
+			if (stale_last > n * sizeof(T)) std::memset(byte_pointer(p) + n * sizeof(T), 0, stale_last - n * sizeof(T));
+		}
+		n = m;
+	}
+
+	// Grows the array to "m" values and moves the values "[first, last)" to the middle of it.
+	// Returns the new position of "[first, last)"; values outside of it are unspecified.
+	std::pair<T*, T*> grow_centered(size_type m, T* first, T* last) {
+		// precondition: [first, last) belongs to [begin(), end())
+		// precondition: m >= size()
+		size_type used = static_cast<size_type>(last - first);
+		size_type b = mapping_size(m);
+		T* q = map(b);
+		size_type first_index = (m - used) >> 1;
+#if defined(__linux__)
+		size_type s = page_size();
+		size_type first_byte = static_cast<size_type>(first - p) * sizeof(T);
+		size_type source = first_byte / s * s;
+		size_type length = round_to_pages(static_cast<size_type>(last - p) * sizeof(T)) - source;
+		// Pages keep the offsets of the values inside of them, so the pages are moved by a multiple of
+		// both the page size and the size of the value
+		size_type step = s;
+		while (step % sizeof(T)) step = step + s;
+		size_type wanted = first_index * sizeof(T);
+		difference_type shift = static_cast<difference_type>(wanted) - static_cast<difference_type>(first_byte);
+		shift = shift / static_cast<difference_type>(step) * static_cast<difference_type>(step);
+		difference_type destination = static_cast<difference_type>(source) + shift;
+		if (0 <= destination && static_cast<size_type>(destination) + length <= b) {
+			void* moved = mremap(byte_pointer(p) + source, length, length, MREMAP_MAYMOVE | MREMAP_FIXED, byte_pointer(q) + destination);
+			if (moved != MAP_FAILED) {
+				unmap(p, bytes);
+				T* new_first = reinterpret_cast<T*>(byte_pointer(q) + (static_cast<difference_type>(first_byte) + shift));
+				p = q;
+				n = m;
+				bytes = b;
+				return { new_first, new_first + used };
+			}
+		}
+#endif
+		std::memcpy(q + first_index, first, used * sizeof(T));
+		unmap(p, bytes);
+		p = q;
+		n = m;
+		bytes = b;
+		return { q + first_index, q + (first_index + used) };
+	}
+
+	iterator begin() { return p; }
+	const_iterator begin() const { return p; }
+	const_iterator cbegin() const { return p; }
+
+	iterator end() { return p + n; }
+	const_iterator end() const { return p + n; }
+	const_iterator cend() const { return p + n; }
+
+	reference operator[](size_type i) { return p[i]; }
+	const_reference operator[](size_type i) const { return p[i]; }
+
+	T* data() { return p; }
+	const T* data() const { return p; }
+
+	size_type size() const { return n; }
+	bool empty() const { return n == 0; }
+};
+
+} // namespace str2d
@@ -55,6 +55,8 @@ private:
 		free_list_end = other.free_list_end;
 		chunks = std::move(other.chunks);
 		other.chunks = std::vector<byte*>();
+		other.free_list = nullptr;
+		other.free_list_end = nullptr;
 	}
 
 	void copy_from(const pool_allocator_base& other) {
@@ -603,6 +603,98 @@ C find_if_not(C first, C last, Pred p) {
 	return C(seg::find_if_not(segment(first), flat(first), segment(last), flat(last), p));
 }
 
+template<typename I, typename Pred>
+// I models SegmentIterator
+// Pred models UnaryPredicate
+// Domain<Pred> == IteratorValueType<I>
+I partition_point_segments_branchless(I fseg, I lseg, Pred p) {
+	// First segment of [fseg, lseg) whose last element doesn't satisfy "p", or "lseg".
+	// Range is narrowed by conditional moves instead of branches, and on every step the headers and
+	// the last elements of both segments which can be probed next are prefetched, so the next probe
+	// doesn't wait for memory whichever way the current one goes.
+	IteratorDifferenceType<I> n = std::distance(fseg, lseg);
+	while(n) {
+		// partition point is in [fseg, fseg + n]
+		IteratorDifferenceType<I> h = n >> 1;
+		if (h) {
+			IteratorDifferenceType<I> q = h >> 1;
+			I left = flat::successor(fseg, q);
+			I right = flat::successor(fseg, n - h + q);
+			prefetch(&*left.h);
+			prefetch(&*right.h);
+			prefetch(&*flat::predecessor(std::end(left), 1));
+			prefetch(&*flat::predecessor(std::end(right), 1));
+		}
+		I middle_seg = flat::successor(fseg, h);
+		// advances by "n - h" or by nothing, masked so that compilers don't turn it back into a branch
+		IteratorDifferenceType<I> step = (n - h) & -static_cast<IteratorDifferenceType<I>>(p(*flat::predecessor(std::end(middle_seg), 1)));
+		fseg = flat::successor(fseg, step);
+		n = h;
+	}
+	return fseg;
+}
+
+template<typename I, typename Pred, typename Proc>
+// I models SegmentIterator
+// Pred models UnaryPredicate
+// Domain<Pred> == IteratorValueType<I>
+// Proc models Procedure
+// Arity<Proc> == 3
+// ArgumentType<Proc, 0> == ArgumentType<Proc, 1> == FlatIterator<I>
+// ArgumentType<Proc, 2> == Pred
+// Codomain<Proc> == FlatIterator<I>
+std::pair<I, FlatIterator<I>> partition_point_branchless(
+	I fseg, FlatIterator<I> fflat, I lseg, FlatIterator<I> lflat, Pred p, Proc pr) {
+	I s = seg::partition_point_segments_branchless(fseg, lseg, p);
+	FlatIterator<I> f = s == fseg ? fflat : std::begin(s);
+	FlatIterator<I> l = s == lseg ? lflat : flat::predecessor(std::end(s), 1);
+	return { s, pr(f, l, p) };
+}
+
+template<typename I, typename Pred, typename Proc>
+// I models SegmentIterator
+// Pred models UnaryPredicate
+// Domain<Pred> == IteratorValueType<I>
+// flat::arithmetic_bound<Pred>::value
+// Proc models Procedure
+// Arity<Proc> == 3
+// ArgumentType<Proc, 0> == ArgumentType<Proc, 1> == FlatIterator<I>
+// ArgumentType<Proc, 2> == Pred
+// Codomain<Proc> == FlatIterator<I>
+std::pair<I, FlatIterator<I>> partition_point_interpolation(
+	I fseg, FlatIterator<I> fflat, I lseg, FlatIterator<I> lflat, Pred p, Proc pr) {
+	// Segments are probed by their last elements, as in "partition_point", but at the interpolated position
+	double x = static_cast<double>(flat::arithmetic_bound<Pred>::key(p));
+	IteratorDifferenceType<I> n = std::distance(fseg, lseg);
+	bool interpolate = true;
+	while(n) {
+		IteratorDifferenceType<I> h = n >> 1;
+		if (interpolate && n > 2) {
+			I back_seg = flat::successor(fseg, n - 1);
+			h = static_cast<IteratorDifferenceType<I>>(flat::interpolation_index(
+				x,
+				static_cast<double>(*flat::predecessor(std::end(fseg), 1)),
+				static_cast<double>(*flat::predecessor(std::end(back_seg), 1)),
+				static_cast<std::size_t>(n)));
+		}
+		IteratorDifferenceType<I> _n = n;
+		I middle_seg = flat::successor(fseg, h);
+		FlatIterator<I> flat = flat::predecessor(std::end(middle_seg), 1);
+		if(p(*flat)) {
+			fseg = flat::successor(middle_seg, 1);
+			fflat = std::begin(fseg);
+			n = n - h - 1;
+		}
+		else {
+			lseg = middle_seg;
+			lflat = flat;
+			n = h;
+		}
+		interpolate = interpolate && n <= (_n >> 1);
+	}
+	return { fseg, pr(fflat, lflat, p) };
+}
+
 template<typename I, typename Pred, typename Proc = flat::find_adaptor_binary>
 // I models SegmentIterator
 // Pred models UnaryPredicate
@@ -614,6 +706,10 @@ template<typename I, typename Pred, typename Proc = flat::find_adaptor_binary>
 // Codomain<Proc> == FlatIterator<I>
 std::pair<I, FlatIterator<I>> partition_point(
 	I fseg, FlatIterator<I> fflat, I lseg, FlatIterator<I> lflat, Pred p, Proc pr = Proc{}) {
+	if constexpr (flat::interpolates_segments<Proc, Pred>::value)
+		return seg::partition_point_interpolation(fseg, fflat, lseg, lflat, p, pr);
+	if constexpr (flat::searches_segments_branchless<Proc>::value)
+		return seg::partition_point_branchless(fseg, fflat, lseg, lflat, p, pr);
 	IteratorDifferenceType<I> n = std::distance(fseg, lseg);
 	while(n) {
 		IteratorDifferenceType<I> h = n >> 1;
@@ -758,6 +854,292 @@ C lower_bound_combined(C first, C last, const IteratorValueType<C>& x, Cmp cmp,
 	return C(seg::lower_bound_combined(segment(first), flat(first), segment(last), flat(last), x, cmp, n, pr));
 }
 
+// Batch searches advance the searches of up to "batch_group_size" keys in lockstep. On every step the memory
+// each search touches next is prefetched for all of them first and only then read, so the cache misses of
+// the group overlap instead of following each other.
+// Segment is found by probing the headers and the last elements of the segments, and the partition point
+// inside it by a binary search; find adaptors aren't used.
+
+constexpr std::size_t batch_group_size = 16;
+
+template<typename C, typename I, typename O, typename F>
+// C models SegmentedCoordinate
+// I models ForwardIterator
+// O models OutputIterator
+// ValueType<O> == C
+// F models UnaryFunction
+// Domain<F> == IteratorValueType<I>
+// Codomain<F> models UnaryPredicate
+// Domain<Codomain<F>> == IteratorValueType<C>
+O partition_point_batch(C first, C last, I kf, I kl, O out, F pred) {
+	// Writes the partition point of "pred(k)" for every key "k" of [kf, kl)
+	using S = SegmentIterator<C>;
+	using D = IteratorDifferenceType<S>;
+	using FI = FlatIterator<C>;
+	S fseg = segment(first);
+	S lseg = segment(last);
+	const D segments = std::distance(fseg, lseg);
+
+	I keys[batch_group_size];
+	S s[batch_group_size];
+	FI f[batch_group_size];
+	std::ptrdiff_t len[batch_group_size];
+
+	while (kf != kl) {
+		std::size_t g = 0;
+		while (g < batch_group_size && kf != kl) {
+			keys[g] = kf;
+			s[g] = fseg;
+			++g;
+			++kf;
+		}
+
+		// All the searches of a group narrow [s, s + n] the same number of times, so they share "n"
+		D n = segments;
+		while (n) {
+			D h = n >> 1;
+			for (std::size_t i = 0; i < g; ++i) prefetch(&*flat::successor(s[i], h).h);
+			for (std::size_t i = 0; i < g; ++i) prefetch(&*flat::predecessor(std::end(flat::successor(s[i], h)), 1));
+			for (std::size_t i = 0; i < g; ++i) {
+				D step = (n - h) & -static_cast<D>(pred(*keys[i])(*flat::predecessor(std::end(flat::successor(s[i], h)), 1)));
+				s[i] = flat::successor(s[i], step);
+			}
+			n = h;
+		}
+
+		// Partition point is in [f, f + len], as in "partition_point"
+		for (std::size_t i = 0; i < g; ++i) {
+			f[i] = s[i] == fseg ? flat(first) : std::begin(s[i]);
+			FI l = s[i] == lseg ? flat(last) : flat::predecessor(std::end(s[i]), 1);
+			len[i] = std::distance(f[i], l);
+		}
+		bool searching = true;
+		while (searching) {
+			searching = false;
+			for (std::size_t i = 0; i < g; ++i)
+				if (len[i]) prefetch(&*flat::successor(f[i], len[i] >> 1));
+			for (std::size_t i = 0; i < g; ++i) {
+				if (!len[i]) continue;
+				std::ptrdiff_t h = len[i] >> 1;
+				FI m = flat::successor(f[i], h);
+				if (pred(*keys[i])(*m)) {
+					f[i] = flat::successor(m, 1);
+					len[i] = len[i] - h - 1;
+				}
+				else len[i] = h;
+				searching = searching || len[i];
+			}
+		}
+
+		for (std::size_t i = 0; i < g; ++i) {
+			*out = C(s[i], f[i]);
+			++out;
+		}
+	}
+	return out;
+}
+
+template<typename C, typename I, typename O, typename Cmp>
+// C models SegmentedCoordinate
+// I models ForwardIterator
+// IteratorValueType<I> == IteratorValueType<C>
+// O models OutputIterator
+// ValueType<O> == C
+// Cmp models StrictWeakOrdering
+// Domain<Cmp> == IteratorValueType<C>
+inline
+O lower_bound_batch(C first, C last, I kf, I kl, O out, Cmp cmp) {
+	return seg::partition_point_batch(first, last, kf, kl, out, [cmp](const IteratorValueType<C>& x) {
+		return lower_bound_predicate(x, cmp);
+	});
+}
+
+template<typename I, typename Pred, typename Proc = flat::find_adaptor_galloping>
+// I models SegmentIterator
+// Pred models UnaryPredicate
+// Domain<Pred> == IteratorValueType<I>
+// Proc models Procedure
+// Arity<Proc> == 3
+// ArgumentType<Proc, 0> == ArgumentType<Proc, 1> == FlatIterator<I>
+// ArgumentType<Proc, 2> == Pred
+// Codomain<Proc> == FlatIterator<I>
+std::pair<I, FlatIterator<I>> partition_point_galloping(
+	I fseg, FlatIterator<I> fflat, I lseg, FlatIterator<I> lflat, Pred p, Proc pr = Proc{}) {
+	// Segments "fseg", "fseg + 1", "fseg + 3", "fseg + 7", ... are probed by their last elements until one
+	// doesn't satisfy "p"; segments between the last two probes are then searched as by "partition_point".
+	// Cost is logarithmic in the distance of the partition point from "fseg".
+	IteratorDifferenceType<I> n = std::distance(fseg, lseg);
+	IteratorDifferenceType<I> lo = 0;
+	IteratorDifferenceType<I> step = 1;
+	while (step <= n && p(*flat::predecessor(std::end(flat::successor(fseg, step - 1)), 1))) {
+		lo = step;
+		step = step << 1;
+	}
+	if (step <= n) {
+		lseg = flat::successor(fseg, step - 1);
+		lflat = flat::predecessor(std::end(lseg), 1);
+	}
+	if (lo) {
+		fseg = flat::successor(fseg, lo);
+		fflat = std::begin(fseg);
+	}
+	return seg::partition_point(fseg, fflat, lseg, lflat, p, pr);
+}
+
+template<typename C, typename Pred, typename Proc = flat::find_adaptor_galloping>
+// C models SegmentedCoordinate
+// Pred models UnaryPredicate
+// Domain<Pred> == IteratorValueType<C>
+// Proc models Procedure
+// Arity<Proc> == 3
+// ArgumentType<Proc, 0> == ArgumentType<Proc, 1> == FlatIterator<C>
+// ArgumentType<Proc, 2> == Pred
+// Codomain<Proc> == FlatIterator<C>
+inline
+C partition_point_galloping(C first, C last, Pred p, Proc pr = Proc{}) {
+	return C(seg::partition_point_galloping(segment(first), flat(first), segment(last), flat(last), p, pr));
+}
+
+// Sorted batch searches start every search from the result of the previous one and gallop forward from it,
+// both over the segments and inside the segment, so "k" keys cost O(k log(n / k)) and the areas are
+// visited in memory order.
+
+template<typename C, typename I, typename O, typename F>
+// C models SegmentedCoordinate
+// I models InputIterator
+// O models OutputIterator
+// ValueType<O> == C
+// F models UnaryFunction
+// Domain<F> == IteratorValueType<I>
+// Codomain<F> models UnaryPredicate
+// Domain<Codomain<F>> == IteratorValueType<C>
+O partition_point_sorted_batch(C first, C last, I kf, I kl, O out, F pred) {
+	// precondition: partition points of "pred(k)" don't decrease over [kf, kl)
+	while (kf != kl) {
+		first = seg::partition_point_galloping(first, last, pred(*kf));
+		*out = first;
+		++out;
+		++kf;
+	}
+	return out;
+}
+
+template<typename C, typename I, typename O, typename F, typename G>
+// C models SegmentedCoordinate
+// I models InputIterator
+// O models OutputIterator
+// ValueType<O> == std::pair<C, C>
+// F models UnaryFunction
+// G models UnaryFunction
+// Domain<F> == Domain<G> == IteratorValueType<I>
+// Codomain<F> and Codomain<G> model UnaryPredicate
+// Domain<Codomain<F>> == Domain<Codomain<G>> == IteratorValueType<C>
+O partition_range_sorted_batch(C first, C last, I kf, I kl, O out, F lower, G upper) {
+	// precondition: partition points of "lower(k)" and of "upper(k)" don't decrease over [kf, kl)
+	// precondition: partition point of "upper(k)" doesn't come before the one of "lower(k)"
+	while (kf != kl) {
+		first = seg::partition_point_galloping(first, last, lower(*kf));
+		*out = std::pair<C, C>(first, seg::partition_point_galloping(first, last, upper(*kf)));
+		++out;
+		++kf;
+	}
+	return out;
+}
+
+template<typename C, typename I, typename O, typename Cmp>
+// C models SegmentedCoordinate
+// I models InputIterator
+// IteratorValueType<I> == IteratorValueType<C>
+// O models OutputIterator
+// ValueType<O> == C
+// Cmp models StrictWeakOrdering
+// Domain<Cmp> == IteratorValueType<C>
+inline
+O lower_bound_sorted_batch(C first, C last, I kf, I kl, O out, Cmp cmp) {
+	// precondition: [kf, kl) is sorted by "cmp"
+	return seg::partition_point_sorted_batch(first, last, kf, kl, out, [cmp](const IteratorValueType<C>& x) {
+		return lower_bound_predicate(x, cmp);
+	});
+}
+
+template<typename C, typename I, typename O, typename Cmp>
+// C models SegmentedCoordinate
+// I models InputIterator
+// IteratorValueType<I> == IteratorValueType<C>
+// O models OutputIterator
+// ValueType<O> == std::pair<C, C>
+// Cmp models StrictWeakOrdering
+// Domain<Cmp> == IteratorValueType<C>
+inline
+O equal_range_sorted_batch(C first, C last, I kf, I kl, O out, Cmp cmp) {
+	// precondition: [kf, kl) is sorted by "cmp"
+	return seg::partition_range_sorted_batch(first, last, kf, kl, out,
+		[cmp](const IteratorValueType<C>& x) { return lower_bound_predicate(x, cmp); },
+		[cmp](const IteratorValueType<C>& x) { return upper_bound_predicate(x, cmp); });
+}
+
+template<typename I, typename Pred, typename Proc = flat::find_adaptor_galloping_backward>
+// I models SegmentIterator
+// Pred models UnaryPredicate
+// Domain<Pred> == IteratorValueType<I>
+// Proc models Procedure
+// Arity<Proc> == 3
+// ArgumentType<Proc, 0> == ArgumentType<Proc, 1> == FlatIterator<I>
+// ArgumentType<Proc, 2> == Pred
+// Codomain<Proc> == FlatIterator<I>
+std::pair<I, FlatIterator<I>> partition_point_galloping_backward(
+	I fseg, FlatIterator<I> fflat, I lseg, FlatIterator<I> lflat, Pred p, Proc pr = Proc{}) {
+	// Same as "partition_point_galloping", but segments "lseg - 1", "lseg - 2", "lseg - 4", ... are probed
+	// until one satisfies "p"; cost is logarithmic in the distance of the partition point from "lseg"
+	IteratorDifferenceType<I> n = std::distance(fseg, lseg);
+	IteratorDifferenceType<I> lo = 0;
+	IteratorDifferenceType<I> step = 1;
+	while (step <= n && !p(*flat::predecessor(std::end(flat::predecessor(lseg, step)), 1))) {
+		lo = step;
+		step = step << 1;
+	}
+	if (step <= n) {
+		fseg = flat::predecessor(lseg, step - 1);
+		fflat = std::begin(fseg);
+	}
+	if (lo) {
+		lseg = flat::predecessor(lseg, lo);
+		lflat = flat::predecessor(std::end(lseg), 1);
+	}
+	return seg::partition_point(fseg, fflat, lseg, lflat, p, pr);
+}
+
+// Hinted searches gallop from "hint" towards the partition point, forward or backward, so they cost
+// O(log d), where "d" is the distance between the hint and the partition point.
+
+template<typename C, typename Pred>
+// C models SegmentedCoordinate
+// Pred models UnaryPredicate
+// Domain<Pred> == IteratorValueType<C>
+C partition_point_from(C first, C hint, C last, Pred p) {
+	// precondition: hint is in [first, last]
+	if (hint != last && p(*hint)) return seg::partition_point_galloping(hint, last, p);
+	return C(seg::partition_point_galloping_backward(segment(first), flat(first), segment(hint), flat(hint), p));
+}
+
+template<typename C, typename Cmp>
+// C models SegmentedCoordinate
+// Cmp models StrictWeakOrdering
+// Domain<Cmp> == IteratorValueType<C>
+inline
+C lower_bound_from(C first, C hint, C last, const IteratorValueType<C>& x, Cmp cmp) {
+	return seg::partition_point_from(first, hint, last, lower_bound_predicate(x, cmp));
+}
+
+template<typename C, typename Cmp>
+// C models SegmentedCoordinate
+// Cmp models StrictWeakOrdering
+// Domain<Cmp> == IteratorValueType<C>
+inline
+C upper_bound_from(C first, C hint, C last, const IteratorValueType<C>& x, Cmp cmp) {
+	return seg::partition_point_from(first, hint, last, upper_bound_predicate(x, cmp));
+}
+
 
 
 template<typename I, typename Cmp>
@@ -839,6 +1221,32 @@ C upper_bound_combined(C first, C last, const IteratorValueType<C>& x, Cmp cmp,
 }
 
 
+template<typename I, typename Cmp, typename Proc>
+// I models SegmentIterator
+// Cmp models StrictWeakOrdering
+// Domain<Cmp> == IteratorValueType<I>
+// Proc models Procedure
+// Arity<Proc> == 3
+// ArgumentType<Proc, 0> == ArgumentType<Proc, 1> == FlatIterator<I>
+// ArgumentType<Proc, 2> == Cmp
+// Codomain<Proc> == std::pair<FlatIterator<I>, FlatIterator<I>>
+pair2<I, FlatIterator<I>> equal_range_branchless(
+	I fseg, FlatIterator<I> fflat, I lseg, FlatIterator<I> lflat, const IteratorValueType<I>& x, Cmp cmp, Proc pr) {
+	lower_bound_predicate lp(x, cmp);
+	upper_bound_predicate up(x, cmp);
+	I ls = seg::partition_point_segments_branchless(fseg, lseg, lp);
+	I us = seg::partition_point_segments_branchless(ls, lseg, up);
+	FlatIterator<I> lf = ls == fseg ? fflat : std::begin(ls);
+	FlatIterator<I> ll = ls == lseg ? lflat : flat::predecessor(std::end(ls), 1);
+	if (ls == us) {
+		std::pair<FlatIterator<I>, FlatIterator<I>> tmp = pr(lf, ll, x, cmp);
+		return { {ls, tmp.first}, {ls, tmp.second} };
+	}
+	FlatIterator<I> uf = std::begin(us);
+	FlatIterator<I> ul = us == lseg ? lflat : flat::predecessor(std::end(us), 1);
+	return { {ls, std::partition_point(lf, ll, lp)}, {us, std::partition_point(uf, ul, up)} };
+}
+
 template<typename I, typename Cmp, typename Proc = flat::equal_range_adaptor_binary>
 // I models SegmentIterator
 // Cmp models StrictWeakOrdering
@@ -851,6 +1259,9 @@ template<typename I, typename Cmp, typename Proc = flat::equal_range_adaptor_bin
 pair2<I, FlatIterator<I>> equal_range(
 	I fseg, FlatIterator<I> fflat, I lseg, FlatIterator<I> lflat, const IteratorValueType<I>& x, Cmp cmp, Proc pr = Proc{}) {
 		
+	if constexpr (flat::searches_segments_branchless<Proc>::value)
+		return seg::equal_range_branchless(fseg, fflat, lseg, lflat, x, cmp, pr);
+
 	IteratorDifferenceType<I> n = std::distance(fseg, lseg);
 	while(n) {
 		IteratorDifferenceType<I> h = n >> 1;
@@ -1253,10 +1664,10 @@ std::pair<I, FlatIterator<I>> predecessor(I lseg, FlatIterator<I> lflat, N n) {
 	DiffType d = lflat - fflat;
 	while (_n > d) {
 		_n = _n - d;
-		lflat = std::end(--lflat);
-		d = lflat - std::begin(lflat);
+		lflat = std::end(--lseg);
+		d = lflat - std::begin(lseg);
 	}
-	return { lflat,  flat::predecessor(lflat, _n) };
+	return { lseg, flat::predecessor(lflat, _n) };
 }
 
 template<typename C, typename N>
@@ -2,8 +2,16 @@
 
 #include <tuple>
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <variant>
+#include <vector>
 
 #include "flat_algorithm.h"
+#include "mapped_array.h"
 #include "seg_container_base.h"
 #include "utility.h"
 
@@ -689,6 +697,12 @@ pair2<I, size_t> insert_balance_left_simple(
 	return { { left, l - n }, { left, l } };
 }
 
+// Positions of the range inserted into a segment range, and the range of segments [first, last)
+// which the insertion has changed
+template<typename I>
+// I models SegmentHeaderIterator
+using insert_result = std::pair<pair2<I, size_t>, std::pair<I, I>>;
+
 // Calculates :
 // 1) minimal number of needed segments
 // 2) how many of them will be larger than "size" by one
@@ -707,34 +721,36 @@ std::tuple<size_t, size_t, size_t> segment_range_info(
 template<typename I>
 // I models SegmentIndex
 inline
-pair2<Iterator<I>, size_t> insert_left_empty(
+insert_result<Iterator<I>> insert_left_empty(
 	I& index, Iterator<I> curr, size_t i, size_t n) {
 	// precondition: curr == begin(index)
 
 	auto [nm_segments, m, s] = segment_range_info(capacity(*curr), 0, seg::size(*curr), n);
 	Iterator<I> first = insert(index, curr, static_cast<SizeType<I>>(nm_segments - 1));
-	return insert_balance_left_increase(first, flat::successor(first, nm_segments - 1), m, s, i, n);
+	Iterator<I> last = flat::successor(first, nm_segments);
+	return { insert_balance_left_increase(first, last - 1, m, s, i, n), { first, last } };
 }
 
 // New segments need to be allocated to the left of "curr".
 template<typename I>
 // I models SegmentIndex
 inline
-pair2<Iterator<I>, size_t> insert_left(
+insert_result<Iterator<I>> insert_left(
 	I& index, Iterator<I> curr, size_t i, size_t n) {
 	// precondition: curr > begin(index)
 	// precondition: available(*(curr - 1)) + available(*curr) < n
 
 	auto [nm_segments, m, s] = segment_range_info(capacity(*curr), seg::size(*(curr - 1)), seg::size(*curr), n);
-	Iterator<I> first = insert(index, curr, static_cast<SizeType<I>>(nm_segments - 2));
-	return insert_balance_left(first - 1, flat::successor(first, nm_segments - 2), m, s, i, n);
+	Iterator<I> first = insert(index, curr, static_cast<SizeType<I>>(nm_segments - 2)) - 1;
+	Iterator<I> last = flat::successor(first, nm_segments);
+	return { insert_balance_left(first, last - 1, m, s, i, n), { first, last } };
 }
 
 // There exist segments to both side of "curr"
 template<typename I>
 // I models SegmentIndex
 inline
-pair2<Iterator<I>, size_t> insert_left_right_exist(
+insert_result<Iterator<I>> insert_left_right_exist(
 	I& index, Iterator<I> curr, size_t i, size_t n) {
 	// precondition: curr != begin(index)
 	// precondition: !empty(*--curr) && !empty(*++curr)
@@ -742,11 +758,11 @@ pair2<Iterator<I>, size_t> insert_left_right_exist(
 
 	Iterator<I> left = curr - 1;
 	if (available(*curr) + available(*left) >= n)
-		return insert_balance_left_simple(curr, left, (size(*curr) + size(*left) + n) >> 1, i, n);
+		return { insert_balance_left_simple(curr, left, (size(*curr) + size(*left) + n) >> 1, i, n), { left, curr + 1 } };
 	
 	Iterator<I> right = curr + 1;
 	if (available(*curr) + available(*right) >= n)
-		return insert_balance_right_simple(curr, right, (size(*curr) + size(*right) + n) >> 1, i, n);
+		return { insert_balance_right_simple(curr, right, (size(*curr) + size(*right) + n) >> 1, i, n), { curr, right + 1 } };
 
 	return insert_left(index, curr, i, n);
 }
@@ -755,7 +771,7 @@ pair2<Iterator<I>, size_t> insert_left_right_exist(
 template<typename I>
 // I models SegmentIndex
 inline
-pair2<Iterator<I>, size_t> insert_left_exists(
+insert_result<Iterator<I>> insert_left_exists(
 	I& index, Iterator<I> curr, size_t i, size_t n) {
 	// precondition: curr != begin(index)
 	// precondition: !empty(*--curr)
@@ -764,7 +780,7 @@ pair2<Iterator<I>, size_t> insert_left_exists(
 	Iterator<I> left = curr - 1;
 	if (available(*curr) + available(*left) >= n) {
 		// We can insert all new elements on "curr" and "left"
-		return insert_balance_left_simple(curr, left, (seg::size(*curr) + seg::size(*left) + n) >> 1, i, n);
+		return { insert_balance_left_simple(curr, left, (seg::size(*curr) + seg::size(*left) + n) >> 1, i, n), { left, curr + 1 } };
 	}
 	// New segments need to be allocated to the left of "curr".
 	return insert_left(index, curr, i, n);
@@ -774,7 +790,7 @@ pair2<Iterator<I>, size_t> insert_left_exists(
 template<typename I>
 // I models SegmentIndex
 inline
-pair2<Iterator<I>, size_t> insert_right_exists(
+insert_result<Iterator<I>> insert_right_exists(
 	I& index, Iterator<I> curr, size_t i, size_t n) {
 	// precondition: curr == begin(index)
 	// precondition: !empty(*++curr)
@@ -783,7 +799,7 @@ pair2<Iterator<I>, size_t> insert_right_exists(
 	Iterator<I> right = curr + 1;
 	if (available(*curr) + available(*right) >= n) {
 		// We first try to balance to to "right"
-		return insert_balance_right_simple(curr, right, (seg::size(*curr) + seg::size(*right) + n) >> 1, i, n);
+		return { insert_balance_right_simple(curr, right, (seg::size(*curr) + seg::size(*right) + n) >> 1, i, n), { curr, right + 1 } };
 	}
 	// New segments need to be allocated(I chose to do the allocations always to the left of "curr").
 	return insert_left_empty(index, curr, i, n);
@@ -806,22 +822,44 @@ pair2<Iterator<I>, size_t> insert_empty(I& index, size_t n) {
 	return { { first, size_t(0) }, { last, seg::size(*last) } };
 }
 
-// Entry point for insertion
+// Index is empty.
+// We allocate the segments for "n" elements so that each of them holds about "s" of them, but at least half
+// of its capacity, and spread the elements evenly over them.
 template<typename I>
 // I models SegmentIndex
 inline
-pair2<Iterator<I>, size_t> insert_to_segment_range(
+pair2<Iterator<I>, size_t> insert_empty_filled(I& index, size_t n, size_t s) {
+	// precondition: size(index) == 0 && n > 0
+	// precondition: segment_capacity(index) / 2 <= s <= segment_capacity(index)
+
+	size_t nm_segments = std::min((n + s - 1) / s, std::max(n / (segment_capacity(index) / 2), size_t(1)));
+	auto [q, m] = division_with_remainder(n, nm_segments);
+	Iterator<I> first = insert(index, std::begin(index), static_cast<SizeType<I>>(nm_segments));
+	set_segment_bounds(first, m, q + 1);
+	set_segment_bounds(flat::successor(first, m), nm_segments - m, q);
+	Iterator<I> last = flat::successor(first, nm_segments - 1);
+	return { { first, size_t(0) }, { last, seg::size(*last) } };
+}
+
+// Inserts "n" uninitialized elements at the "i"-th position of "curr", and returns their positions
+// alongside the range of segments which have changed. Index isn't notified of the change; since the
+// new elements aren't constructed yet, the caller calls "update_segments" on that range once they are.
+template<typename I>
+// I models SegmentIndex
+inline
+insert_result<Iterator<I>> _insert_to_segment_range(
 	I& index, Iterator<I> curr, size_t i, size_t n) {
 	// Zero new elements are inserted, nothing has to happen
-	if (n == 0) return { { curr, i }, { curr, i } }; 
+	if (n == 0) return { { { curr, i }, { curr, i } }, { curr, curr } };
 
 	if (std::size(index) == 0) {
 		// There are no allocated areas
-		return insert_empty(index, n);
+		pair2<Iterator<I>, size_t> r = insert_empty(index, n);
+		return { r, { std::begin(index), std::end(index) } };
 	}
 	if (seg::available(*curr) >= n) {
 		// "curr" segment can take "n" new elements
-		return insert_current_available_aux(curr, i, n);
+		return { insert_current_available_aux(curr, i, n), { curr, curr + 1 } };
 	}
 	if (curr != std::begin(index)) {
 		// There exist at least 1 segment to the left of "curr"
@@ -839,6 +877,37 @@ pair2<Iterator<I>, size_t> insert_to_segment_range(
 	return insert_left_empty(index, curr, i, n);
 }
 
+// Notifies the index that the sizes or the elements of the segments in the range [first, last) have changed.
+// Indices which don't keep any data about the elements of their segments ignore it.
+template<typename I>
+// I models SegmentIndex
+inline
+void update_segments(I&, Iterator<I>, Iterator<I>) {}
+
+// Notifies the index that the segments in the range [first, last) have changed, by insertion of "n" elements from
+// the "it.second"-th position of "it.first" on, or by erasure of "e" elements which were in front of that position.
+// All the other elements of those segments are in the same order as before, even though some of them may have moved
+// from one segment to another. Indices which don't need to know which elements have changed get only the range.
+template<typename I>
+// I models SegmentIndex
+inline
+void update_segments(I& index, Iterator<I> first, Iterator<I> last, std::pair<Iterator<I>, size_t>, size_t, size_t) {
+	update_segments(index, first, last);
+}
+
+// Entry point for insertion of "n" uninitialized elements at the "i"-th position of "curr"
+// Index isn't notified of the changed segments, since the new elements aren't constructed yet. Only the containers
+// ("list_tmp" and those built on it) keep indices which hold data about the elements("counted_index", "fenced_index",
+// "sampled_index", "hashed_index") valid, by notifying them once the elements are constructed; this entry point is
+// meant for indices which keep only the segment headers.
+template<typename I>
+// I models SegmentIndex
+inline
+pair2<Iterator<I>, size_t> insert_to_segment_range(
+	I& index, Iterator<I> curr, size_t i, size_t n) {
+	return _insert_to_segment_range(index, curr, i, n).first;
+}
+
 //************************************************************************
 // ~SEGMENTED INSERT
 //************************************************************************
@@ -879,26 +948,33 @@ void erase_current(H& curr, size_t i, size_t n) {
 	set_end_index(curr, static_cast<size_t>(last - data(curr)));
 }
 
+// Position which follows the range erased from a segment range, and the range of segments [first, last)
+// which the erasure has changed
+template<typename I>
+// I models SegmentHeaderIterator
+using erase_result = std::pair<std::pair<I, size_t>, std::pair<I, I>>;
+
 // Only the "curr" segment has decreased in size. We balance if needed with other segments.
+// Returns the range of changed segments as well.
 template<typename I>
 // I models SegmentIndex
 inline
-std::pair<Iterator<I>, size_t> erase_balance_current(I& index, Iterator<I> curr, size_t i) {
+erase_result<Iterator<I>> _erase_balance_current(I& index, Iterator<I> curr, size_t i) {
 	// precondition: curr != std::end(index)
 
 	size_t s = seg::size(*curr);
 	if (s >= limit(*curr)) {
 		// "curr" holds over "limit" elements; no balancing needs to happen.
-		return { curr, i };
+		return { { curr, i }, { curr, curr + 1 } };
 	}
 
 	if (curr == std::begin(index)) {
 		// "curr" is the "first segment" and may hold any number of elements greater than 0
 		if (s > 0)
-			return { curr, i }; // "curr" is not empty or the entire segmented range is empty; no balancing needs to happen.
+			return { { curr, i }, { curr, curr + 1 } }; // "curr" is not empty or the entire segmented range is empty; no balancing needs to happen.
 		// "curr" is empty so it gets erased.
 		curr = erase(index, curr);
-		return { curr, 0 };
+		return { { curr, 0 }, { curr, curr } };
 	}
 
 	Iterator<I> left = curr - 1;
@@ -906,12 +982,22 @@ std::pair<Iterator<I>, size_t> erase_balance_current(I& index, Iterator<I> curr,
 		// "left" can take all elements of "curr".
 		move_to_left(*curr, *left, s);
 		left = erase(index, curr) - 1;
-		return { left, size(*left) - (s - i) };
+		return { { left, size(*left) - (s - i) }, { left, left + 1 } };
 	}
 	// Elements are balanced equally on "left" and "curr".
 	size_t move = ((seg::size(*left) + s) >> 1) - s;
 	move_to_right(*left, *curr, move);
-	return { curr, move + i };
+	return { { curr, move + i }, { left, curr + 1 } };
+}
+
+// Only the "curr" segment has decreased in size. We balance if needed with other segments.
+template<typename I>
+// I models SegmentIndex
+inline
+std::pair<Iterator<I>, size_t> erase_balance_current(I& index, Iterator<I> curr, size_t i) {
+	// precondition: curr != std::end(index)
+
+	return _erase_balance_current(index, curr, i).first;
 }
 
 
@@ -940,24 +1026,25 @@ std::pair<I, size_t> erase_balance_left_right_equally(I left, I right) {
 template<typename I>
 // I models SegmentIndex
 inline
-std::pair<Iterator<I>, size_t> erase_balance_left_right(I& index, Iterator<I> left, Iterator<I> right) {
+erase_result<Iterator<I>> erase_balance_left_right(I& index, Iterator<I> left, Iterator<I> right) {
 	size_t left_size = seg::size(*left);
 	size_t right_size = seg::size(*right);
 	size_t n = left_size + right_size;
 	if (n > capacity(*left)) {
 		// Remaining elements can't fit on a single segment
 		left = erase(index, left + 1, right) - 1;
-		return erase_balance_left_right_equally(left, left + 1);
+		return { erase_balance_left_right_equally(left, left + 1), { left, left + 2 } };
 	}
 	if (n >= limit(*left) || (left == std::begin(index) && n > 0)) {
 		// Remaining elements can fit on a single segment
 		move_to_left(*right, *left, right_size);
 		left = erase(index, left + 1, right + 1) - 1;
-		return { left, left_size };
+		return { { left, left_size }, { left, left + 1 } };
 	}
 	if (n == 0) {
 		// Zero elements remain on both "left" and "right"; we erase them alongside all segments in between
-		return { erase(index, left, right + 1), 0 };
+		Iterator<I> it = erase(index, left, right + 1);
+		return { { it, 0 }, { it, it } };
 	}
 	// Remaining elements are to few to be able to reside on a single segment
 	Iterator<I> _left = left - 1;
@@ -967,7 +1054,7 @@ std::pair<Iterator<I>, size_t> erase_balance_left_right(I& index, Iterator<I> le
 		move_to_left(*left, *_left, left_size);
 		move_to_left(*right, *_left, right_size);
 		_left = erase(index, left, right + 1) - 1;
-		return { _left, seg::size(*_left) - right_size };
+		return { { _left, seg::size(*_left) - right_size }, { _left, _left + 1 } };
 	}
 	// There isn't enough space on the segment to the left of "left" to take the
 	// remaning elements.
@@ -975,32 +1062,47 @@ std::pair<Iterator<I>, size_t> erase_balance_left_right(I& index, Iterator<I> le
 	size_t _left_size = seg::size(*_left);
 	move_to_right(*_left, *left, _left_size - ((_left_size + n ) >> 1));
 	left = erase(index, left + 1, right + 1) - 1;
-	return { left, seg::size(*left) - right_size };
+	return { { left, seg::size(*left) - right_size }, { left - 1, left + 1 } };
 }
 
 
-// Entry point for erasure.
+// Erases the elements from the "left_i"-th position of "left" to the "right_i"-th position of "right", and returns
+// the position which follows them and their number, alongside the range of segments which have changed.
 template<typename I>
 // I models SegmentIndex
 inline
-std::tuple<Iterator<I>, size_t, size_t> erase_from_segment_range(
+std::pair<std::tuple<Iterator<I>, size_t, size_t>, std::pair<Iterator<I>, Iterator<I>>> _erase_from_segment_range(
 	I& index, Iterator<I> left, size_t left_i, Iterator<I> right, size_t right_i) {
 	// precondition: std::size(index) > 0 
 
 	if (right == left) {
 		// Beginning and ending of the erased range belong to the same "segment".
 		if (right_i == left_i)
-			return { left, left_i, 0u }; // We are trying to erase zero elements; nothing has to happen
+			return { { left, left_i, 0u }, { left, left } }; // We are trying to erase zero elements; nothing has to happen
 		erase_current(*left, left_i, right_i - left_i);
-		auto [it, i] = erase_balance_current(index, left, left_i);
-		return { it, i, right_i - left_i };
+		auto [r, changed] = _erase_balance_current(index, left, left_i);
+		return { { r.first, r.second, right_i - left_i }, changed };
 	}
 	size_t s = destruct_segment_range(left + 1, right);
 	size_t ls = seg::size(*left) - left_i;
 	erase_current(*left, left_i, ls);
 	erase_current(*right, 0, right_i);
-	auto [it, i] = erase_balance_left_right(index, left, right);
-	return { it, i, s + ls + right_i };
+	auto [r, changed] = erase_balance_left_right(index, left, right);
+	return { { r.first, r.second, s + ls + right_i }, changed };
+}
+
+// Entry point for erasure.
+// Index is notified of the segments which have changed, even if none have, since some might have been erased.
+template<typename I>
+// I models SegmentIndex
+inline
+std::tuple<Iterator<I>, size_t, size_t> erase_from_segment_range(
+	I& index, Iterator<I> left, size_t left_i, Iterator<I> right, size_t right_i) {
+	// precondition: std::size(index) > 0 
+
+	auto [r, changed] = _erase_from_segment_range(index, left, left_i, right, right_i);
+	update_segments(index, changed.first, changed.second, std::make_pair(std::get<0>(r), std::get<1>(r)), size_t(0), std::get<2>(r));
+	return r;
 }
 
 //************************************************************************
@@ -1015,6 +1117,47 @@ std::tuple<Iterator<I>, size_t, size_t> erase_from_segment_range(
 // INDEX 
 //************************************************************************
 
+// Replaces "index" with one twice the size of the used range and "n" new headers,
+// moving the used range into it with "n" free headers at "insert"
+template<typename C>
+// C models SegmentHeaderContainer
+inline
+void grow_headers(
+	C& index, Iterator<C>& used_first, Iterator<C>& used_last, Iterator<C>& insert, SizeType<C> n) {
+
+	using I = Iterator<C>;
+	SizeType<C> used_size = static_cast<SizeType<C>>(used_last - used_first);
+	SizeType<C> new_used_size = used_size + n;
+	C new_index(new_used_size << 1);
+	Iterator<C> new_used_first = flat::successor(std::begin(new_index), new_used_size >> 1);
+	IteratorDifferenceType<I> pre_size = insert - used_first;
+	insert = flat::move_n(used_first, pre_size, new_used_first).second;
+	used_last = flat::move_n(used_first + pre_size, used_size - pre_size, flat::successor(insert, n)).second;
+	used_first = new_used_first;
+	index = std::move(new_index);
+}
+
+// Same as "grow_headers", except that pages of the used range are moved into the middle of 
+// the grown array, instead of the headers being copied
+template<typename H>
+// H models SegmentHeader
+inline
+void grow_headers(
+	mapped_array<H>& index, H*& used_first, H*& used_last, H*& insert, std::size_t n) {
+
+	std::size_t used_size = static_cast<std::size_t>(used_last - used_first);
+	std::ptrdiff_t insert_at = insert - used_first;
+	std::tie(used_first, used_last) = index.grow_centered((used_size + n) << 1, used_first, used_last);
+	std::tie(used_first, used_last) = insert_flat(
+		std::begin(index),
+		std::end(index),
+		used_first,
+		used_last,
+		used_first + insert_at,
+		n);
+	insert = used_first + insert_at;
+}
+
 template<typename C>
 // C models SegmentHeaderContainer
 inline
@@ -1035,14 +1178,7 @@ void insert_headers(
 		insert = used_first + insert_at;
 	}
 	else {
-		SizeType<C> new_used_size = used_size + n;
-		C new_index(new_used_size << 1);
-		Iterator<C> new_used_first = flat::successor(std::begin(new_index), new_used_size >> 1);
-		IteratorDifferenceType<I> pre_size = insert - used_first;
-		insert = flat::move_n(used_first, pre_size, new_used_first).second;
-		used_last = flat::move_n(used_first + pre_size, used_size - pre_size, flat::successor(insert, n)).second;
-		used_first = new_used_first;
-		index = std::move(new_index);
+		grow_headers(index, used_first, used_last, insert, n);
 	}
 }
 
@@ -1072,7 +1208,7 @@ void insert_headers_and_allocate_areas(
 		first = insert;
 		while (_n) {
 			alloc.deallocate(area(*first), 1);
-			--n;
+			--_n;
 			++first;
 		}
 		Iterator<C> insert_end = insert + n;
@@ -1118,18 +1254,26 @@ std::pair<Iterator<C>, Iterator<C>> middle_edges(C& index) {
 	return { edge_left, flat::successor(edge_left, 1) };
 }
 
+// Number of headers an empty copy of an index with "n" segments starts with
+inline
+size_t copy_capacity(size_t n) {
+	return std::max<size_t>(n + (n >> 1) + 1, 8);
+}
+
 // Data structure responsible for holding all "segment headers" and allocating and deallocating
 // "segment areas".
-template<typename T, std::size_t C, typename A>
+template<typename T, std::size_t C, typename A, typename S = std::vector<big_segment_header<T, C>>>
 // T models
 // A models Allocator
+// S models SegmentHeaderContainer
+// ValueType<S> == big_segment_header<T, C>
 class big_header_index
 {
 public:
 	using header_type = big_segment_header<T, C>;
 	using value_type = ValueType<header_type>;
 	using area_type = AreaType<header_type>;
-	using container = std::vector<header_type>;
+	using container = S;
 	using iterator = Iterator<container>;
 	using const_iterator = ConstIterator<container>;
 	using reverse_iterator = std::reverse_iterator<iterator>;
@@ -1147,8 +1291,7 @@ public:
 		edge_left = other.edge_left;
 		edge_right = other.edge_right;
 		other.headers = container();
-		other.edge_left = other.headers.begin();
-		other.edge_right = other.edge_left;
+		other.init();
 	}
 
 	void move_from(big_header_index&& other) {
@@ -1183,7 +1326,7 @@ public:
 		_move_from(other);
 	}
 	big_header_index(const big_header_index& other) :
-		headers(other.size() + (other.size() >> 1)),
+		headers(copy_capacity(other.size())),
 		alloc(other.alloc)
 	{
 		_init();
@@ -1191,14 +1334,16 @@ public:
 	~big_header_index() { destroy(); }
 
 	big_header_index& operator=(big_header_index&& other) {
+		if (this == &other) return *this;
 		destroy();
 		move_from(std::move(other));
 		return *this;
 	}
 	big_header_index& operator=(const big_header_index& other) {
+		if (this == &other) return *this;
 		destroy();
-		headers.resize(other.size() >> 1);
-		alloc = other.alloc();
+		headers.resize(copy_capacity(other.size()));
+		alloc = other.alloc;
 		_init();
 		return *this;
 	};
@@ -1260,7 +1405,8 @@ public:
 };
 
 // Data structure responsible for holding all "segment headers" and allocating and deallocating
-// "segment areas".
+// "segment areas". Unlike "big_header_index" begin and end indices are stored in the "segment area",
+// so each header is only a pointer; the "edge last" header has an area of its own.
 template<typename T, std::size_t C, typename A>
 // T models
 // A models Allocator
@@ -1288,8 +1434,7 @@ public:
 		edge_left = other.edge_left;
 		edge_right = other.edge_right;
 		other.headers = container();
-		other.edge_left = other.headers.begin();
-		other.edge_right = other.edge_left;
+		other.init();
 	}
 
 	void move_from(small_header_index&& other) {
@@ -1299,6 +1444,7 @@ public:
 	}
 
 	void destroy() {
+		// "edge last" area is deallocated as well
 		std::for_each(edge_left, edge_right, deallocate_area<allocator>(alloc));
 	}
 
@@ -1323,25 +1469,27 @@ public:
 		_move_from(other);
 	}
 	small_header_index(const small_header_index& other) :
-		headers(other.size() + (other.size() >> 1)),
-	    alloc(other.alloc)
+		headers(copy_capacity(other.size())),
+		alloc(other.alloc)
 	{ 
 		_init();
 	}
 	~small_header_index() { destroy(); }
 
 	small_header_index& operator=(small_header_index&& other) {
+		if (this == &other) return *this;
 		destroy();
 		move_from(std::move(other));
 		return *this;
-	};
+	}
 	small_header_index& operator=(const small_header_index& other) {
+		if (this == &other) return *this;
 		destroy();
-		headers.resize(other.size() >> 1);
-		alloc = other.alloc();
+		headers.resize(copy_capacity(other.size()));
+		alloc = other.alloc;
 		_init();
 		return *this;
-	};
+	}
 
 	iterator insert(iterator it, size_type n) {
 		// precondition: it belongs to [begin(), end()]
@@ -1400,195 +1548,3293 @@ public:
 };
 
 
+//************************************************************************
+// COMPACT INDEX
+//************************************************************************
 
-
-
-
-
-
-
-template<typename T, typename I>
-// I models SegmentIndex
-class list_tmp
+// Same as "big_header_index", except that it holds "compact segment headers"; each header is a 32 bit
+// handle plus two indices(8 bytes instead of 16). Areas are taken from an area pool owned by the index;
+// "P" is the number of handle bits which select the pool(see "compact_area_pool").
+template<typename T, std::size_t C, typename A, std::size_t P = default_area_pool_bits>
+// T models
+// A models Allocator
+class compact_header_index
 {
 public:
-	using index = I;
-	using allocator = AllocatorType<index>;
-	using value_type = ValueType<index>;
-	using header_iterator = Iterator<index>;
-	using const_header_iterator = ConstIterator<index>;
-	using flat_iterator = value_type*;
-	using const_flat_iterator = value_type *;
-	using segment_iterator = seg::segment_iterator<header_iterator>;
-	using const_segment_iterator = seg::const_segment_iterator<header_iterator, const_header_iterator>;
-	using segmented_coordinate = seg::segmented_coordinate<segment_iterator, const_segment_iterator>;
-	using const_segmented_coordinate = seg::const_segmented_coordinate<segment_iterator, const_segment_iterator>;
-	using iterator = segmented_coordinate;
-	using size_type = seg::size_t;
-	using find_adaptor = flat::find_adaptor_binary;
-	using equal_range_find_adaptor = flat::equal_range_adaptor_binary;
-
-	static segmented_coordinate coordinate_from_const(const_segmented_coordinate it) {
-		return segmented_coordinate(segment_iterator_from_const(it._seg), const_cast<flat_iterator>(it._flat));
-	}
-
-private:
-	index in;
-	size_type s;
-
-	segment_iterator segment_iterator_from_const(const_segment_iterator it) {
-		return segment_iterator(flat::successor(std::begin(in), it.h - std::cbegin(in)));
-	}
-	std::pair<header_iterator, size_t> header_from_coordinate(segmented_coordinate c) {
-		if (c._seg.h != in.end() || empty())
-			return { header_iterator(c._seg.h), static_cast<size_t>(c._flat - seg::begin(*c._seg.h)) };
-		return { header_iterator(c._seg.h - 1), seg::size(*(c._seg.h - 1)) };
-	}
+	using header_type = compact_segment_header<T, C, A, P>;
+	using value_type = ValueType<header_type>;
+	using area_type = AreaType<header_type>;
+	using pool_type = typename header_type::pool_type;
+	using container = std::vector<header_type>;
+	using iterator = Iterator<container>;
+	using const_iterator = ConstIterator<container>;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+	using size_type = SizeType<container>;
+	using allocator = AllocatorRebindType<A, area_type>;
+	constexpr static size_t segment_capacity = header_type::capacity;
 
+	container headers;
+	iterator edge_left;
+	iterator edge_right;
+	allocator alloc;
+	pool_type pool;
 
-	const_segmented_coordinate coordinate_unguarded(const std::pair<header_iterator, size_t>& r) const {
-		if (r.second == seg::size(*r.first))
-			return const_segmented_coordinate(const_segment_iterator(r.first + 1), seg::begin(*(r.first + 1)));
-		return const_segmented_coordinate(const_segment_iterator(r.first), flat::successor(seg::cbegin(*r.first), r.second));
-	}
-	segmented_coordinate coordinate_unguarded(const std::pair<header_iterator, size_t>& r) {
-		if (r.second == seg::size(*r.first))
-			return segmented_coordinate(segment_iterator(r.first + 1), seg::begin(*(r.first + 1)));
-		return segmented_coordinate(segment_iterator(r.first), flat::successor(seg::begin(*r.first), r.second));
-	}
-	const_segmented_coordinate coordinate(const std::pair<header_iterator, size_t>& r) const {
-		if (r.first == std::end(in))
-			return const_segmented_coordinate(const_segment_iterator(r.first), seg::begin(*r.first));
-		return coordinate_unguarded(r);
-	}
-	segmented_coordinate coordinate(const std::pair<header_iterator, size_t>& r) {
-		if (r.first == std::end(in))
-			return segmented_coordinate(segment_iterator(r.first), seg::begin(*r.first));
-		return coordinate_unguarded(r);
-	}
+	struct deallocate_handle
+	{
+		pool_type* pool;
 
+		void operator()(header_type& h) {
+			pool->deallocate(handle(h));
+			set_handle(h, pool_type::null_handle);
+		}
+	};
 
-	segmented_coordinate __insert(std::pair<header_iterator, seg::size_t> it) {
-		segmented_coordinate _it = coordinate_unguarded(seg::insert_to_segment_range(in, it.first, it.second, 1).first);
-		s = s + 1;
-		return _it;
-	}
-	std::pair<segmented_coordinate, segmented_coordinate> __insert(std::pair<header_iterator, seg::size_t> it, size_type n) {
-		auto [_begin, _end] = seg::insert_to_segment_range(in, it.first, it.second, static_cast<seg::size_t>(n));
-		s = s + n;
-		return { coordinate_unguarded(_begin), coordinate_unguarded(_end) };
+	void _move_from(compact_header_index& other) {
+		edge_left = other.edge_left;
+		edge_right = other.edge_right;
+		other.headers = container();
+		other.init();
 	}
 
-
-	segmented_coordinate _insert(segmented_coordinate it) {
-		return __insert(header_from_coordinate(it));
-	}
-	std::pair<segmented_coordinate, segmented_coordinate> _insert(segmented_coordinate it, size_type n) {
-		return __insert(header_from_coordinate(it), n);
+	void move_from(compact_header_index&& other) {
+		headers = std::move(other.headers);
+		alloc = std::move(other.alloc);
+		pool = std::move(other.pool);
+		_move_from(other);
 	}
 
-
-	segmented_coordinate __erase(std::pair<header_iterator, seg::size_t> left, std::pair<header_iterator, seg::size_t> right) {
-		auto [it, i, _s] = seg::erase_from_segment_range(in, left.first, left.second, right.first, right.second);
-		s = s - _s;
-		return coordinate(std::make_pair(it, i));
+	// Areas of all segments are given back with the chunks of the pool
+	void destroy() {
+		pool.release();
 	}
 
-
-	segmented_coordinate _erase(segmented_coordinate left, segmented_coordinate right) {
-		return __erase(header_from_coordinate(left), header_from_coordinate(right));
+	void _init() {
+		std::tie(edge_left, edge_right) = middle_edges(headers);
+		set_handle(*edge_left, pool_type::null_handle);
+		set_begin_end_indices(*edge_left, capacity(*edge_left));
 	}
 
-
-	segmented_coordinate _erase(segmented_coordinate left) {
-		return __erase(header_from_coordinate(left), header_from_coordinate(successor(left, 1)));
+	void init() {
+		headers.resize(8);
+		_init();
 	}
 
-	void copy_from(const list_tmp& other) {
-		s = other.s;
-		seg::copy(std::begin(other), std::end(other), _insert(std::begin(in), s));
+	void allocate_handles(iterator first, size_type n) {
+		iterator _first = first;
+		size_type _n = n;
+		try {
+			size_t c = capacity(*first);
+			while (_n) {
+				set_handle(*_first, pool.allocate());
+				set_begin_end_indices(*_first, c);
+				++_first;
+				--_n;
+			}
+		}
+		catch (...) {
+			std::for_each(first, _first, deallocate_handle{ &pool });
+			iterator first_end = first + n;
+			flat::move_backward(edge_left, first, first_end);
+			edge_left = first_end - (first - edge_left);
+			throw;
+		}
 	}
 
 public:
-	list_tmp(allocator&& alloc = allocator()) : in(std::move(alloc)), s(0) {}
-	list_tmp(list_tmp&& other) : in(std::move(other.in)), s(std::move(other.s)), cmp(std::move(other.cmp)) {}
-	list_tmp(const allocator& alloc) : in(alloc), s(0) {}
-	list_tmp(const list_tmp& other) : in(other.in), s(other.s), cmp(other.cmp) { copy_from(other); }
-	~list_tmp() { clear(); }
+	compact_header_index(const allocator& alloc = allocator()) : alloc(alloc), pool(this->alloc) { init(); }
+	compact_header_index(allocator&& alloc) : alloc(std::move(alloc)), pool(this->alloc) { init(); }
+	compact_header_index(compact_header_index&& other) :
+		headers(std::move(other.headers)),
+		alloc(std::move(other.alloc)),
+		pool(std::move(other.pool))
+	{
+		_move_from(other);
+	}
+	compact_header_index(const compact_header_index& other) :
+		headers(copy_capacity(other.size())),
+		alloc(other.alloc),
+		pool(alloc)
+	{
+		_init();
+	}
+	~compact_header_index() { destroy(); }
 
-	list_tmp& operator=(list_tmp&& other) {
-		clear();
-		in = std::move(other.in);
-		s = std::move(other.s);
+	compact_header_index& operator=(compact_header_index&& other) {
+		if (this == &other) return *this;
+		destroy();
+		move_from(std::move(other));
 		return *this;
 	}
-	list_tmp& operator=(const list_tmp& other) {
-		clear();
-		copy_from(other);
+	compact_header_index& operator=(const compact_header_index& other) {
+		if (this == &other) return *this;
+		destroy();
+		headers.resize(copy_capacity(other.size()));
+		alloc = other.alloc;
+		pool = pool_type(alloc);
+		_init();
 		return *this;
 	}
 
-	friend
-	bool operator==(const list_tmp& x, const list_tmp& y) {
-		if (x.size() != y.size()) return false;
-		return seg::equal(std::cbegin(x), std::cend(x), std::cbegin(y));
+	iterator insert(iterator it, size_type n) {
+		// precondition: it belongs to [begin(), end()]
+		insert_headers(headers, edge_left, edge_right, it, n);
+		allocate_handles(it, n);
+		return it;
 	}
-	friend
-	bool operator!=(const list_tmp& x, const list_tmp& y) {
-		return !(x == y);
+
+	iterator erase(iterator first, iterator last) {
+		// precondition: [first, last] belongs to [begin(), end()]
+		std::for_each(first, last, deallocate_handle{ &pool });
+		std::tie(edge_left, edge_right, first) = erase_flat(edge_left, edge_right, first, last);
+		return first;
 	}
 
-	friend
-	bool operator<(const list_tmp& x, const list_tmp& y) {
-		return seg::lexicographical_compare(std::cbegin(x), std::cend(x), std::cbegin(y), std::cend(y)) < 0;
+	void clear() {
+		erase(begin(), end());
 	}
+
 	friend
-	bool operator>(const list_tmp& x, const list_tmp& y) {
-		return y < x;
+	iterator insert(compact_header_index& i, iterator it, size_type n) {
+		return i.insert(it, n);
 	}
+
 	friend
-	bool operator<=(const list_tmp& x, const list_tmp& y) {
-		return !(y < x);
+	iterator erase(compact_header_index& i, iterator first, iterator last) {
+		return i.erase(first, last);
 	}
+
 	friend
-	bool operator>=(const list_tmp& x, const list_tmp& y) {
-		return !(x < y);
+	iterator insert(compact_header_index& i, iterator it) {
+		return i.insert(it, 1);
 	}
 
-	bool empty() const { return in.empty(); }
+	friend
+	iterator erase(compact_header_index& i, iterator it) {
+		return i.erase(it, it + 1);
+	}
+
+	iterator begin() { return edge_left; }
+	const_iterator cbegin() const { return const_iterator(edge_left); }
+	const_iterator begin() const { return cbegin(); }
+
+	iterator end() { return edge_right - 1; }
+	const_iterator cend() const { return const_iterator(edge_right - 1); }
+	const_iterator end() const { return cend(); }
+
+	reverse_iterator rbegin() { return reverse_iterator(end()); }
+	const_reverse_iterator crbegin() const { return const_reverse_iterator(cend()); }
+	const_reverse_iterator rbegin() const { return crbegin(); }
+
+	reverse_iterator rend() { return reverse_iterator(begin()); }
+	const_reverse_iterator crend() const { return const_reverse_iterator(cbegin()); }
+	const_reverse_iterator rend() const { return crend(); }
+
+	size_t size() const { return static_cast<size_t>(end() - begin()); }
+	bool empty() const { return cbegin() == cend(); }
+};
+
+//************************************************************************
+// ~COMPACT INDEX
+//************************************************************************
+
+
+//************************************************************************
+// BLOCKED INDEX
+//************************************************************************
+
+// Two level alternative to keeping all "segment headers" in one vector.
+// "Segment headers" are held in "header blocks" of fixed capacity; "directory" is a small vector
+// which holds the blocks in order. Inserting or erasing headers shifts headers of only one block,
+// instead of the whole index; when a block overflows it's split, when it becomes empty it's removed.
+
+constexpr std::size_t default_header_block_capacity = 512u;
+
+// Deallocates an array of "n" headers through the allocator which allocated it
+template<typename A>
+// A models Allocator
+struct header_array_deleter
+{
+	A alloc;
+	std::size_t n = 0;
+
+	void operator()(ValueType<A>* p) { alloc.deallocate(p, n); }
+};
+
+template<typename H, typename A>
+// H models SegmentHeader
+// A models Allocator
+using header_array = std::unique_ptr<H[], header_array_deleter<AllocatorRebindType<A, H>>>;
+
+// Allocates an array of "n" headers through "alloc"
+template<typename H, typename A>
+// H models SegmentHeader
+// A models Allocator
+header_array<H, A> allocate_headers(const A& alloc, std::size_t n) {
+	AllocatorRebindType<A, H> _alloc(alloc);
+	H* p = _alloc.allocate(n);
+	std::uninitialized_default_construct_n(p, n);
+	return header_array<H, A>(p, header_array_deleter<AllocatorRebindType<A, H>>{ std::move(_alloc), n });
+}
+
+template<typename H, typename A>
+// H models SegmentHeader
+// A models Allocator
+struct header_block
+{
+	header_array<H, A> headers;
+	std::size_t size;
+	// number of headers held by all of the blocks before this one
+	std::size_t prefix;
+};
+
+template<typename H, typename D>
+// H models SegmentHeader
+// D models Sequence
+// ValueType<D> == header_block<std::remove_const_t<H>, A>, for some allocator A
+struct blocked_header_iterator
+{
+	using directory = D;
+	using block_type = ValueType<directory>;
+	using value_type = std::remove_const_t<H>;
+	using difference_type = std::ptrdiff_t;
+	using pointer = H*;
+	using reference = H&;
+	using iterator_category = std::random_access_iterator_tag;
+
+	// Only the last block may be pointed to by an iterator which points to the end of a block
+	const directory* d;
+	const block_type* b;
+	H* h;
+
+	blocked_header_iterator() = default;
+	blocked_header_iterator(const directory* d, const block_type* b, H* h) : d(d), b(b), h(h) {}
+	template<typename H0, typename = std::enable_if_t<std::is_convertible_v<H0*, H*>>>
+	blocked_header_iterator(const blocked_header_iterator<H0, D>& x) : d(x.d), b(x.b), h(x.h) {}
+
+	const block_type* first_block() const { return d->data(); }
+	const block_type* last_block() const { return d->data() + (d->size() - 1); }
+
+	std::size_t position() const { return b->prefix + static_cast<std::size_t>(h - b->headers.get()); }
+
+	static
+	blocked_header_iterator locate(const directory* d, std::size_t p) {
+		// precondition: p belongs to [0, number of headers in d]
+		const block_type* first = d->data();
+		const block_type* last = first + d->size();
+		const block_type* b = std::upper_bound(first, last, p,
+			[](std::size_t p, const block_type& x) { return p < x.prefix; }) - 1;
+		return blocked_header_iterator(d, b, b->headers.get() + (p - b->prefix));
+	}
+
+	reference operator*() const { return *h; }
+	pointer operator->() const { return h; }
+	reference operator[](difference_type n) const { return *(*this + n); }
+
+	friend
+	bool operator==(const blocked_header_iterator& x, const blocked_header_iterator& y) {
+		return x.h == y.h && x.b == y.b;
+	}
+
+	friend
+	bool operator!=(const blocked_header_iterator& x, const blocked_header_iterator& y) {
+		return !(x == y);
+	}
+
+	friend
+	bool operator<(const blocked_header_iterator& x, const blocked_header_iterator& y) {
+		return x.b < y.b || (x.b == y.b && x.h < y.h);
+	}
+
+	friend
+	bool operator>=(const blocked_header_iterator& x, const blocked_header_iterator& y) {
+		return !(x < y);
+	}
+
+	friend
+	bool operator>(const blocked_header_iterator& x, const blocked_header_iterator& y) {
+		return y < x;
+	}
+
+	friend
+	bool operator<=(const blocked_header_iterator& x, const blocked_header_iterator& y) {
+		return !(y < x);
+	}
+
+	blocked_header_iterator& operator++() {
+		++h;
+		if (h == b->headers.get() + b->size && b != last_block()) {
+			++b;
+			h = b->headers.get();
+		}
+		return *this;
+	}
+	blocked_header_iterator operator++(int) {
+		blocked_header_iterator tmp = *this;
+		++*this;
+		return tmp;
+	}
+	blocked_header_iterator& operator--() {
+		if (h == b->headers.get()) {
+			--b;
+			h = b->headers.get() + b->size;
+		}
+		--h;
+		return *this;
+	}
+	blocked_header_iterator operator--(int) {
+		blocked_header_iterator tmp = *this;
+		--*this;
+		return tmp;
+	}
+
+	blocked_header_iterator operator+(difference_type n) const {
+		difference_type i = (h - b->headers.get()) + n;
+		if (0 <= i && i < static_cast<difference_type>(b->size))
+			return blocked_header_iterator(d, b, b->headers.get() + i);
+		return locate(d, static_cast<std::size_t>(static_cast<difference_type>(position()) + n));
+	}
+	friend
+	blocked_header_iterator operator+(difference_type n, const blocked_header_iterator& x) {
+		return x + n;
+	}
+	blocked_header_iterator operator-(difference_type n) const {
+		return *this + (-n);
+	}
+
+	blocked_header_iterator& operator+=(difference_type n) {
+		*this = *this + n;
+		return *this;
+	}
+	blocked_header_iterator& operator-=(difference_type n) {
+		*this = *this - n;
+		return *this;
+	}
+
+	friend
+	difference_type operator-(const blocked_header_iterator& x, const blocked_header_iterator& y) {
+		return static_cast<difference_type>(x.position()) - static_cast<difference_type>(y.position());
+	}
+};
+
+// Data structure responsible for holding all "segment headers" and allocating and deallocating
+// "segment areas"; headers are held in "header blocks" of capacity B.
+template<typename T, std::size_t C, typename A, std::size_t B = default_header_block_capacity>
+// T models
+// A models Allocator
+// B > 1
+class blocked_header_index
+{
+public:
+	using header_type = big_segment_header<T, C>;
+	using value_type = ValueType<header_type>;
+	using area_type = AreaType<header_type>;
+	using block_type = header_block<header_type, A>;
+	using directory = std::vector<block_type>;
+	using iterator = blocked_header_iterator<header_type, directory>;
+	using const_iterator = blocked_header_iterator<const header_type, directory>;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+	using size_type = std::size_t;
+	using allocator = AllocatorRebindType<A, area_type>;
+	constexpr static size_t segment_capacity = header_type::capacity;
+	constexpr static size_type block_capacity = B;
+
+	// Directory is held on the heap, so that iterators, which point to it, stay valid when the index is moved
+	std::unique_ptr<directory> blocks;
+	allocator alloc;
+
+	block_type create_block() {
+		return block_type{ allocate_headers<header_type>(alloc, B), 0, 0 };
+	}
+
+	// number of headers, including the "edge last" header
+	size_type headers_size() const { return blocks->back().prefix + blocks->back().size; }
+
+	iterator iterator_at(size_type p) { return iterator::locate(blocks.get(), p); }
+	const_iterator iterator_at(size_type p) const { return const_iterator::locate(blocks.get(), p); }
+
+	size_type block_at(size_type p) const {
+		return static_cast<size_type>(iterator_at(p).b - blocks->data());
+	}
+
+	void update_prefixes(size_type first_block) {
+		size_type prefix = first_block ? (*blocks)[first_block - 1].prefix + (*blocks)[first_block - 1].size : 0;
+		for (size_type i = first_block; i < blocks->size(); ++i) {
+			(*blocks)[i].prefix = prefix;
+			prefix = prefix + (*blocks)[i].size;
+		}
+	}
+
+	// Inserts n headers before position p; only the block holding p is changed, unless it overflows,
+	// in which case its headers and the new ones are distributed evenly into as few blocks as needed.
+	void insert_headers(size_type p, size_type n) {
+		size_type bi = block_at(p);
+		block_type& b = (*blocks)[bi];
+		size_type i = p - b.prefix;
+		header_type* first = b.headers.get();
+		if (b.size + n <= B) {
+			std::move_backward(first + i, first + b.size, first + b.size + n);
+			std::fill_n(first + i, n, header_type{});
+			b.size = b.size + n;
+		}
+		else {
+			std::vector<header_type> tmp;
+			tmp.reserve(b.size + n);
+			tmp.insert(tmp.end(), first, first + i);
+			tmp.insert(tmp.end(), n, header_type{});
+			tmp.insert(tmp.end(), first + i, first + b.size);
+
+			size_type blocks_nm = (tmp.size() + B - 1) / B;
+			for (size_type j = 1; j < blocks_nm; ++j)
+				blocks->insert(blocks->begin() + (bi + j), create_block());
+
+			auto [q, r] = division_with_remainder(tmp.size(), blocks_nm);
+			auto it = tmp.begin();
+			for (size_type j = 0; j < blocks_nm; ++j) {
+				block_type& _b = (*blocks)[bi + j];
+				_b.size = q + (j < r);
+				std::copy_n(it, _b.size, _b.headers.get());
+				it = it + _b.size;
+			}
+		}
+		update_prefixes(bi);
+	}
+
+	// Erases headers in the positions [p, p + n); blocks which become empty are removed and the
+	// block in which the erased range ended is merged with its neighbours, if they fit into half a block.
+	void erase_headers(size_type p, size_type n) {
+		if (n == 0) return;
+		size_type bi = block_at(p);
+		size_type bl = bi;
+		size_type i = p - (*blocks)[bi].prefix;
+		while (n) {
+			block_type& b = (*blocks)[bl];
+			size_type m = std::min(n, b.size - i);
+			header_type* first = b.headers.get();
+			std::move(first + i + m, first + b.size, first + i);
+			b.size = b.size - m;
+			n = n - m;
+			i = 0;
+			++bl;
+		}
+		blocks->erase(
+			std::remove_if(blocks->begin() + bi, blocks->begin() + bl, [](const block_type& b) { return b.size == 0; }),
+			blocks->begin() + bl);
+		bi = std::min(bi, blocks->size() - 1);
+		if (bi + 1 < blocks->size()) merge_blocks(bi);
+		if (bi > 0 && merge_blocks(bi - 1)) --bi;
+		update_prefixes(bi);
+	}
+
+	bool merge_blocks(size_type bi) {
+		block_type& x = (*blocks)[bi];
+		block_type& y = (*blocks)[bi + 1];
+		if (x.size + y.size > (B >> 1)) return false;
+		std::copy_n(y.headers.get(), y.size, x.headers.get() + x.size);
+		x.size = x.size + y.size;
+		blocks->erase(blocks->begin() + (bi + 1));
+		return true;
+	}
+
+	void allocate_areas(size_type p, size_type n) {
+		iterator first = iterator_at(p);
+		size_type _n = n;
+		try {
+			size_t c = capacity(*first);
+			while (_n) {
+				set_area(*first, alloc.allocate(1));
+				set_begin_end_indices(*first, c);
+				++first;
+				--_n;
+			}
+		}
+		catch (...) {
+			_n = n - _n;
+			first = iterator_at(p);
+			while (_n) {
+				alloc.deallocate(area(*first), 1);
+				--_n;
+				++first;
+			}
+			erase_headers(p, n);
+			throw;
+		}
+	}
+
+	void destroy() {
+		if (blocks)
+			std::for_each(begin(), end(), deallocate_area<allocator>(alloc));
+	}
+
+	void init() {
+		blocks = std::make_unique<directory>();
+		blocks->push_back(create_block());
+		header_type& h = blocks->front().headers[0];
+		set_area(h, nullptr);
+		set_begin_end_indices(h, capacity(h));
+		blocks->front().size = 1;
+	}
+
+public:
+	blocked_header_index(const allocator& alloc = allocator()) : alloc(alloc) { init(); }
+	blocked_header_index(allocator&& alloc) : alloc(std::move(alloc)) { init(); }
+	blocked_header_index(blocked_header_index&& other) :
+		blocks(std::move(other.blocks)),
+		alloc(std::move(other.alloc))
+	{
+		other.init();
+	}
+	blocked_header_index(const blocked_header_index& other) :
+		alloc(other.alloc)
+	{
+		init();
+	}
+	~blocked_header_index() { destroy(); }
+
+	blocked_header_index& operator=(blocked_header_index&& other) {
+		if (this == &other) return *this;
+		destroy();
+		blocks = std::move(other.blocks);
+		alloc = std::move(other.alloc);
+		other.init();
+		return *this;
+	}
+	blocked_header_index& operator=(const blocked_header_index& other) {
+		if (this == &other) return *this;
+		destroy();
+		alloc = other.alloc;
+		init();
+		return *this;
+	};
+
+	iterator insert(iterator it, size_type n) {
+		// precondition: it belongs to [begin(), end()]
+		size_type p = it.position();
+		if (n) {
+			insert_headers(p, n);
+			allocate_areas(p, n);
+		}
+		return iterator_at(p);
+	}
+
+	iterator erase(iterator first, iterator last) {
+		// precondition: [first, last] belongs to [begin(), end()]
+		size_type p = first.position();
+		std::for_each(first, last, deallocate_area<allocator>(alloc));
+		erase_headers(p, static_cast<size_type>(last - first));
+		return iterator_at(p);
+	}
+
+	void clear() {
+		erase(begin(), end());
+	}
+
+	friend
+	iterator insert(blocked_header_index& i, iterator it, size_type n) {
+		return i.insert(it, n);
+	}
+
+	friend
+	iterator erase(blocked_header_index& i, iterator first, iterator last) {
+		return i.erase(first, last);
+	}
+
+	friend
+	iterator insert(blocked_header_index& i, iterator it) {
+		return i.insert(it, 1);
+	}
+
+	friend
+	iterator erase(blocked_header_index& i, iterator it) {
+		return i.erase(it, it + 1);
+	}
+
+	size_type blocks_size() const { return blocks->size(); }
+
+	iterator begin() { return iterator(blocks.get(), blocks->data(), blocks->front().headers.get()); }
+	const_iterator cbegin() const { return const_iterator(blocks.get(), blocks->data(), blocks->front().headers.get()); }
+	const_iterator begin() const { return cbegin(); }
+
+	iterator end() { return iterator(blocks.get(), &blocks->back(), blocks->back().headers.get() + (blocks->back().size - 1)); }
+	const_iterator cend() const { return const_iterator(blocks.get(), &blocks->back(), blocks->back().headers.get() + (blocks->back().size - 1)); }
+	const_iterator end() const { return cend(); }
+
+	reverse_iterator rbegin() { return reverse_iterator(end()); }
+	const_reverse_iterator crbegin() const { return const_reverse_iterator(cend()); }
+	const_reverse_iterator rbegin() const { return crbegin(); }
+
+	reverse_iterator rend() { return reverse_iterator(begin()); }
+	const_reverse_iterator crend() const { return const_reverse_iterator(cbegin()); }
+	const_reverse_iterator rend() const { return crend(); }
+
+	size_t size() const { return headers_size() - 1; }
+	bool empty() const { return size() == 0; }
+};
+
+//************************************************************************
+// ~BLOCKED INDEX
+//************************************************************************
+
+
+//************************************************************************
+// GAPPED INDEX
+//************************************************************************
+
+// Packed memory array of "segment headers". Headers are held in a single vector which is divided into
+// "leaves" of 64 positions; empty positions(gaps) are spread evenly between the headers and a bit mask
+// per leaf tells which positions hold headers. Inserting headers redistributes only the smallest aligned
+// window of leaves which isn't too dense, so O(log^2(n)) headers are moved amortized, instead of half
+// the index. Erasing headers only clears their bits, unless a leaf becomes too sparse.
+// Iterators of the index skip the gaps.
+
+constexpr std::size_t gapped_leaf_capacity = 64u;
+
+template<typename H>
+// H models SegmentHeader
+struct gapped_headers
+{
+	using mask_type = std::uint64_t;
+	static constexpr std::size_t leaf_capacity = gapped_leaf_capacity;
+
+	std::vector<H> headers;
+	std::vector<mask_type> masks;
+	// Fenwick tree over the numbers of headers held by the leaves; element "i" is the number of headers
+	// held by the leaves [i - lowest_bit(i), i). It has one element more than "masks".
+	std::vector<std::size_t> tree;
+	std::size_t total;
+	// positions of the first header and of the "edge last" header
+	std::size_t first;
+	std::size_t last;
+
+	std::size_t leaves() const { return masks.size(); }
+	std::size_t count() const { return total; }
+	std::size_t leaf_count(std::size_t l) const { return popcount(masks[l]); }
+
+	void reset(std::size_t leaves) {
+		masks.assign(leaves, 0);
+		tree.assign(leaves + 1, 0);
+		total = 0;
+	}
+
+	// Adds "d" to the number of headers held by leaf "l"
+	void add(std::size_t l, std::ptrdiff_t d) {
+		total = total + static_cast<std::size_t>(d);
+		for (++l; l < tree.size(); l = l + (l & (0 - l)))
+			tree[l] = tree[l] + static_cast<std::size_t>(d);
+	}
+
+	// Number of headers held by all of the leaves before leaf "l"
+	std::size_t prefix(std::size_t l) const {
+		std::size_t s = 0;
+		for (; l; l = l & (l - 1)) s = s + tree[l];
+		return s;
+	}
+
+	// Position of the "k"-th header of leaf "l"
+	std::size_t select_in_leaf(std::size_t l, std::size_t k) const {
+		// precondition: k < leaf_count(l)
+		mask_type m = masks[l];
+		std::size_t i = 0;
+		// Bytes of the mask are skipped whole, then bits of the last byte are cleared one by one
+		for (std::size_t c = popcount(m & 0xFFu); c <= k; c = popcount(m & 0xFFu)) {
+			k = k - c;
+			m = m >> 8;
+			i = i + 8;
+		}
+		for (; k; --k) m = m & (m - 1);
+		return l * leaf_capacity + i + count_trailing_zeros(m);
+	}
+
+	// Position of the first header after position "p"; size of "headers" if there isn't one
+	std::size_t next(std::size_t p) const {
+		std::size_t l = p / leaf_capacity;
+		std::size_t i = p % leaf_capacity + 1;
+		mask_type m = i < leaf_capacity ? masks[l] >> i << i : 0;
+		while (m == 0) {
+			if (++l == leaves()) return headers.size();
+			m = masks[l];
+		}
+		return l * leaf_capacity + count_trailing_zeros(m);
+	}
+
+	// Position of the last header before position "p"
+	std::size_t previous(std::size_t p) const {
+		// precondition: there is a header before "p"
+		std::size_t l = p / leaf_capacity;
+		mask_type m = l < leaves() ? masks[l] & ((mask_type(1) << (p % leaf_capacity)) - 1) : 0;
+		while (m == 0) m = masks[--l];
+		return l * leaf_capacity + log2_floor(m);
+	}
+
+	// Number of headers before position "p"
+	std::size_t rank(std::size_t p) const {
+		if (p == headers.size()) return count();
+		std::size_t l = p / leaf_capacity;
+		return prefix(l) + popcount(masks[l] & ((mask_type(1) << (p % leaf_capacity)) - 1));
+	}
+
+	// Position of the header with rank "r"; size of "headers" if "r" is the number of headers.
+	// Leaf is found by descending the Fenwick tree; the number of leaves is a power of two.
+	std::size_t select(std::size_t r) const {
+		if (r == count()) return headers.size();
+		std::size_t l = 0;
+		for (std::size_t b = leaves(); b; b = b >> 1) {
+			if (l + b < tree.size() && tree[l + b] <= r) {
+				l = l + b;
+				r = r - tree[l];
+			}
+		}
+		return select_in_leaf(l, r);
+	}
+
+	// Position of the header "n" headers away from the one at position "p"; leaf of "p" is tried first,
+	// before selecting by rank
+	std::size_t advance(std::size_t p, std::ptrdiff_t n) const {
+		std::size_t l = p / leaf_capacity;
+		if (l < leaves()) {
+			std::ptrdiff_t k = static_cast<std::ptrdiff_t>(popcount(masks[l] & ((mask_type(1) << (p % leaf_capacity)) - 1))) + n;
+			if (0 <= k && k < static_cast<std::ptrdiff_t>(leaf_count(l))) return select_in_leaf(l, static_cast<std::size_t>(k));
+		}
+		return select(static_cast<std::size_t>(static_cast<std::ptrdiff_t>(rank(p)) + n));
+	}
+};
+
+template<typename H, typename G>
+// H models SegmentHeader
+// G == gapped_headers<std::remove_const_t<H>>
+struct gapped_header_iterator
+{
+	using value_type = std::remove_const_t<H>;
+	using difference_type = std::ptrdiff_t;
+	using pointer = H*;
+	using reference = H&;
+	using iterator_category = std::random_access_iterator_tag;
+
+	// Increments and decrements by at most this much step over the gaps, instead of selecting by rank
+	static constexpr difference_type step_limit = 8;
+
+	const G* g;
+	H* h;
+
+	gapped_header_iterator() = default;
+	gapped_header_iterator(const G* g, H* h) : g(g), h(h) {}
+	template<typename H0, typename = std::enable_if_t<std::is_convertible_v<H0*, H*>>>
+	gapped_header_iterator(const gapped_header_iterator<H0, G>& x) : g(x.g), h(x.h) {}
+
+	std::size_t position() const { return static_cast<std::size_t>(h - g->headers.data()); }
+
+	gapped_header_iterator moved_to(std::size_t p) const {
+		return gapped_header_iterator(g, h + (static_cast<difference_type>(p) - static_cast<difference_type>(position())));
+	}
+
+	reference operator*() const { return *h; }
+	pointer operator->() const { return h; }
+	reference operator[](difference_type n) const { return *(*this + n); }
+
+	friend
+	bool operator==(const gapped_header_iterator& x, const gapped_header_iterator& y) {
+		return x.h == y.h;
+	}
+
+	friend
+	bool operator!=(const gapped_header_iterator& x, const gapped_header_iterator& y) {
+		return !(x == y);
+	}
+
+	friend
+	bool operator<(const gapped_header_iterator& x, const gapped_header_iterator& y) {
+		return x.h < y.h;
+	}
+
+	friend
+	bool operator>=(const gapped_header_iterator& x, const gapped_header_iterator& y) {
+		return !(x < y);
+	}
+
+	friend
+	bool operator>(const gapped_header_iterator& x, const gapped_header_iterator& y) {
+		return y < x;
+	}
+
+	friend
+	bool operator<=(const gapped_header_iterator& x, const gapped_header_iterator& y) {
+		return !(y < x);
+	}
+
+	gapped_header_iterator& operator++() {
+		*this = moved_to(g->next(position()));
+		return *this;
+	}
+	gapped_header_iterator operator++(int) {
+		gapped_header_iterator tmp = *this;
+		++*this;
+		return tmp;
+	}
+	gapped_header_iterator& operator--() {
+		*this = moved_to(g->previous(position()));
+		return *this;
+	}
+	gapped_header_iterator operator--(int) {
+		gapped_header_iterator tmp = *this;
+		--*this;
+		return tmp;
+	}
+
+	gapped_header_iterator operator+(difference_type n) const {
+		gapped_header_iterator tmp = *this;
+		if (0 <= n && n <= step_limit) {
+			while (n) { ++tmp; --n; }
+			return tmp;
+		}
+		if (-step_limit <= n && n < 0) {
+			while (n) { --tmp; ++n; }
+			return tmp;
+		}
+		return moved_to(g->advance(position(), n));
+	}
+	friend
+	gapped_header_iterator operator+(difference_type n, const gapped_header_iterator& x) {
+		return x + n;
+	}
+	gapped_header_iterator operator-(difference_type n) const {
+		return *this + (-n);
+	}
+
+	gapped_header_iterator& operator+=(difference_type n) {
+		*this = *this + n;
+		return *this;
+	}
+	gapped_header_iterator& operator-=(difference_type n) {
+		*this = *this - n;
+		return *this;
+	}
+
+	friend
+	difference_type operator-(const gapped_header_iterator& x, const gapped_header_iterator& y) {
+		return static_cast<difference_type>(x.g->rank(x.position())) - static_cast<difference_type>(y.g->rank(y.position()));
+	}
+};
+
+// Data structure responsible for holding all "segment headers" and allocating and deallocating
+// "segment areas"; headers are held in a packed memory array.
+// Window of 2^d leaves may hold at most (1 - d / 2h) and, when it's not the only leaf, at least (1 + d / h) / 16 of
+// its positions, where h is the height of the array; array grows twice when the root window gets more than
+// half full and shrinks twice when it gets less than 1/8 full.
+template<typename T, std::size_t C, typename A>
+// T models
+// A models Allocator
+class gapped_header_index
+{
+public:
+	using header_type = big_segment_header<T, C>;
+	using value_type = ValueType<header_type>;
+	using area_type = AreaType<header_type>;
+	using layout = gapped_headers<header_type>;
+	using mask_type = typename layout::mask_type;
+	using iterator = gapped_header_iterator<header_type, layout>;
+	using const_iterator = gapped_header_iterator<const header_type, layout>;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+	using size_type = std::size_t;
+	using allocator = AllocatorRebindType<A, area_type>;
+	constexpr static size_t segment_capacity = header_type::capacity;
+	constexpr static size_type leaf_capacity = layout::leaf_capacity;
+
+	// Layout is held on the heap, so that iterators, which point to it, stay valid when the index is moved
+	std::unique_ptr<layout> g;
+	// headers of the window which is being redistributed
+	std::vector<header_type> buffer;
+	allocator alloc;
+
+	size_type height() const { return log2_floor(g->leaves()); }
+
+	// Largest number of headers a window of 2^d leaves may hold
+	static
+	size_type upper_limit(size_type d, size_type h) {
+		size_type c = leaf_capacity << d;
+		return h == 0 ? c : c * (2 * h - d) / (2 * h);
+	}
+
+	// Smallest number of headers a window of 2^d leaves may hold
+	static
+	size_type lower_limit(size_type d, size_type h) {
+		size_type c = leaf_capacity << d;
+		return h == 0 ? 0 : c * (h + d) / (16 * h);
+	}
+
+	iterator iterator_at(size_type p) { return iterator(g.get(), g->headers.data() + p); }
+	const_iterator iterator_at(size_type p) const { return const_iterator(g.get(), g->headers.data() + p); }
+
+	// Number of headers held by the leaves [first_leaf, last_leaf)
+	size_type window_count(size_type first_leaf, size_type last_leaf) const {
+		return g->prefix(last_leaf) - g->prefix(first_leaf);
+	}
+
+	void update_edges() {
+		g->first = g->select(0);
+		g->last = g->previous(g->headers.size());
+	}
+
+	void resize(size_type leaves) {
+		g->headers.resize(leaves * leaf_capacity);
+		g->reset(leaves);
+	}
+
+	// Copies headers of the leaves [first_leaf, last_leaf) into "buffer"; "n" empty headers are put
+	// before the header with rank "r"
+	void gather(size_type first_leaf, size_type last_leaf, size_type r, size_type n) {
+		buffer.clear();
+		size_type rank = g->prefix(first_leaf);
+		for (size_type l = first_leaf; l < last_leaf; ++l) {
+			mask_type m = g->masks[l];
+			while (m) {
+				if (rank == r) buffer.insert(buffer.end(), n, header_type{});
+				buffer.push_back(g->headers[l * leaf_capacity + count_trailing_zeros(m)]);
+				m = m & (m - 1);
+				++rank;
+			}
+		}
+		if (rank == r) buffer.insert(buffer.end(), n, header_type{});
+	}
+
+	// Spreads headers from "buffer" evenly over the leaves [first_leaf, last_leaf)
+	void spread(size_type first_leaf, size_type last_leaf) {
+		size_type c = (last_leaf - first_leaf) * leaf_capacity;
+		size_type m = buffer.size();
+		size_type offset = first_leaf * leaf_capacity;
+		for (size_type l = first_leaf; l < last_leaf; ++l) {
+			g->add(l, -static_cast<std::ptrdiff_t>(g->leaf_count(l)));
+			g->masks[l] = 0;
+		}
+		for (size_type j = 0; j < m; ++j) {
+			size_type p = offset + j * c / m;
+			g->headers[p] = buffer[j];
+			g->masks[p / leaf_capacity] |= mask_type(1) << (p % leaf_capacity);
+		}
+		for (size_type l = first_leaf; l < last_leaf; ++l)
+			g->add(l, static_cast<std::ptrdiff_t>(g->leaf_count(l)));
+	}
+
+	// Changes the number of leaves so the root window is between 1/8 and 1/2 full and spreads all headers over them
+	void rebuild(size_type r, size_type n) {
+		gather(0, g->leaves(), r, n);
+		size_type leaves = g->leaves();
+		while (buffer.size() > upper_limit(log2_floor(leaves), log2_floor(leaves))) leaves = leaves << 1;
+		while (leaves > 1 && buffer.size() < lower_limit(log2_floor(leaves), log2_floor(leaves))) leaves = leaves >> 1;
+		resize(leaves);
+		spread(0, leaves);
+	}
+
+	// Inserts "n" headers before the header with rank "r"
+	void insert_headers(size_type r, size_type n) {
+		size_type h = height();
+		size_type leaf = g->select(r) / leaf_capacity;
+		for (size_type d = 0; d <= h; ++d) {
+			size_type first_leaf = leaf >> d << d;
+			size_type last_leaf = first_leaf + (size_type(1) << d);
+			if (window_count(first_leaf, last_leaf) + n <= upper_limit(d, h)) {
+				gather(first_leaf, last_leaf, r, n);
+				spread(first_leaf, last_leaf);
+				update_edges();
+				return;
+			}
+		}
+		rebuild(r, n);
+		update_edges();
+	}
+
+	// Erases "n" headers, starting with the one with rank "r"
+	void erase_headers(size_type r, size_type n) {
+		if (n == 0) return;
+		size_type p = g->select(r);
+		size_type first_leaf = p / leaf_capacity;
+		size_type last_leaf = first_leaf;
+		while (n) {
+			last_leaf = p / leaf_capacity;
+			g->masks[last_leaf] &= ~(mask_type(1) << (p % leaf_capacity));
+			g->add(last_leaf, -1);
+			p = g->next(p);
+			--n;
+		}
+		rebalance(first_leaf, last_leaf + 1);
+		update_edges();
+	}
+
+	// Redistributes the smallest windows around the leaves [first_leaf, last_leaf) which became too sparse
+	void rebalance(size_type first_leaf, size_type last_leaf) {
+		size_type h = height();
+		if (h == 0) return;
+		size_type l = first_leaf;
+		while (l < last_leaf) {
+			if (g->leaf_count(l) >= lower_limit(0, h)) {
+				++l;
+				continue;
+			}
+			size_type d = 1;
+			while (d <= h && window_count(l >> d << d, (l >> d << d) + (size_type(1) << d)) < lower_limit(d, h)) ++d;
+			if (d > h) {
+				rebuild(0, 0);
+				return;
+			}
+			size_type _first_leaf = l >> d << d;
+			size_type _last_leaf = _first_leaf + (size_type(1) << d);
+			gather(_first_leaf, _last_leaf, 0, 0);
+			spread(_first_leaf, _last_leaf);
+			l = _last_leaf;
+		}
+	}
+
+	void allocate_areas(size_type r, size_type n) {
+		iterator first = iterator_at(g->select(r));
+		size_type _n = n;
+		try {
+			size_t c = capacity(*first);
+			while (_n) {
+				set_area(*first, alloc.allocate(1));
+				set_begin_end_indices(*first, c);
+				++first;
+				--_n;
+			}
+		}
+		catch (...) {
+			_n = n - _n;
+			first = iterator_at(g->select(r));
+			while (_n) {
+				alloc.deallocate(area(*first), 1);
+				--_n;
+				++first;
+			}
+			erase_headers(r, n);
+			throw;
+		}
+	}
+
+	void destroy() {
+		if (g)
+			std::for_each(begin(), end(), deallocate_area<allocator>(alloc));
+	}
+
+	void init() {
+		g = std::make_unique<layout>();
+		resize(1);
+		header_type h;
+		set_area(h, nullptr);
+		set_begin_end_indices(h, capacity(h));
+		buffer.assign(1, h);
+		spread(0, 1);
+		update_edges();
+	}
+
+public:
+	gapped_header_index(const allocator& alloc = allocator()) : alloc(alloc) { init(); }
+	gapped_header_index(allocator&& alloc) : alloc(std::move(alloc)) { init(); }
+	gapped_header_index(gapped_header_index&& other) :
+		g(std::move(other.g)),
+		alloc(std::move(other.alloc))
+	{
+		other.init();
+	}
+	gapped_header_index(const gapped_header_index& other) :
+		alloc(other.alloc)
+	{
+		init();
+	}
+	~gapped_header_index() { destroy(); }
+
+	gapped_header_index& operator=(gapped_header_index&& other) {
+		if (this == &other) return *this;
+		destroy();
+		g = std::move(other.g);
+		alloc = std::move(other.alloc);
+		other.init();
+		return *this;
+	}
+	gapped_header_index& operator=(const gapped_header_index& other) {
+		if (this == &other) return *this;
+		destroy();
+		alloc = other.alloc;
+		init();
+		return *this;
+	}
+
+	iterator insert(iterator it, size_type n) {
+		// precondition: it belongs to [begin(), end()]
+		size_type r = g->rank(it.position());
+		if (n) {
+			insert_headers(r, n);
+			allocate_areas(r, n);
+		}
+		return iterator_at(g->select(r));
+	}
+
+	iterator erase(iterator first, iterator last) {
+		// precondition: [first, last] belongs to [begin(), end()]
+		size_type r = g->rank(first.position());
+		size_type n = static_cast<size_type>(last - first);
+		std::for_each(first, last, deallocate_area<allocator>(alloc));
+		erase_headers(r, n);
+		return iterator_at(g->select(r));
+	}
+
+	void clear() {
+		erase(begin(), end());
+	}
+
+	friend
+	iterator insert(gapped_header_index& i, iterator it, size_type n) {
+		return i.insert(it, n);
+	}
+
+	friend
+	iterator erase(gapped_header_index& i, iterator first, iterator last) {
+		return i.erase(first, last);
+	}
+
+	friend
+	iterator insert(gapped_header_index& i, iterator it) {
+		return i.insert(it, 1);
+	}
+
+	friend
+	iterator erase(gapped_header_index& i, iterator it) {
+		return i.erase(it, it + 1);
+	}
+
+	// Number of positions(headers and gaps) in the array
+	size_type headers_capacity() const { return g->headers.size(); }
+
+	iterator begin() { return iterator_at(g->first); }
+	const_iterator cbegin() const { return iterator_at(g->first); }
+	const_iterator begin() const { return cbegin(); }
+
+	iterator end() { return iterator_at(g->last); }
+	const_iterator cend() const { return iterator_at(g->last); }
+	const_iterator end() const { return cend(); }
+
+	reverse_iterator rbegin() { return reverse_iterator(end()); }
+	const_reverse_iterator crbegin() const { return const_reverse_iterator(cend()); }
+	const_reverse_iterator rbegin() const { return crbegin(); }
+
+	reverse_iterator rend() { return reverse_iterator(begin()); }
+	const_reverse_iterator crend() const { return const_reverse_iterator(cbegin()); }
+	const_reverse_iterator rend() const { return crend(); }
+
+	size_t size() const { return g->count() - 1; }
+	bool empty() const { return size() == 0; }
+};
+
+//************************************************************************
+// ~GAPPED INDEX
+//************************************************************************
+
+
+//************************************************************************
+// GROWING INDEX
+//************************************************************************
+
+// Alternative to "big_header_index" which doesn't grow the buffer of headers in one step.
+// When the buffer gets full a twice larger one is allocated, uninitialized, and headers are moved into it
+// from the front of the old buffer, a bounded number on every following insertion or erasure.
+// Until all of them are moved, headers with the smallest ranks are in the new buffer and the rest are in the old one.
+
+template<typename H, typename A>
+// H models SegmentHeader
+// A models Allocator
+struct growing_headers
+{
+	// used range of "current" is [first, last), and used range of "next" is [next_first, next_last);
+	// "next" is empty and both "next_first" and "next_last" are null when the index isn't growing
+	header_array<H, A> current;
+	std::size_t current_size = 0;
+	H* first = nullptr;
+	H* last = nullptr;
+	header_array<H, A> next;
+	std::size_t next_size = 0;
+	H* next_first = nullptr;
+	H* next_last = nullptr;
+
+	bool growing() const { return next != nullptr; }
+
+	// Number of headers which were moved to "next"
+	std::size_t moved() const { return static_cast<std::size_t>(next_last - next_first); }
+	std::size_t count() const { return moved() + static_cast<std::size_t>(last - first); }
+	std::size_t available() const { return current_size - static_cast<std::size_t>(last - first); }
+
+	bool in_next(const H* h) const {
+		return !std::less<const H*>()(h, next_first) && std::less<const H*>()(h, next_last);
+	}
+
+	std::size_t rank(const H* h) const {
+		if (in_next(h)) return static_cast<std::size_t>(h - next_first);
+		return moved() + static_cast<std::size_t>(h - first);
+	}
+
+	H* select(std::size_t r) const {
+		std::size_t m = moved();
+		return r < m ? next_first + r : first + (r - m);
+	}
+};
+
+template<typename H, typename G>
+// H models SegmentHeader
+// G == growing_headers<std::remove_const_t<H>, A>, for some allocator A
+struct growing_header_iterator
+{
+	using value_type = std::remove_const_t<H>;
+	using difference_type = std::ptrdiff_t;
+	using pointer = H*;
+	using reference = H&;
+	using iterator_category = std::random_access_iterator_tag;
+
+	const G* g;
+	H* h;
+
+	growing_header_iterator() = default;
+	growing_header_iterator(const G* g, H* h) : g(g), h(h) {}
+	template<typename H0, typename = std::enable_if_t<std::is_convertible_v<H0*, H*>>>
+	growing_header_iterator(const growing_header_iterator<H0, G>& x) : g(x.g), h(x.h) {}
+
+	reference operator*() const { return *h; }
+	pointer operator->() const { return h; }
+	reference operator[](difference_type n) const { return *(*this + n); }
+
+	friend
+	bool operator==(const growing_header_iterator& x, const growing_header_iterator& y) {
+		return x.h == y.h;
+	}
+
+	friend
+	bool operator!=(const growing_header_iterator& x, const growing_header_iterator& y) {
+		return !(x == y);
+	}
+
+	friend
+	bool operator<(const growing_header_iterator& x, const growing_header_iterator& y) {
+		return x - y < 0;
+	}
+
+	friend
+	bool operator>=(const growing_header_iterator& x, const growing_header_iterator& y) {
+		return !(x < y);
+	}
+
+	friend
+	bool operator>(const growing_header_iterator& x, const growing_header_iterator& y) {
+		return y < x;
+	}
+
+	friend
+	bool operator<=(const growing_header_iterator& x, const growing_header_iterator& y) {
+		return !(y < x);
+	}
+
+	growing_header_iterator& operator++() {
+		++h;
+		if (h == g->next_last) h = g->first;
+		return *this;
+	}
+	growing_header_iterator operator++(int) {
+		growing_header_iterator tmp = *this;
+		++*this;
+		return tmp;
+	}
+	growing_header_iterator& operator--() {
+		if (h == g->first && g->growing()) h = g->next_last;
+		--h;
+		return *this;
+	}
+	growing_header_iterator operator--(int) {
+		growing_header_iterator tmp = *this;
+		--*this;
+		return tmp;
+	}
+
+	growing_header_iterator operator+(difference_type n) const {
+		if (!g->growing()) return growing_header_iterator(g, h + n);
+		return growing_header_iterator(g, g->select(static_cast<std::size_t>(static_cast<difference_type>(g->rank(h)) + n)));
+	}
+	friend
+	growing_header_iterator operator+(difference_type n, const growing_header_iterator& x) {
+		return x + n;
+	}
+	growing_header_iterator operator-(difference_type n) const {
+		return *this + (-n);
+	}
+
+	growing_header_iterator& operator+=(difference_type n) {
+		*this = *this + n;
+		return *this;
+	}
+	growing_header_iterator& operator-=(difference_type n) {
+		*this = *this - n;
+		return *this;
+	}
+
+	friend
+	difference_type operator-(const growing_header_iterator& x, const growing_header_iterator& y) {
+		if (!x.g->growing()) return x.h - y.h;
+		return static_cast<difference_type>(x.g->rank(x.h)) - static_cast<difference_type>(y.g->rank(y.h));
+	}
+};
+
+// Data structure responsible for holding all "segment headers" and allocating and deallocating
+// "segment areas"; the buffer of headers grows incrementally.
+// Once growing, every insertion or erasure of "n" headers first moves "migration_step * max(n, 1)" headers
+// to the new buffer, so the old buffer never runs out of space before all headers are moved.
+template<typename T, std::size_t C, typename A>
+// T models
+// A models Allocator
+class growing_header_index
+{
+public:
+	using header_type = big_segment_header<T, C>;
+	using value_type = ValueType<header_type>;
+	using area_type = AreaType<header_type>;
+	using layout = growing_headers<header_type, A>;
+	using iterator = growing_header_iterator<header_type, layout>;
+	using const_iterator = growing_header_iterator<const header_type, layout>;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+	using size_type = std::size_t;
+	using allocator = AllocatorRebindType<A, area_type>;
+	constexpr static size_t segment_capacity = header_type::capacity;
+	constexpr static size_type migration_step = 4;
+
+	// Layout is held on the heap, so that iterators, which point to it, stay valid when the index is moved
+	std::unique_ptr<layout> g;
+	allocator alloc;
+
+	iterator iterator_at(header_type* h) { return iterator(g.get(), h); }
+	const_iterator iterator_at(const header_type* h) const { return const_iterator(g.get(), h); }
+
+	// Allocates the new buffer for all current headers and "n" new ones; doesn't move any headers
+	void start_growing(size_type n) {
+		size_type used_size = g->count() + n;
+		g->next_size = used_size << 1;
+		g->next = allocate_headers<header_type>(alloc, g->next_size);
+		g->next_first = g->next.get() + (used_size >> 1);
+		g->next_last = g->next_first;
+	}
+
+	// Moves at most "n" headers from the front of the old buffer to the back of the new one
+	void migrate(size_type n) {
+		n = std::min(n, static_cast<size_type>(g->last - g->first));
+		std::tie(g->next_first, g->next_last) = insert_flat(
+			g->next.get(), g->next.get() + g->next_size, g->next_first, g->next_last, g->next_last, n);
+		std::copy_n(g->first, n, g->next_last - n);
+		g->first = g->first + n;
+		if (g->first != g->last) return;
+		g->current = std::move(g->next);
+		g->current_size = g->next_size;
+		g->first = g->next_first;
+		g->last = g->next_last;
+		g->next_size = 0;
+		g->next_first = nullptr;
+		g->next_last = nullptr;
+	}
+
+	// Whether "n" headers can be inserted before the header with rank "r" without running out of space in either buffer
+	bool fits(size_type r, size_type n) const {
+		if (g->count() + n > g->next_size) return false;
+		return r <= g->moved() || g->available() >= n;
+	}
+
+	void make_room(size_type r, size_type n) {
+		if (g->growing()) {
+			migrate(migration_step * n);
+			if (g->growing() && !fits(r, n)) migrate(g->count());
+		}
+		if (!g->growing() && g->available() < n) {
+			start_growing(n);
+			migrate(migration_step * n);
+		}
+	}
+
+	// Inserts "n" headers before the header with rank "r"
+	void insert_headers(size_type r, size_type n) {
+		make_room(r, n);
+		size_type m = g->moved();
+		if (g->growing() && r <= m) {
+			std::tie(g->next_first, g->next_last) = insert_flat(
+				g->next.get(), g->next.get() + g->next_size, g->next_first, g->next_last, g->next_first + r, n);
+		}
+		else {
+			std::tie(g->first, g->last) = insert_flat(
+				g->current.get(), g->current.get() + g->current_size, g->first, g->last, g->first + (r - m), n);
+		}
+	}
+
+	// Erases "n" headers, starting with the one with rank "r"
+	void erase_headers(size_type r, size_type n) {
+		if (g->growing()) {
+			migrate(migration_step * n);
+			// erased headers have to be in one buffer
+			size_type m = g->moved();
+			if (g->growing() && r < m && m < r + n) migrate(r + n - m);
+		}
+		header_type* firste = g->select(r);
+		if (g->growing() && r < g->moved())
+			std::tie(g->next_first, g->next_last, firste) = erase_flat(g->next_first, g->next_last, firste, firste + n);
+		else
+			std::tie(g->first, g->last, firste) = erase_flat(g->first, g->last, firste, firste + n);
+	}
+
+	void allocate_areas(size_type r, size_type n) {
+		iterator first = iterator_at(g->select(r));
+		size_type _n = n;
+		try {
+			size_t c = capacity(*first);
+			while (_n) {
+				set_area(*first, alloc.allocate(1));
+				set_begin_end_indices(*first, c);
+				++first;
+				--_n;
+			}
+		}
+		catch (...) {
+			_n = n - _n;
+			first = iterator_at(g->select(r));
+			while (_n) {
+				alloc.deallocate(area(*first), 1);
+				--_n;
+				++first;
+			}
+			erase_headers(r, n);
+			throw;
+		}
+	}
+
+	void destroy() {
+		if (g && g->current)
+			std::for_each(begin(), end(), deallocate_area<allocator>(alloc));
+	}
+
+	void init(size_type n = 8) {
+		g = std::make_unique<layout>();
+		g->current = allocate_headers<header_type>(alloc, n);
+		g->current_size = n;
+		g->first = g->current.get() + ((n >> 1) - 1);
+		g->last = g->first + 1;
+		set_area(*g->first, nullptr);
+		set_begin_end_indices(*g->first, capacity(*g->first));
+	}
+
+public:
+	growing_header_index(const allocator& alloc = allocator()) : alloc(alloc) { init(); }
+	growing_header_index(allocator&& alloc) : alloc(std::move(alloc)) { init(); }
+	growing_header_index(growing_header_index&& other) :
+		g(std::move(other.g)),
+		alloc(std::move(other.alloc))
+	{
+		other.init();
+	}
+	growing_header_index(const growing_header_index& other) :
+		alloc(other.alloc)
+	{
+		init(copy_capacity(other.size()));
+	}
+	~growing_header_index() { destroy(); }
+
+	growing_header_index& operator=(growing_header_index&& other) {
+		if (this == &other) return *this;
+		destroy();
+		g = std::move(other.g);
+		alloc = std::move(other.alloc);
+		other.init();
+		return *this;
+	}
+	growing_header_index& operator=(const growing_header_index& other) {
+		if (this == &other) return *this;
+		destroy();
+		alloc = other.alloc;
+		init(copy_capacity(other.size()));
+		return *this;
+	}
+
+	iterator insert(iterator it, size_type n) {
+		// precondition: it belongs to [begin(), end()]
+		size_type r = g->rank(it.h);
+		if (n) {
+			insert_headers(r, n);
+			allocate_areas(r, n);
+		}
+		return iterator_at(g->select(r));
+	}
+
+	iterator erase(iterator first, iterator last) {
+		// precondition: [first, last] belongs to [begin(), end()]
+		size_type r = g->rank(first.h);
+		size_type n = static_cast<size_type>(last - first);
+		std::for_each(first, last, deallocate_area<allocator>(alloc));
+		erase_headers(r, n);
+		return iterator_at(g->select(r));
+	}
+
+	void clear() {
+		erase(begin(), end());
+	}
+
+	friend
+	iterator insert(growing_header_index& i, iterator it, size_type n) {
+		return i.insert(it, n);
+	}
+
+	friend
+	iterator erase(growing_header_index& i, iterator first, iterator last) {
+		return i.erase(first, last);
+	}
+
+	friend
+	iterator insert(growing_header_index& i, iterator it) {
+		return i.insert(it, 1);
+	}
+
+	friend
+	iterator erase(growing_header_index& i, iterator it) {
+		return i.erase(it, it + 1);
+	}
+
+	bool growing() const { return g->growing(); }
+
+	iterator begin() { return iterator_at(g->select(0)); }
+	const_iterator cbegin() const { return iterator_at(g->select(0)); }
+	const_iterator begin() const { return cbegin(); }
+
+	iterator end() { return iterator_at(g->last - 1); }
+	const_iterator cend() const { return iterator_at(g->last - 1); }
+	const_iterator end() const { return cend(); }
+
+	reverse_iterator rbegin() { return reverse_iterator(end()); }
+	const_reverse_iterator crbegin() const { return const_reverse_iterator(cend()); }
+	const_reverse_iterator rbegin() const { return crbegin(); }
+
+	reverse_iterator rend() { return reverse_iterator(begin()); }
+	const_reverse_iterator crend() const { return const_reverse_iterator(cbegin()); }
+	const_reverse_iterator rend() const { return crend(); }
+
+	size_t size() const { return g->count() - 1; }
+	bool empty() const { return size() == 0; }
+};
+
+//************************************************************************
+// ~GROWING INDEX
+//************************************************************************
+
+
+//************************************************************************
+// COUNTED INDEX
+//************************************************************************
+
+// Balanced tree over the sizes of consecutive segments. Leaves hold sizes of up to "leaf_capacity" segments and
+// inner nodes up to "node_capacity" children, together with the number of segments and elements under each child.
+// Segments are inserted and erased by position, so insertion, erasure, update of a size, number of elements
+// before a segment and the segment holding the "i"-th element are all O(log(number of segments)), with the
+// cost of shifting entries of one node per level on top of it.
+class segment_count_tree
+{
+	static constexpr size_t leaf_capacity = 128;
+	static constexpr size_t node_capacity = 32;
+
+	struct node
+	{
+		size_t n; // number of sizes in a leaf, or of children in an inner node
+	};
+
+	struct leaf : node
+	{
+		segment_size_t sizes[leaf_capacity];
+	};
+
+	struct inner : node
+	{
+		size_t segments[node_capacity];
+		size_t elements[node_capacity];
+		node* children[node_capacity];
+	};
+
+	// Empty tree has no nodes; "height" is 0 when the root is a leaf
+	node* root = nullptr;
+	size_t height = 0;
+
+	static leaf* as_leaf(node* x) { return static_cast<leaf*>(x); }
+	static inner* as_inner(node* x) { return static_cast<inner*>(x); }
+
+	static node* create(size_t h) {
+		node* x = h ? static_cast<node*>(new inner) : static_cast<node*>(new leaf);
+		x->n = 0;
+		return x;
+	}
+
+	static void destroy(node* x, size_t h) {
+		if (h == 0) {
+			delete as_leaf(x);
+			return;
+		}
+		for (size_t c = 0; c < x->n; ++c) destroy(as_inner(x)->children[c], h - 1);
+		delete as_inner(x);
+	}
+
+	static size_t capacity(size_t h) { return h ? node_capacity : leaf_capacity; }
+
+	// Nodes, other than the root, are merged with or refilled from a neighbour once they hold fewer entries
+	static size_t min_size(size_t h) { return capacity(h) >> 2; }
+
+	// Number of segments and elements under node "x" of height "h"
+	static std::pair<size_t, size_t> sums(node* x, size_t h) {
+		if (h == 0) {
+			leaf* l = as_leaf(x);
+			return { l->n, std::accumulate(l->sizes, l->sizes + l->n, size_t(0)) };
+		}
+		inner* y = as_inner(x);
+		return {
+			std::accumulate(y->segments, y->segments + y->n, size_t(0)),
+			std::accumulate(y->elements, y->elements + y->n, size_t(0)) };
+	}
+
+	static void resum(inner* y, size_t h, size_t c) {
+		auto [s, e] = sums(y->children[c], h - 1);
+		y->segments[c] = s;
+		y->elements[c] = e;
+	}
+
+	// Copies "k" entries from position "f" of "x" to position "t" of "z"; ranges may overlap only if "x" is "z"
+	static void copy_entries(node* x, size_t f, node* z, size_t t, size_t k, size_t h) {
+		if (h == 0) {
+			segment_size_t* first = as_leaf(x)->sizes + f;
+			if (x == z && t > f) std::copy_backward(first, first + k, as_leaf(z)->sizes + (t + k));
+			else				 std::copy_n(first, k, as_leaf(z)->sizes + t);
+			return;
+		}
+		inner* y = as_inner(x);
+		inner* w = as_inner(z);
+		if (x == z && t > f) {
+			std::copy_backward(y->segments + f, y->segments + (f + k), w->segments + (t + k));
+			std::copy_backward(y->elements + f, y->elements + (f + k), w->elements + (t + k));
+			std::copy_backward(y->children + f, y->children + (f + k), w->children + (t + k));
+		}
+		else {
+			std::copy_n(y->segments + f, k, w->segments + t);
+			std::copy_n(y->elements + f, k, w->elements + t);
+			std::copy_n(y->children + f, k, w->children + t);
+		}
+	}
+
+	// Child of "y" which holds the segment at position "p"; "p" becomes the position inside that child
+	static size_t child_of(inner* y, size_t& p) {
+		size_t c = 0;
+		while (c + 1 < y->n && p >= y->segments[c]) {
+			p = p - y->segments[c];
+			++c;
+		}
+		return c;
+	}
+
+	// Moves the upper half of child "c" of "y" into a new child after it
+	static void split_child(inner* y, size_t h, size_t c) {
+		node* x = y->children[c];
+		node* z = create(h - 1);
+		copy_entries(y, c + 1, y, c + 2, y->n - (c + 1), h);
+		y->children[c + 1] = z;
+		++y->n;
+		size_t k = x->n >> 1;
+		copy_entries(x, x->n - k, z, 0, k, h - 1);
+		x->n = x->n - k;
+		z->n = k;
+		resum(y, h, c);
+		resum(y, h, c + 1);
+	}
+
+	// Children "c" and "c" + 1 of "y" are merged if they fit into one node, otherwise their entries are split evenly
+	static void join_children(inner* y, size_t h, size_t c) {
+		node* x = y->children[c];
+		node* z = y->children[c + 1];
+		if (x->n + z->n <= capacity(h - 1)) {
+			copy_entries(z, 0, x, x->n, z->n, h - 1);
+			x->n = x->n + z->n;
+			z->n = 0;
+			destroy(z, h - 1);
+			y->segments[c] = y->segments[c] + y->segments[c + 1];
+			y->elements[c] = y->elements[c] + y->elements[c + 1];
+			copy_entries(y, c + 2, y, c + 1, y->n - (c + 2), h);
+			--y->n;
+			return;
+		}
+		size_t t = (x->n + z->n) >> 1;
+		if (x->n > t) {
+			size_t k = x->n - t;
+			copy_entries(z, 0, z, k, z->n, h - 1);
+			copy_entries(x, t, z, 0, k, h - 1);
+			x->n = t;
+			z->n = z->n + k;
+		}
+		else {
+			size_t k = t - x->n;
+			copy_entries(z, 0, x, x->n, k, h - 1);
+			copy_entries(z, k, z, 0, z->n - k, h - 1);
+			x->n = t;
+			z->n = z->n - k;
+		}
+		resum(y, h, c);
+		resum(y, h, c + 1);
+	}
+
+	// Joins child "c" of "y" with its neighbours until it holds enough entries or it's the only child
+	static void fill_child(inner* y, size_t h, size_t c) {
+		while (y->n > 1 && c < y->n && y->children[c]->n < min_size(h - 1)) {
+			if (c + 1 == y->n) --c;
+			join_children(y, h, c);
+		}
+	}
+
+	// Inserts "m" empty segments before position "p"; nodes on the way which couldn't take them are split first
+	void insert_empty(size_t p, size_t m) {
+		if (height ? root->n == node_capacity : root->n + m > leaf_capacity) {
+			inner* y = as_inner(create(height + 1));
+			y->n = 1;
+			y->children[0] = root;
+			auto [s, e] = sums(root, height);
+			y->segments[0] = s;
+			y->elements[0] = e;
+			root = y;
+			++height;
+			split_child(y, height, 0);
+		}
+		node* x = root;
+		for (size_t h = height; h; --h) {
+			inner* y = as_inner(x);
+			size_t c = child_of(y, p);
+			node* z = y->children[c];
+			if (h == 1 ? z->n + m > leaf_capacity : z->n == node_capacity) {
+				split_child(y, h, c);
+				if (p > y->segments[c]) {
+					p = p - y->segments[c];
+					++c;
+				}
+			}
+			y->segments[c] = y->segments[c] + m;
+			x = y->children[c];
+		}
+		leaf* l = as_leaf(x);
+		std::copy_backward(l->sizes + p, l->sizes + l->n, l->sizes + (l->n + m));
+		std::fill_n(l->sizes + p, m, segment_size_t(0));
+		l->n = l->n + m;
+	}
+
+	// Erases segments in the positions [p, p + k) under "x" and returns the number of their elements; k > 0
+	static size_t erase(node* x, size_t h, size_t p, size_t k) {
+		if (h == 0) {
+			leaf* l = as_leaf(x);
+			size_t e = std::accumulate(l->sizes + p, l->sizes + (p + k), size_t(0));
+			std::copy(l->sizes + (p + k), l->sizes + l->n, l->sizes + p);
+			l->n = l->n - k;
+			return e;
+		}
+		inner* y = as_inner(x);
+		size_t c = child_of(y, p);
+		size_t first = c;
+		size_t last = c;
+		size_t e = 0;
+		while (k) {
+			size_t m = std::min(k, y->segments[last] - p);
+			if (m == y->segments[last]) {
+				e = e + y->elements[last];
+				destroy(y->children[last], h - 1);
+				y->children[last] = nullptr;
+			}
+			else {
+				size_t d = erase(y->children[last], h - 1, p, m);
+				y->segments[last] = y->segments[last] - m;
+				y->elements[last] = y->elements[last] - d;
+				e = e + d;
+			}
+			k = k - m;
+			p = 0;
+			++last;
+		}
+		// At most the first and the last child of the range are left, both partially erased
+		size_t kept = first;
+		for (size_t i = first; i < last; ++i) {
+			if (y->children[i]) {
+				y->segments[kept] = y->segments[i];
+				y->elements[kept] = y->elements[i];
+				y->children[kept] = y->children[i];
+				++kept;
+			}
+		}
+		copy_entries(y, last, y, kept, y->n - last, h);
+		y->n = y->n - (last - kept);
+		if (kept > first + 1) fill_child(y, h, first + 1);
+		if (first < y->n) fill_child(y, h, first);
+		else if (y->n) fill_child(y, h, y->n - 1);
+		return e;
+	}
+
+	static size_t set(node* x, size_t h, size_t p, size_t s) {
+		if (h == 0) {
+			leaf* l = as_leaf(x);
+			size_t d = s - l->sizes[p]; // unsigned arithmetic wraps around for a smaller size
+			l->sizes[p] = static_cast<segment_size_t>(s);
+			return d;
+		}
+		inner* y = as_inner(x);
+		size_t c = child_of(y, p);
+		size_t d = set(y->children[c], h - 1, p, s);
+		y->elements[c] = y->elements[c] + d;
+		return d;
+	}
+
+public:
+	segment_count_tree() = default;
+	segment_count_tree(segment_count_tree&& other) :
+		root(std::exchange(other.root, nullptr)),
+		height(std::exchange(other.height, 0))
+	{}
+	segment_count_tree& operator=(segment_count_tree&& other) {
+		if (this == &other) return *this;
+		clear();
+		root = std::exchange(other.root, nullptr);
+		height = std::exchange(other.height, 0);
+		return *this;
+	}
+	~segment_count_tree() { clear(); }
+
+	void clear() {
+		if (root) destroy(root, height);
+		root = nullptr;
+		height = 0;
+	}
+
+	// Inserts "n" segments, holding no elements, before position "p"
+	void insert(size_t p, size_t n) {
+		if (!root) root = create(0);
+		while (n) {
+			size_t m = std::min(n, leaf_capacity >> 1);
+			insert_empty(p, m);
+			p = p + m;
+			n = n - m;
+		}
+	}
+
+	// Erases "n" segments starting from position "p"
+	void erase(size_t p, size_t n) {
+		if (n == 0) return;
+		erase(root, height, p, n);
+		// Root which is left with a single child is replaced by it
+		while (height && root->n <= 1) {
+			inner* y = as_inner(root);
+			if (y->n) {
+				root = y->children[0];
+				--height;
+			}
+			else {
+				root = create(0);
+				height = 0;
+			}
+			delete y;
+		}
+	}
+
+	void set(size_t p, size_t s) {
+		set(root, height, p, s);
+	}
+
+	// Number of elements held by the segments before position "p"
+	size_t prefix(size_t p) const {
+		if (!root) return 0;
+		node* x = root;
+		size_t e = 0;
+		for (size_t h = height; h; --h) {
+			inner* y = as_inner(x);
+			size_t c = 0;
+			while (c + 1 < y->n && p >= y->segments[c]) {
+				p = p - y->segments[c];
+				e = e + y->elements[c];
+				++c;
+			}
+			x = y->children[c];
+		}
+		leaf* l = as_leaf(x);
+		return std::accumulate(l->sizes, l->sizes + p, e);
+	}
+
+	// Position of the segment which holds the "i"-th element, that is the number of segments whose elements
+	// all come before it, and the position of the element inside that segment
+	std::pair<size_t, size_t> locate(size_t i) const {
+		if (!root) return { 0, i };
+		node* x = root;
+		size_t p = 0;
+		for (size_t h = height; h; --h) {
+			inner* y = as_inner(x);
+			size_t c = 0;
+			while (c + 1 < y->n && i >= y->elements[c]) {
+				i = i - y->elements[c];
+				p = p + y->segments[c];
+				++c;
+			}
+			x = y->children[c];
+		}
+		leaf* l = as_leaf(x);
+		size_t j = 0;
+		while (j < l->n && i >= l->sizes[j]) {
+			i = i - l->sizes[j];
+			++j;
+		}
+		return { p + j, i };
+	}
+};
+
+// Segment index which, besides the segment headers, keeps sizes of all segments in a "segment_count_tree";
+// number of elements before any segment and the segment holding the "i"-th element can then be found in
+// O(log(number of segments)).
+// Sizes of changed segments are updated through "update_segments". Insertion or erasure of segment headers
+// inserts or erases the same positions of the tree, which is logarithmic as well; queries never change the index.
+template<typename I>
+// I models SegmentIndex
+class counted_index : public I
+{
+public:
+	using index_type = I;
+	using iterator = Iterator<index_type>;
+	using const_iterator = ConstIterator<index_type>;
+	using size_type = SizeType<index_type>;
+
+private:
+	segment_count_tree counts;
+
+	void update(iterator first, iterator last) {
+		size_t i = static_cast<size_t>(first - I::begin());
+		while (first != last) {
+			counts.set(i, seg::size(*first));
+			++first;
+			++i;
+		}
+	}
+
+public:
+	using I::I;
+	counted_index() = default;
+	counted_index(counted_index&& other) :
+		I(std::move(other)),
+		counts(std::move(other.counts))
+	{}
+	// Copy of the index holds no segments, like the copy of "I"
+	counted_index(const counted_index& other) : I(other) {}
+
+	counted_index& operator=(counted_index&& other) {
+		if (this == &other) return *this;
+		I::operator=(std::move(other));
+		counts = std::move(other.counts);
+		return *this;
+	}
+	counted_index& operator=(const counted_index& other) {
+		if (this == &other) return *this;
+		I::operator=(other);
+		counts.clear();
+		return *this;
+	}
+
+	iterator insert(iterator it, size_type n) {
+		size_t p = static_cast<size_t>(it - I::begin());
+		iterator r = I::insert(it, n);
+		// new segments are empty until they're filled and updated
+		counts.insert(p, static_cast<size_t>(n));
+		return r;
+	}
+
+	iterator erase(iterator first, iterator last) {
+		size_t p = static_cast<size_t>(first - I::begin());
+		size_t n = static_cast<size_t>(last - first);
+		iterator r = I::erase(first, last);
+		counts.erase(p, n);
+		return r;
+	}
+
+	void clear() {
+		erase(I::begin(), I::end());
+	}
+
+	// Number of elements held by the segments before "it"
+	size_t prefix_size(const_iterator it) const {
+		return counts.prefix(static_cast<size_t>(it - I::cbegin()));
+	}
+
+	// Segment which holds the "i"-th element and the position of the element inside that segment;
+	// for "i" equal to the number of elements, it's the "edge last" segment
+	std::pair<iterator, size_t> segment_of(size_t i) {
+		auto [p, j] = counts.locate(i);
+		return { I::begin() + p, j };
+	}
+	std::pair<const_iterator, size_t> segment_of(size_t i) const {
+		auto [p, j] = counts.locate(i);
+		return { I::cbegin() + p, j };
+	}
+
+	friend
+	iterator insert(counted_index& i, iterator it, size_type n) {
+		return i.insert(it, n);
+	}
+
+	friend
+	iterator erase(counted_index& i, iterator first, iterator last) {
+		return i.erase(first, last);
+	}
+
+	friend
+	iterator insert(counted_index& i, iterator it) {
+		return i.insert(it, 1);
+	}
+
+	friend
+	iterator erase(counted_index& i, iterator it) {
+		return i.erase(it, it + 1);
+	}
+
+	friend
+	void update_segments(counted_index& i, iterator first, iterator last) {
+		update_segments(static_cast<I&>(i), first, last);
+		i.update(first, last);
+	}
+};
+
+template<typename I, typename = void>
+// I models SegmentIndex
+struct is_counted_index : std::false_type {};
+
+template<typename I>
+// I models SegmentIndex
+struct is_counted_index<I, std::void_t<decltype(std::declval<const I&>().segment_of(size_t(0)))>> : std::true_type {};
+
+//************************************************************************
+// ~COUNTED INDEX
+//************************************************************************
+
+
+//************************************************************************
+// FENCED INDEX
+//************************************************************************
+
+// Fence locators find the partition point of a predicate over the fence keys of a "fenced_index".
+// They're told about every insertion or erasure of fence keys through "changed", and are given the
+// fence keys through "update" once they have been read again after an insertion or erasure.
+
+// Binary search over the fence keys
+struct binary_fence_locator
+{
+	void changed(std::size_t) {}
+
+	template<typename F>
+	// F models RandomAccessContainer
+	void update(const F&) {}
+
+	template<typename F, typename K, typename P>
+	// F models RandomAccessContainer
+	// P models UnaryPredicate
+	// Domain<P> == K == ValueType<F>
+	std::size_t operator()(const F& fences, std::size_t first, const K&, P p) const {
+		return static_cast<std::size_t>(std::partition_point(std::begin(fences) + first, std::end(fences), p) - std::begin(fences));
+	}
+};
+
+// Learned index over the fence keys; a piecewise linear model which predicts the position of every fence key
+// within "E" positions. The partition point is searched for only around the predicted position of the key
+// "p" compares against, and if it isn't confirmed there, the rest of the fence keys is searched.
+// Model is rebuilt by the first update after more than "E" fence keys were inserted or erased; until then
+// the searched window is widened by the number of changes. Searches never change the model.
+// Keys have to be arithmetic and ordered by "std::less" for the predictions to be useful.
+template<std::size_t E = 16>
+struct learned_fence_locator
+{
+	static constexpr std::size_t max_error = E;
+
+	// Piece predicts position "position + slope * (k - key)" for keys "k" not smaller than "key"
+	struct piece
+	{
+		double key;
+		double slope;
+		std::size_t position;
+	};
+
+	std::vector<piece> pieces;
+	// keys of the pieces, in a separate array so that the search over them touches fewer cache lines
+	std::vector<double> piece_keys;
+	std::size_t changes = 0;
+	bool built = false;
+
+	void changed(std::size_t n) { changes = changes + n; }
+
+	template<typename F>
+	// F models RandomAccessContainer
+	void update(const F& fences) {
+		if (!built || changes > E) build(fences);
+	}
+
+	template<typename F>
+	// F models RandomAccessContainer
+	void build(const F& fences) {
+		static_assert(std::is_arithmetic_v<ValueType<F>>, "learned_fence_locator needs arithmetic keys");
+		pieces.clear();
+		piece_keys.clear();
+		const double e = static_cast<double>(E);
+		std::size_t n = fences.size();
+		std::size_t i = 0;
+		// Every piece is extended for as long as there are slopes which keep all of its fence keys within "E"
+		while (i < n) {
+			double x0 = static_cast<double>(fences[i]);
+			double lower_slope = 0.0;
+			double upper_slope = std::numeric_limits<double>::infinity();
+			std::size_t j = i + 1;
+			while (j < n) {
+				double dx = static_cast<double>(fences[j]) - x0;
+				double dy = static_cast<double>(j - i);
+				if (dx <= 0.0) {
+					if (dy > e) break;
+					++j;
+					continue;
+				}
+				double _lower_slope = (dy - e) / dx;
+				double _upper_slope = (dy + e) / dx;
+				if (_lower_slope > upper_slope || _upper_slope < lower_slope) break;
+				lower_slope = std::max(lower_slope, _lower_slope);
+				upper_slope = std::min(upper_slope, _upper_slope);
+				++j;
+			}
+			double slope = upper_slope == std::numeric_limits<double>::infinity() ? 0.0 : (lower_slope + upper_slope) / 2;
+			pieces.push_back({ x0, slope, i });
+			piece_keys.push_back(x0);
+			i = j;
+		}
+		changes = 0;
+		built = true;
+	}
+
+	template<typename F, typename K, typename P>
+	// F models RandomAccessContainer
+	// P models UnaryPredicate
+	// Domain<P> == K == ValueType<F>
+	std::size_t operator()(const F& fences, std::size_t first, const K& k, P p) const {
+		auto f = std::begin(fences);
+		std::size_t n = fences.size();
+		if (pieces.empty() || first >= n) return binary_fence_locator()(fences, first, k, p);
+
+		double x = static_cast<double>(k);
+		std::size_t l = static_cast<std::size_t>(std::upper_bound(piece_keys.begin(), piece_keys.end(), x) - piece_keys.begin());
+		const piece& pc = pieces[l == 0 ? 0 : l - 1];
+		double prediction = static_cast<double>(pc.position) + pc.slope * (x - pc.key);
+		double window = static_cast<double>(E + 1 + changes);
+		// window is clamped to "[first, n]" before it's converted, since predictions can fall far outside of it
+		double _first = static_cast<double>(first);
+		double _n = static_cast<double>(n);
+		std::size_t lo = static_cast<std::size_t>(std::min(std::max(prediction - window, _first), _n));
+		std::size_t hi = static_cast<std::size_t>(std::min(std::max(prediction + window + 1.0, static_cast<double>(lo)), _n));
+
+		std::size_t j = static_cast<std::size_t>(std::partition_point(f + lo, f + hi, p) - f);
+		if (j == lo && lo > first && !p(f[lo - 1]))
+			return static_cast<std::size_t>(std::partition_point(f + first, f + (lo - 1), p) - f);
+		if (j == hi && hi < n && p(f[hi]))
+			return static_cast<std::size_t>(std::partition_point(f + (hi + 1), std::end(fences), p) - f);
+		return j;
+	}
+};
+
+// Segment index which, besides the segment headers, keeps a contiguous array of "fence keys";
+// key of the last element of every segment. Segment which holds the lower(upper) bound of a key
+// can then be found by searching only that array, without touching any of the areas.
+// Fence keys of the changed segments are read when the index is notified of them, which is
+// only done once their new elements have been constructed.
+template<typename I, typename VK, typename L = binary_fence_locator>
+// I models SegmentIndex
+// VK models ValueToKey
+// L models FenceLocator
+class fenced_index : public I
+{
+public:
+	using index_type = I;
+	using iterator = Iterator<index_type>;
+	using const_iterator = ConstIterator<index_type>;
+	using size_type = SizeType<index_type>;
+	using value_type = ValueType<index_type>;
+	using value_to_key = VK;
+	using key_type = std::decay_t<decltype(value_to_key::get(std::declval<const value_type&>()))>;
+	using fence_container = std::vector<key_type>;
+	using locator_type = L;
+
+	fence_container _fences;
+	locator_type locator;
+
+	// Fence keys of new segments are read once the index is notified of them
+	void _insert_fences(size_t p, size_t n) {
+		_fences.insert(_fences.begin() + p, n, key_type());
+		locator.changed(n);
+	}
+
+	void _erase_fences(size_t p, size_t n) {
+		_fences.erase(_fences.begin() + p, _fences.begin() + (p + n));
+		locator.changed(n);
+	}
+
+	void read_fences(iterator first, iterator last) {
+		typename fence_container::iterator f = _fences.begin() + (first - I::begin());
+		while (first != last) {
+			*f = value_to_key::get(*flat::predecessor(seg::end(*first), 1));
+			++f;
+			++first;
+		}
+	}
+
+public:
+	using I::I;
+	fenced_index() = default;
+	fenced_index(fenced_index&& other) :
+		I(std::move(other)),
+		_fences(std::move(other._fences)),
+		locator(std::move(other.locator))
+	{
+		other._fences.clear();
+		other.locator = locator_type();
+	}
+	fenced_index(const fenced_index& other) : I(other) {}
+
+	fenced_index& operator=(fenced_index&& other) {
+		if (this == &other) return *this;
+		I::operator=(std::move(other));
+		_fences = std::move(other._fences);
+		locator = std::move(other.locator);
+		other._fences.clear();
+		other.locator = locator_type();
+		return *this;
+	}
+	fenced_index& operator=(const fenced_index& other) {
+		if (this == &other) return *this;
+		I::operator=(other);
+		_fences.clear();
+		locator = locator_type();
+		return *this;
+	}
+
+	iterator insert(iterator it, size_type n) {
+		size_t p = static_cast<size_t>(it - I::begin());
+		it = I::insert(it, n);
+		_insert_fences(p, n);
+		return it;
+	}
+
+	iterator erase(iterator first, iterator last) {
+		size_t p = static_cast<size_t>(first - I::begin());
+		size_t n = static_cast<size_t>(last - first);
+		first = I::erase(first, last);
+		_erase_fences(p, n);
+		return first;
+	}
+
+	void clear() {
+		erase(I::begin(), I::end());
+	}
+
+	// Keys of the last elements of all segments, in order
+	const fence_container& fences() const {
+		return _fences;
+	}
+
+	// Number of the first segment, not before the "first"-th one, whose fence key doesn't satisfy "p";
+	// "k" is the key which "p" compares with
+	template<typename P>
+	// P models UnaryPredicate
+	// Domain<P> == key_type
+	size_t fence_partition_point(size_t first, const key_type& k, P p) const {
+		return locator(fences(), first, k, p);
+	}
+
+	friend
+	iterator insert(fenced_index& i, iterator it, size_type n) {
+		return i.insert(it, n);
+	}
+
+	friend
+	iterator erase(fenced_index& i, iterator first, iterator last) {
+		return i.erase(first, last);
+	}
+
+	friend
+	iterator insert(fenced_index& i, iterator it) {
+		return i.insert(it, 1);
+	}
+
+	friend
+	iterator erase(fenced_index& i, iterator it) {
+		return i.erase(it, it + 1);
+	}
+
+	friend
+	void update_segments(fenced_index& i, iterator first, iterator last) {
+		update_segments(static_cast<I&>(i), first, last);
+		i.read_fences(first, last);
+		i.locator.update(i._fences);
+	}
+};
+
+template<typename I, typename = void>
+// I models SegmentIndex
+struct is_fenced_index : std::false_type {};
+
+template<typename I>
+// I models SegmentIndex
+struct is_fenced_index<I, std::void_t<decltype(std::declval<const I&>().fences())>> : std::true_type {};
+
+//************************************************************************
+// ~FENCED INDEX
+//************************************************************************
+
+
+
+//************************************************************************
+// SAMPLED INDEX
+//************************************************************************
+
+constexpr size_t default_sample_stride = 64;
+
+// Segment index which, besides the segment headers, keeps for every segment the keys of every "S"-th
+// element of its area("samples"), packed into a contiguous array. Search inside a segment can then first
+// search its samples, and then only the "S" elements between two of them, instead of the whole area.
+// Samples of the changed segments are read again when the index is notified of them, which is only done
+// once their new elements have been constructed; every change of a segment reads all of its samples.
+template<typename I, typename VK, size_t S = default_sample_stride>
+// I models SegmentIndex
+// VK models ValueToKey
+class sampled_index : public I
+{
+public:
+	using index_type = I;
+	using iterator = Iterator<index_type>;
+	using const_iterator = ConstIterator<index_type>;
+	using size_type = SizeType<index_type>;
+	using value_type = ValueType<index_type>;
+	using value_to_key = VK;
+	using key_type = std::decay_t<decltype(value_to_key::get(std::declval<const value_type&>()))>;
+
+	static constexpr size_t sample_stride = S;
+	static constexpr size_t segment_samples = I::segment_capacity / S;
+	static_assert(segment_samples > 0, "Sample stride is larger than the segment capacity");
+
+	// Samples of the "j"-th segment are in [j * segment_samples, (j + 1) * segment_samples)
+	std::vector<key_type> _samples;
+
+	// Samples of new segments are read once the index is notified of them
+	void _insert_samples(size_t p, size_t n) {
+		_samples.insert(_samples.begin() + p * segment_samples, n * segment_samples, key_type());
+	}
+
+	void _erase_samples(size_t p, size_t n) {
+		_samples.erase(_samples.begin() + p * segment_samples, _samples.begin() + (p + n) * segment_samples);
+	}
+
+	void read_samples(iterator first, iterator last) {
+		key_type* samples = _samples.data() + static_cast<size_t>(first - I::begin()) * segment_samples;
+		while (first != last) {
+			const value_type* area = seg::begin(*first);
+			size_t n = static_cast<size_t>(seg::size(*first)) / S;
+			for (size_t i = 0; i < n; ++i) samples[i] = value_to_key::get(area[(i + 1) * S - 1]);
+			samples = samples + segment_samples;
+			++first;
+		}
+	}
+
+public:
+	using I::I;
+	sampled_index() = default;
+	sampled_index(sampled_index&& other) :
+		I(std::move(other)),
+		_samples(std::move(other._samples))
+	{
+		other._samples.clear();
+	}
+	sampled_index(const sampled_index& other) : I(other) {}
+
+	sampled_index& operator=(sampled_index&& other) {
+		if (this == &other) return *this;
+		I::operator=(std::move(other));
+		_samples = std::move(other._samples);
+		other._samples.clear();
+		return *this;
+	}
+	sampled_index& operator=(const sampled_index& other) {
+		if (this == &other) return *this;
+		I::operator=(other);
+		_samples.clear();
+		return *this;
+	}
+
+	iterator insert(iterator it, size_type n) {
+		size_t p = static_cast<size_t>(it - I::begin());
+		it = I::insert(it, n);
+		_insert_samples(p, n);
+		return it;
+	}
+
+	iterator erase(iterator first, iterator last) {
+		size_t p = static_cast<size_t>(first - I::begin());
+		size_t n = static_cast<size_t>(last - first);
+		first = I::erase(first, last);
+		_erase_samples(p, n);
+		return first;
+	}
+
+	void clear() {
+		erase(I::begin(), I::end());
+	}
+
+	// Positions [first, last), inside the "j"-th segment, of the "S" elements which hold the partition point of "p";
+	// only the samples of the segment are searched
+	template<typename P>
+	// P models UnaryPredicate
+	// Domain<P> == key_type
+	std::pair<size_t, size_t> sample_partition_range(size_t j, P p) const {
+		// precondition: partition point of "p" is inside the "j"-th segment
+		size_t size = static_cast<size_t>(seg::size(*(I::cbegin() + j)));
+		const key_type* samples = _samples.data() + j * segment_samples;
+		size_t b = static_cast<size_t>(std::partition_point(samples, samples + size / S, p) - samples);
+		return { b * S, std::min(b * S + S, size) };
+	}
+
+	friend
+	iterator insert(sampled_index& i, iterator it, size_type n) {
+		return i.insert(it, n);
+	}
+
+	friend
+	iterator erase(sampled_index& i, iterator first, iterator last) {
+		return i.erase(first, last);
+	}
+
+	friend
+	iterator insert(sampled_index& i, iterator it) {
+		return i.insert(it, 1);
+	}
+
+	friend
+	iterator erase(sampled_index& i, iterator it) {
+		return i.erase(it, it + 1);
+	}
+
+	friend
+	void update_segments(sampled_index& i, iterator first, iterator last) {
+		update_segments(static_cast<I&>(i), first, last);
+		i.read_samples(first, last);
+	}
+};
+
+template<typename I, typename = void>
+// I models SegmentIndex
+struct is_sampled_index : std::false_type {};
+
+template<typename I>
+// I models SegmentIndex
+struct is_sampled_index<I, std::void_t<decltype(I::sample_stride)>> : std::true_type {};
+
+//************************************************************************
+// ~SAMPLED INDEX
+//************************************************************************
+
+
+
+//************************************************************************
+// HASHED INDEX
+//************************************************************************
+
+// Smallest number of slots of the table of "hashed_index"
+constexpr size_t hashed_index_min_slots = 8;
+
+template<typename I, typename VK>
+// I models SegmentIndex
+// VK models ValueToKey
+using index_key_type = std::decay_t<decltype(VK::get(std::declval<const ValueType<I>&>()))>;
+
+// Segment index which, besides the segment headers, keeps a hash table from the keys of all elements to the
+// segments which hold them, and to their positions inside those segments. Segments are named in the table by ids,
+// which don't change when other segments are inserted or erased; an array maps ids to segment numbers, and insertion
+// or erasure of segments renumbers only the segments after it. When the index is notified of a change, only the keys
+// of the inserted elements, and of the elements which have moved from one segment to another, are entered into the
+// table; they're found by comparing the sizes of the changed segments with the sizes the table last saw, since
+// elements keep their order. Changes which aren't described that way enter all keys of the changed segments.
+// Elements which stay in their segment aren't entered again: every segment has a base which is added to the positions
+// of its keys when they're entered, and when the elements which stay are moved together, only the base changes. Positions
+// still drift as elements are inserted or erased in front of them, so they're only where the search of the key starts.
+// Lookups only read the table.
+// A slot is 8 bytes: 16 bits of the hash, the position and the id. It names the segment of the key which was entered
+// last with the same bits in its run of slots, so the segment has to be checked against the key. Slots of erased
+// segments are left as tombstones. Table has about two slots per element, and is never more than 3/4 full: once it
+// would be, it's built again from the keys of the segments. Ids of erased segments are only given to new segments once
+// no slot names them.
+template<typename I, typename VK, typename H = std::hash<index_key_type<I, VK>>>
+// I models SegmentIndex
+// VK models ValueToKey
+// H models HashFunction
+// Domain<H> == index_key_type<I, VK>
+class hashed_index : public I
+{
+public:
+	using index_type = I;
+	using iterator = Iterator<index_type>;
+	using const_iterator = ConstIterator<index_type>;
+	using size_type = SizeType<index_type>;
+	using value_type = ValueType<index_type>;
+	using value_to_key = VK;
+	using key_type = index_key_type<I, VK>;
+	using hasher = H;
+
+	static constexpr size_t no_segment = size_t(-1);
+
+private:
+	using id_type = std::uint32_t;
+	static constexpr id_type no_id = std::numeric_limits<id_type>::max();
+	static constexpr id_type erased_id = no_id - 1;
+
+	struct slot {
+		std::uint16_t tag;
+		// Position of the key inside its segment when it was entered, plus the base of the segment then
+		segment_size_t offset;
+		// "no_id" if the slot is empty, "erased_id" if it named an erased segment
+		id_type id;
+	};
+
+	struct erased_segment {
+		// Position of the segment which followed it
+		size_t position;
+		id_type id;
+		size_t size;
+	};
+
+	std::vector<slot> slots;
+	// Number of slots which aren't empty
+	size_t used = 0;
+	// Id of the segment at every position
+	std::vector<id_type> ids;
+	// Position of the segment with every id; "no_id" for ids of erased segments
+	std::vector<id_type> positions;
+	std::vector<id_type> free_ids;
+	// Ids of erased segments which slots may still name
+	std::vector<id_type> erased_ids;
+	// Size of the segment at every position when the table last saw it; new segments hold none of its elements
+	std::vector<segment_size_t> sizes;
+	// Base of the segment at every position
+	std::vector<segment_size_t> bases;
+	// Segments erased since the table last saw a change, in order
+	std::vector<erased_segment> erased_segments;
+	hasher hash;
+
+	// Product with 2^64 / phi, so that all bits of the hash are mixed into its upper half; the upper
+	// 32 bits choose the slot, and the next 16 bits are the tag
+	std::uint64_t hash64(const key_type& k) const {
+		return static_cast<std::uint64_t>(hash(k)) * 0x9E3779B97F4A7C15ull;
+	}
+
+	static std::uint16_t tag_of(std::uint64_t h) {
+		return static_cast<std::uint16_t>(h >> 16);
+	}
+
+	size_t home_of(std::uint64_t h) const {
+		return static_cast<size_t>(((h >> 32) * slots.size()) >> 32);
+	}
+
+	// Slot which holds the tag of "h", or the empty slot which ends its run
+	size_t find_slot(std::uint64_t h) const {
+		// precondition: !slots.empty()
+		size_t n = slots.size();
+		std::uint16_t t = tag_of(h);
+		size_t i = home_of(h);
+		while (slots[i].id != no_id && (slots[i].id == erased_id || slots[i].tag != t)) i = i + 1 == n ? 0 : i + 1;
+		return i;
+	}
+
+	// Slot which holds the tag of "h" is overwritten; otherwise the first tombstone or the empty slot of its run is taken
+	void enter(std::uint64_t h, size_t offset, id_type id) {
+		size_t n = slots.size();
+		std::uint16_t t = tag_of(h);
+		size_t i = home_of(h);
+		size_t j = n;
+		while (slots[i].id != no_id && (slots[i].id == erased_id || slots[i].tag != t)) {
+			if (slots[i].id == erased_id && j == n) j = i;
+			i = i + 1 == n ? 0 : i + 1;
+		}
+		if (slots[i].id == no_id) {
+			if (j == n) ++used;
+			else i = j;
+		}
+		slots[i] = slot{ t, static_cast<segment_size_t>(offset), id };
+	}
+
+	id_type take_id() {
+		if (free_ids.empty()) {
+			positions.push_back(no_id);
+			return static_cast<id_type>(positions.size() - 1);
+		}
+		id_type id = free_ids.back();
+		free_ids.pop_back();
+		return id;
+	}
+
+	void renumber(size_t p) {
+		for (size_t j = p; j < ids.size(); ++j) positions[ids[j]] = static_cast<id_type>(j);
+	}
+
+	void release_erased_ids() {
+		free_ids.insert(free_ids.end(), erased_ids.begin(), erased_ids.end());
+		erased_ids.clear();
+		// No slot names the erased segments anymore, and their ids may be given to new segments,
+		// so their elements have to be entered wherever they are now
+		for (erased_segment& g : erased_segments) g.id = no_id;
+	}
+
+	// Slots which name erased segments become tombstones
+	void purge() {
+		for (slot& s : slots) {
+			if (s.id != no_id && s.id != erased_id && positions[s.id] == no_id) s.id = erased_id;
+		}
+		release_erased_ids();
+	}
+
+	// Builds the table again from the keys of all segments, which hold "n" elements
+	void rebuild(size_t n) {
+		slots.assign(std::max(hashed_index_min_slots, 2 * n), slot{ 0, 0, no_id });
+		used = 0;
+		release_erased_ids();
+		enter_keys(I::begin(), I::end());
+	}
+
+	// Enters the keys of the elements at the positions [a, b) of the segment at position "j", which starts at "f"
+	void enter_keys(const value_type* f, size_t a, size_t b, size_t j) {
+		while (a != b) {
+			enter(hash64(value_to_key::get(f[a])), a + bases[j], ids[j]);
+			++a;
+		}
+	}
+
+	void enter_keys(iterator first, iterator last) {
+		size_t j = static_cast<size_t>(first - I::begin());
+		while (first != last) {
+			enter_keys(seg::begin(*first), 0, seg::size(*first), j);
+			++first;
+			++j;
+		}
+	}
+
+	// Makes room for "m" more keys; returns false if the table was built again from all the segments instead.
+	// Slots keep only 16 bits of the hash, so the table can't grow without the keys.
+	bool reserve(size_t m) {
+		if (4 * (used + m) <= 3 * slots.size()) return true;
+		size_t n = 0;
+		for (iterator it = I::begin(); it != I::end(); ++it) n = n + seg::size(*it);
+		rebuild(n);
+		return false;
+	}
+
+	// Table has seen the segments in the range [first, last) as they are now
+	void seen(iterator first, iterator last) {
+		for (size_t j = static_cast<size_t>(first - I::begin()); first != last; ++first, ++j)
+			sizes[j] = static_cast<segment_size_t>(seg::size(*first));
+		erased_segments.clear();
+	}
+
+	void update(iterator first, iterator last) {
+		size_t m = 0;
+		for (iterator it = first; it != last; ++it) m = m + seg::size(*it);
+		if (reserve(m)) enter_keys(first, last);
+		seen(first, last);
+	}
+
+	void update(iterator first, iterator last, std::pair<iterator, size_t> it, size_t n, size_t e) {
+		size_t p = static_cast<size_t>(first - I::begin());
+		size_t q = static_cast<size_t>(last - I::begin());
+		size_t x = static_cast<size_t>(it.first - I::begin());
+		// Elements the changed segments held before are those of the erased segments and of the segments which were there
+		bool ordered = p <= x && x <= q;
+		size_t old_size = 0;
+		for (const erased_segment& g : erased_segments) {
+			ordered = ordered && p <= g.position && g.position <= q;
+			old_size = old_size + g.size;
+		}
+		size_t new_size = 0;
+		size_t c = it.second;
+		for (size_t j = p; j < q; ++j) {
+			size_t s = seg::size(*(first + (j - p)));
+			if (j < x) c = c + s;
+			new_size = new_size + s;
+			old_size = old_size + sizes[j];
+		}
+		if (!ordered || c + n > new_size || new_size + e != old_size + n) {
+			update(first, last);
+			return;
+		}
+
+		// Old segments in order: erased segments in front of the segment which followed them, then that segment
+		size_t g = 0;
+		size_t o = p;
+		id_type old_id = no_id;
+		size_t old_begin = 0;
+		size_t old_end = 0;
+		auto next_old = [&]() {
+			old_begin = old_end;
+			if (g < erased_segments.size() && erased_segments[g].position <= o) {
+				old_id = erased_segments[g].id;
+				old_end = old_end + erased_segments[g].size;
+				++g;
+			}
+			else {
+				old_id = ids[o];
+				old_end = old_end + sizes[o];
+				++o;
+			}
+		};
+
+		// New elements are at the positions [c, c + n) of the changed segments; every other element at position "k"
+		// was at position "k" before, if it's in front of "c", or "k" - "n" + "e" otherwise
+		// Keys in front of the first element which stayed in the segment are entered once the base is moved with it
+		size_t k = 0;
+		iterator sg = first;
+		bool rebuilt = false;
+		for (size_t j = p; j < q && !rebuilt; ++j, ++sg) {
+			const value_type* f = seg::begin(*sg);
+			size_t s = seg::size(*sg);
+			size_t a = 0;
+			size_t front = 0;
+			bool stayed = false;
+			while (a < s && !rebuilt) {
+				size_t y = k + a;
+				size_t b;
+				bool changed = true;
+				if (y >= c && y < c + n) {
+					b = std::min(s, c + n - k);
+				}
+				else {
+					size_t _y = y < c ? y : y + e - n;
+					while (_y >= old_end) next_old();
+					b = std::min(s, (y < c ? std::min(c, old_end) : old_end + n - e) - k);
+					changed = old_id != ids[j];
+					if (!changed && !stayed) {
+						stayed = true;
+						bases[j] = static_cast<segment_size_t>(bases[j] + (_y - old_begin) - a);
+						rebuilt = !reserve(front);
+						if (!rebuilt) enter_keys(f, 0, front, j);
+					}
+				}
+				if (changed && !rebuilt) {
+					if (!stayed) front = b;
+					else if (reserve(b - a)) enter_keys(f, a, b, j);
+					else rebuilt = true;
+				}
+				a = b;
+			}
+			if (!stayed && !rebuilt) {
+				rebuilt = !reserve(front);
+				if (!rebuilt) enter_keys(f, 0, front, j);
+			}
+			k = k + s;
+		}
+		seen(first, last);
+	}
+
+	void reset() {
+		slots.clear();
+		used = 0;
+		ids.clear();
+		positions.clear();
+		free_ids.clear();
+		erased_ids.clear();
+		sizes.clear();
+		bases.clear();
+		erased_segments.clear();
+	}
+
+public:
+	using I::I;
+	hashed_index() = default;
+	hashed_index(hashed_index&& other) :
+		I(std::move(other)),
+		slots(std::move(other.slots)),
+		used(other.used),
+		ids(std::move(other.ids)),
+		positions(std::move(other.positions)),
+		free_ids(std::move(other.free_ids)),
+		erased_ids(std::move(other.erased_ids)),
+		sizes(std::move(other.sizes)),
+		bases(std::move(other.bases)),
+		erased_segments(std::move(other.erased_segments)),
+		hash(std::move(other.hash))
+	{
+		other.reset();
+	}
+	// Copy of the index holds no segments, like the copy of "I"
+	hashed_index(const hashed_index& other) : I(other), hash(other.hash) {}
+
+	hashed_index& operator=(hashed_index&& other) {
+		if (this == &other) return *this;
+		I::operator=(std::move(other));
+		slots = std::move(other.slots);
+		used = other.used;
+		ids = std::move(other.ids);
+		positions = std::move(other.positions);
+		free_ids = std::move(other.free_ids);
+		erased_ids = std::move(other.erased_ids);
+		sizes = std::move(other.sizes);
+		bases = std::move(other.bases);
+		erased_segments = std::move(other.erased_segments);
+		hash = std::move(other.hash);
+		other.reset();
+		return *this;
+	}
+	hashed_index& operator=(const hashed_index& other) {
+		if (this == &other) return *this;
+		I::operator=(other);
+		reset();
+		hash = other.hash;
+		return *this;
+	}
+
+	// Keys of the new segments are entered once the index is notified of them
+	iterator insert(iterator it, size_type n) {
+		size_t p = static_cast<size_t>(it - I::begin());
+		it = I::insert(it, n);
+		ids.insert(ids.begin() + p, static_cast<size_t>(n), no_id);
+		for (size_t j = p; j < p + static_cast<size_t>(n); ++j) ids[j] = take_id();
+		sizes.insert(sizes.begin() + p, static_cast<size_t>(n), segment_size_t(0));
+		bases.insert(bases.begin() + p, static_cast<size_t>(n), segment_size_t(0));
+		for (erased_segment& g : erased_segments) {
+			if (g.position > p) g.position = g.position + static_cast<size_t>(n);
+		}
+		renumber(p);
+		return it;
+	}
+
+	iterator erase(iterator first, iterator last) {
+		size_t p = static_cast<size_t>(first - I::begin());
+		size_t n = static_cast<size_t>(last - first);
+		first = I::erase(first, last);
+		// Erased segments go in front of the ones which were erased before and came after them
+		std::vector<erased_segment> gs;
+		gs.reserve(erased_segments.size() + n);
+		auto g = erased_segments.begin();
+		for (; g != erased_segments.end() && g->position <= p; ++g) gs.push_back(*g);
+		for (size_t j = p; j < p + n; ++j) {
+			for (; g != erased_segments.end() && g->position <= j; ++g) gs.push_back(erased_segment{ p, g->id, g->size });
+			gs.push_back(erased_segment{ p, ids[j], sizes[j] });
+			positions[ids[j]] = no_id;
+			erased_ids.push_back(ids[j]);
+		}
+		for (; g != erased_segments.end(); ++g) gs.push_back(erased_segment{ g->position - n, g->id, g->size });
+		erased_segments.swap(gs);
+		ids.erase(ids.begin() + p, ids.begin() + (p + n));
+		sizes.erase(sizes.begin() + p, sizes.begin() + (p + n));
+		bases.erase(bases.begin() + p, bases.begin() + (p + n));
+		renumber(p);
+		// Ids aren't kept for more erased segments than there are segments
+		if (erased_ids.size() > ids.size()) purge();
+		return first;
+	}
+
+	void clear() {
+		erase(I::begin(), I::end());
+	}
+
+	// Number of the segment which the table names for "k", and the position inside it where "k" is expected, which is
+	// never past its end; "no_segment" if the table names none. Segment may not hold "k".
+	std::pair<size_t, size_t> hashed_position(const key_type& k) const {
+		if (slots.empty()) return { no_segment, 0 };
+		const slot& s = slots[find_slot(hash64(k))];
+		if (s.id == no_id || positions[s.id] == no_id) return { no_segment, 0 };
+		size_t j = positions[s.id];
+		size_t o = static_cast<segment_size_t>(s.offset - bases[j]);
+		size_t m = seg::size(*(I::begin() + j));
+		// Position which drifted in front of the segment wraps around
+		if (o > m) o = o - m < size_t(1 << 16) - o ? m : 0;
+		return { j, o };
+	}
+
+	size_t hashed_segment(const key_type& k) const {
+		return hashed_position(k).first;
+	}
+
+	// Number of slots of the table
+	size_t table_size() const { return slots.size(); }
+
+	friend
+	iterator insert(hashed_index& i, iterator it, size_type n) {
+		return i.insert(it, n);
+	}
+
+	friend
+	iterator erase(hashed_index& i, iterator first, iterator last) {
+		return i.erase(first, last);
+	}
+
+	friend
+	iterator insert(hashed_index& i, iterator it) {
+		return i.insert(it, 1);
+	}
+
+	friend
+	iterator erase(hashed_index& i, iterator it) {
+		return i.erase(it, it + 1);
+	}
+
+	friend
+	void update_segments(hashed_index& i, iterator first, iterator last) {
+		update_segments(static_cast<I&>(i), first, last);
+		i.update(first, last);
+	}
+
+	friend
+	void update_segments(hashed_index& i, iterator first, iterator last, std::pair<iterator, size_t> it, size_t n, size_t e) {
+		update_segments(static_cast<I&>(i), first, last, it, n, e);
+		i.update(first, last, it, n, e);
+	}
+};
+
+template<typename I, typename = void>
+// I models SegmentIndex
+struct is_hashed_index : std::false_type {};
+
+template<typename I>
+// I models SegmentIndex
+struct is_hashed_index<I, std::void_t<typename I::hasher>> : std::true_type {};
+
+//************************************************************************
+// ~HASHED INDEX
+//************************************************************************
+
+
+
+
+
+
+
+
+
+template<typename T, typename I>
+// I models SegmentIndex
+class list_tmp
+{
+public:
+	using index = I;
+	using allocator = AllocatorType<index>;
+	using value_type = ValueType<index>;
+	using header_iterator = Iterator<index>;
+	using const_header_iterator = ConstIterator<index>;
+	using flat_iterator = value_type*;
+	using const_flat_iterator = value_type *;
+	using segment_iterator = seg::segment_iterator<header_iterator>;
+	using const_segment_iterator = seg::const_segment_iterator<header_iterator, const_header_iterator>;
+	using segmented_coordinate = seg::segmented_coordinate<segment_iterator, const_segment_iterator>;
+	using const_segmented_coordinate = seg::const_segmented_coordinate<segment_iterator, const_segment_iterator>;
+	using iterator = segmented_coordinate;
+	using size_type = seg::size_t;
+	using find_adaptor = flat::find_adaptor_binary;
+	using equal_range_find_adaptor = flat::equal_range_adaptor_binary;
+
+	segmented_coordinate coordinate_from_const(const_segmented_coordinate it) {
+		return segmented_coordinate(segment_iterator_from_const(it._seg), const_cast<flat_iterator>(it._flat));
+	}
+
+private:
+	index in;
+	size_type s;
+
+	segment_iterator segment_iterator_from_const(const_segment_iterator it) {
+		return segment_iterator(flat::successor(std::begin(in), it.h - std::cbegin(in)));
+	}
+	std::pair<header_iterator, size_t> header_from_coordinate(segmented_coordinate c) {
+		if (c._seg.h != in.end() || empty())
+			return { header_iterator(c._seg.h), static_cast<size_t>(c._flat - seg::begin(*c._seg.h)) };
+		return { header_iterator(c._seg.h - 1), seg::size(*(c._seg.h - 1)) };
+	}
+
+
+	const_segmented_coordinate coordinate_unguarded(const std::pair<header_iterator, size_t>& r) const {
+		if (r.second == seg::size(*r.first))
+			return const_segmented_coordinate(const_segment_iterator(r.first + 1), seg::begin(*(r.first + 1)));
+		return const_segmented_coordinate(const_segment_iterator(r.first), flat::successor(seg::cbegin(*r.first), r.second));
+	}
+	segmented_coordinate coordinate_unguarded(const std::pair<header_iterator, size_t>& r) {
+		if (r.second == seg::size(*r.first))
+			return segmented_coordinate(segment_iterator(r.first + 1), seg::begin(*(r.first + 1)));
+		return segmented_coordinate(segment_iterator(r.first), flat::successor(seg::begin(*r.first), r.second));
+	}
+	const_segmented_coordinate coordinate(const std::pair<header_iterator, size_t>& r) const {
+		if (r.first == std::end(in))
+			return const_segmented_coordinate(const_segment_iterator(r.first), seg::begin(*r.first));
+		return coordinate_unguarded(r);
+	}
+	segmented_coordinate coordinate(const std::pair<header_iterator, size_t>& r) {
+		if (r.first == std::end(in))
+			return segmented_coordinate(segment_iterator(r.first), seg::begin(*r.first));
+		return coordinate_unguarded(r);
+	}
+
+
+	// Positions of the new elements are uninitialized; once they are constructed, the index is notified of
+	// the returned range of changed segments.
+	std::pair<segmented_coordinate, std::pair<header_iterator, header_iterator>> __insert(std::pair<header_iterator, seg::size_t> it) {
+		auto [r, changed] = seg::_insert_to_segment_range(in, it.first, it.second, 1);
+		s = s + 1;
+		return { coordinate_unguarded(r.first), changed };
+	}
+	std::pair<std::pair<segmented_coordinate, segmented_coordinate>, std::pair<header_iterator, header_iterator>> __insert(
+		std::pair<header_iterator, seg::size_t> it, size_type n) {
+		auto [r, changed] = seg::_insert_to_segment_range(in, it.first, it.second, static_cast<seg::size_t>(n));
+		s = s + n;
+		return { { coordinate_unguarded(r.first), coordinate_unguarded(r.second) }, changed };
+	}
+
+
+	std::pair<segmented_coordinate, std::pair<header_iterator, header_iterator>> _insert(segmented_coordinate it) {
+		return __insert(header_from_coordinate(it));
+	}
+	std::pair<std::pair<segmented_coordinate, segmented_coordinate>, std::pair<header_iterator, header_iterator>> _insert(
+		segmented_coordinate it, size_type n) {
+		return __insert(header_from_coordinate(it), n);
+	}
+
+
+	segmented_coordinate __erase(std::pair<header_iterator, seg::size_t> left, std::pair<header_iterator, seg::size_t> right) {
+		auto [it, i, _s] = seg::erase_from_segment_range(in, left.first, left.second, right.first, right.second);
+		s = s - _s;
+		return coordinate(std::make_pair(it, i));
+	}
+
+
+	segmented_coordinate _erase(segmented_coordinate left, segmented_coordinate right) {
+		return __erase(header_from_coordinate(left), header_from_coordinate(right));
+	}
+
+
+	segmented_coordinate _erase(segmented_coordinate left) {
+		return __erase(header_from_coordinate(left), header_from_coordinate(successor(left, 1)));
+	}
+
+	std::pair<segmented_coordinate, segmented_coordinate> _assign(size_type n, double fill) {
+		clear();
+		if (n == 0) return { end(), end() };
+		size_t c = segment_capacity(in);
+		size_t f = static_cast<size_t>(static_cast<double>(c) * fill);
+		auto [_begin, _end] = seg::insert_empty_filled(in, static_cast<size_t>(n), std::min(std::max(f, (c + 1) / 2), c));
+		s = n;
+		return { coordinate_unguarded(_begin), coordinate_unguarded(_end) };
+	}
+
+	void copy_from(const list_tmp& other) {
+		if (!other.empty()) insert(begin(), std::cbegin(other), other.s);
+	}
+
+	template<typename It, typename Cmp>
+	// It models InputIterator
+	// Cmp models StrictWeakOrdering
+	// Domain<Cmp> == value_type
+	segmented_coordinate _merge(segmented_coordinate it, It first, size_type n, Cmp cmp) {
+		if (n == 0) return it;
+		// Room for all "n" elements is made at once, in front of "it", in the minimal number of new segments
+		auto [r, changed] = _insert(it, n);
+		auto [d, x] = r;
+		segmented_coordinate l = end();
+		// Positions [d, x) are uninitialized until "n" of them are written; the rest hold moved from elements
+		size_type m = n;
+		size_type w = 0;
+		while (m) {
+			if (x != l && !cmp(*first, *x)) {
+				if (w < n) construct_at(d, std::move(*x));
+				else *d = std::move(*x);
+				++x;
+			}
+			else {
+				if (w < n) construct_at(d, *first);
+				else *d = *first;
+				++first;
+				--m;
+			}
+			++d;
+			++w;
+		}
+		// Elements were moved up to "x", which can be past the segments changed by the insertion
+		header_iterator last = x._seg.h == std::end(in) ? x._seg.h : x._seg.h + 1;
+		update_segments(in, changed.first, std::max(changed.second, last));
+		return d;
+	}
+
+public:
+	list_tmp(allocator&& alloc = allocator()) : in(std::move(alloc)), s(0) {}
+	list_tmp(list_tmp&& other) : in(std::move(other.in)), s(other.s) { other.s = 0; }
+	list_tmp(const allocator& alloc) : in(alloc), s(0) {}
+	list_tmp(const list_tmp& other) : in(other.in), s(0) { copy_from(other); }
+	// Bulk load of the range [first, first + n)(see "assign")
+	template<typename It>
+	// It models InputIterator
+	// IteratorValueType<It> == value_type
+	list_tmp(It first, size_type n, double fill, allocator&& alloc = allocator()) : in(std::move(alloc)), s(0) {
+		assign(first, n, fill);
+	}
+	~list_tmp() { clear(); }
+
+	list_tmp& operator=(list_tmp&& other) {
+		if (this == &other) return *this;
+		clear();
+		in = std::move(other.in);
+		s = other.s;
+		other.s = 0;
+		return *this;
+	}
+	list_tmp& operator=(const list_tmp& other) {
+		if (this == &other) return *this;
+		clear();
+		copy_from(other);
+		return *this;
+	}
+
+	friend
+	bool operator==(const list_tmp& x, const list_tmp& y) {
+		if (x.size() != y.size()) return false;
+		return seg::equal(std::cbegin(x), std::cend(x), std::cbegin(y));
+	}
+	friend
+	bool operator!=(const list_tmp& x, const list_tmp& y) {
+		return !(x == y);
+	}
+
+	friend
+	bool operator<(const list_tmp& x, const list_tmp& y) {
+		return seg::lexicographical_compare(std::cbegin(x), std::cend(x), std::cbegin(y), std::cend(y)) < 0;
+	}
+	friend
+	bool operator>(const list_tmp& x, const list_tmp& y) {
+		return y < x;
+	}
+	friend
+	bool operator<=(const list_tmp& x, const list_tmp& y) {
+		return !(y < x);
+	}
+	friend
+	bool operator>=(const list_tmp& x, const list_tmp& y) {
+		return !(x < y);
+	}
+
+	bool empty() const { return in.empty(); }
 
 	size_type size() const { return s; }
 
+	const index& segment_index() const { return in; }
+
 	void swap(index& _in, size_type& _s) {
 		std::swap(_in, in);
 		std::swap(_s, s);
 	}
 
-	segmented_coordinate begin() {
-		segment_iterator fseg = segment_iterator(std::begin(in));
-		return segmented_coordinate(fseg, std::begin(fseg));
+	segmented_coordinate begin() {
+		segment_iterator fseg = segment_iterator(std::begin(in));
+		return segmented_coordinate(fseg, std::begin(fseg));
+	}
+	segmented_coordinate end() {
+		segment_iterator lseg = segment_iterator(std::end(in));
+		return segmented_coordinate(lseg, std::begin(lseg));
+	}
+	const_segmented_coordinate cbegin() const {
+		const_segment_iterator fseg = const_segment_iterator(std::begin(in));
+		return const_segmented_coordinate(fseg, std::begin(fseg));
+	}
+	const_segmented_coordinate cend() const {
+		const_segment_iterator lseg = const_segment_iterator(std::end(in));
+		return const_segmented_coordinate(lseg, std::begin(lseg));
+	}
+	const_segmented_coordinate begin() const { return cbegin(); }
+	const_segmented_coordinate end() const { return cend(); }
+
+	// Order statistics. If the index keeps sizes of its segments(models "CountedSegmentIndex"), they all
+	// take logarithmic time in the number of segments; otherwise they walk segment by segment.
+
+	// Coordinate of the "i"-th element; for "i" equal to "size()" it's "end()"
+	segmented_coordinate nth(size_type i) {
+		if constexpr (is_counted_index<index>::value) {
+			auto [h, j] = in.segment_of(static_cast<size_t>(i));
+			return segmented_coordinate(segment_iterator(h), flat::successor(seg::begin(*h), j));
+		}
+		else {
+			return seg::successor(begin(), i);
+		}
+	}
+	const_segmented_coordinate nth(size_type i) const {
+		if constexpr (is_counted_index<index>::value) {
+			auto [h, j] = in.segment_of(static_cast<size_t>(i));
+			return const_segmented_coordinate(const_segment_iterator(h), flat::successor(seg::begin(*h), j));
+		}
+		else {
+			return seg::successor(begin(), i);
+		}
+	}
+
+	// Number of elements before "it"
+	size_type rank(const_segmented_coordinate it) const {
+		if constexpr (is_counted_index<index>::value) {
+			return static_cast<size_type>(in.prefix_size(it._seg.h) + static_cast<size_t>(it._flat - std::begin(it._seg)));
+		}
+		else {
+			return static_cast<size_type>(seg::distance(begin(), it));
+		}
+	}
+
+	std::ptrdiff_t distance(const_segmented_coordinate first, const_segmented_coordinate last) const {
+		if constexpr (is_counted_index<index>::value) {
+			return static_cast<std::ptrdiff_t>(rank(last)) - static_cast<std::ptrdiff_t>(rank(first));
+		}
+		else {
+			return static_cast<std::ptrdiff_t>(seg::distance(first, last));
+		}
+	}
+
+	segmented_coordinate successor(segmented_coordinate it, size_type n) {
+		if constexpr (is_counted_index<index>::value) {
+			if (n < static_cast<size_type>(std::end(it._seg) - it._flat))
+				return segmented_coordinate(it._seg, flat::successor(it._flat, n));
+			return nth(rank(it) + n);
+		}
+		else {
+			return seg::successor(it, n);
+		}
 	}
-	segmented_coordinate end() {
-		segment_iterator lseg = segment_iterator(std::end(in));
-		return segmented_coordinate(lseg, std::begin(lseg));
+	const_segmented_coordinate successor(const_segmented_coordinate it, size_type n) const {
+		if constexpr (is_counted_index<index>::value) {
+			if (n < static_cast<size_type>(std::end(it._seg) - it._flat))
+				return const_segmented_coordinate(it._seg, flat::successor(it._flat, n));
+			return nth(rank(it) + n);
+		}
+		else {
+			return seg::successor(it, n);
+		}
 	}
-	const_segmented_coordinate cbegin() {
-		const_segment_iterator fseg = const_segment_iterator(std::begin(in));
-		return const_segmented_coordinate(fseg, const_flat_iterator(std::begin(fseg)));
+
+	segmented_coordinate predecessor(segmented_coordinate it, size_type n) {
+		if constexpr (is_counted_index<index>::value) {
+			if (n <= static_cast<size_type>(it._flat - std::begin(it._seg)))
+				return segmented_coordinate(it._seg, flat::predecessor(it._flat, n));
+			return nth(rank(it) - n);
+		}
+		else {
+			return seg::predecessor(it, n);
+		}
 	}
-	const_segmented_coordinate cend() {
-		const_segment_iterator lseg = const_segment_iterator(std::end(in));
-		return const_segmented_coordinate(lseg, const_flat_iterator(std::begin(lseg)));
+	const_segmented_coordinate predecessor(const_segmented_coordinate it, size_type n) const {
+		if constexpr (is_counted_index<index>::value) {
+			if (n <= static_cast<size_type>(it._flat - std::begin(it._seg)))
+				return const_segmented_coordinate(it._seg, flat::predecessor(it._flat, n));
+			return nth(rank(it) - n);
+		}
+		else {
+			return seg::predecessor(it, n);
+		}
 	}
-	const_segmented_coordinate begin() const { return cbegin(); }
-	const_segmented_coordinate end() const { return cend(); }
 
 	template<typename I>
 	// I models InnputIterator
 	// IteratorValueType<I> == value_type
 	std::pair<segmented_coordinate, segmented_coordinate> insert_move(segmented_coordinate it, I first, size_type n) {
-		std::pair<segmented_coordinate, segmented_coordinate> r = _insert(it, static_cast<seg::size_t>(n));
+		auto [r, changed] = _insert(it, static_cast<seg::size_t>(n));
 		seg::move_flat_n_seg_uninitialized(first, n, r.first);
+		update_segments(in, changed.first, changed.second, header_from_coordinate(r.first), static_cast<size_t>(n), size_t(0));
 		return r;
 	}
 
@@ -1596,21 +4842,89 @@ public:
 	// I models InnputIterator
 	// IteratorValueType<I> == value_type
 	std::pair<segmented_coordinate, segmented_coordinate> insert(segmented_coordinate it, I first, size_type n) {
-		std::pair<segmented_coordinate, segmented_coordinate> r = _insert(it, static_cast<seg::size_t>(n));
+		auto [r, changed] = _insert(it, static_cast<seg::size_t>(n));
+		seg::copy_flat_n_seg_uninitialized(first, n, r.first);
+		update_segments(in, changed.first, changed.second, header_from_coordinate(r.first), static_cast<size_t>(n), size_t(0));
+		return r;
+	}
+
+	// Elements are replaced by the range [first, first + n), laid out in the segments so that each of them is filled
+	// to "fill" of its capacity(clamped to [0.5, 1]). All segments are allocated at once, and filled segment by segment.
+	// Lower "fill" leaves room for later insertions, which then don't have to split the segments.
+	template<typename It>
+	// It models InputIterator
+	// IteratorValueType<It> == value_type
+	std::pair<segmented_coordinate, segmented_coordinate> assign(It first, size_type n, double fill = 1.0) {
+		std::pair<segmented_coordinate, segmented_coordinate> r = _assign(n, fill);
 		seg::copy_flat_n_seg_uninitialized(first, n, r.first);
+		update_segments(in, std::begin(in), std::end(in));
+		return r;
+	}
+
+	template<typename It>
+	// It models InputIterator
+	// IteratorValueType<It> == value_type
+	std::pair<segmented_coordinate, segmented_coordinate> assign_move(It first, size_type n, double fill = 1.0) {
+		std::pair<segmented_coordinate, segmented_coordinate> r = _assign(n, fill);
+		seg::move_flat_n_seg_uninitialized(first, n, r.first);
+		update_segments(in, std::begin(in), std::end(in));
 		return r;
 	}
 
+	// Elements of the sorted range [first, first + n) are merged into the sorted range which starts at "it": each of them
+	// goes in front of the first element it's less than. Elements after "it" are moved only up to the last such element.
+	// Returns the end of the merged range.
+	template<typename It, typename Cmp>
+	// It models InputIterator
+	// IteratorValueType<It> == value_type
+	// Cmp models StrictWeakOrdering
+	// Domain<Cmp> == value_type
+	segmented_coordinate insert_merge(segmented_coordinate it, It first, size_type n, Cmp cmp) {
+		return _merge(it, first, n, cmp);
+	}
+
+	template<typename It, typename Cmp>
+	// It models InputIterator
+	// IteratorValueType<It> == value_type
+	// Cmp models StrictWeakOrdering
+	// Domain<Cmp> == value_type
+	segmented_coordinate insert_move_merge(segmented_coordinate it, It first, size_type n, Cmp cmp) {
+		return _merge(it, std::make_move_iterator(first), n, cmp);
+	}
+
+	// Elements of the segment "sg" are replaced by the range [first, first + n), which is moved. Segment is balanced
+	// with its neighbours only once, by inserting or erasing the difference at its end. Returns the end of the new
+	// elements.
+	template<typename It>
+	// It models InputIterator
+	// IteratorValueType<It> == value_type
+	segmented_coordinate replace_segment_move(segment_iterator sg, It first, size_type n) {
+		auto f = std::begin(sg);
+		size_type m = static_cast<size_type>(std::end(sg) - f);
+		for (size_type i = 0; i < std::min(m, n); ++i) {
+			f[i] = std::move(*first);
+			++first;
+		}
+		update_segments(in, sg.h, sg.h + 1);
+		if (n > m)
+			return insert_move(segmented_coordinate(sg, flat::successor(f, m)), first, n - m).second;
+		if (n < m)
+			return erase(segmented_coordinate(sg, flat::successor(f, n)), segmented_coordinate(sg, flat::successor(f, m)));
+		return coordinate_unguarded({ sg.h, static_cast<size_t>(n) });
+	}
+
 	segmented_coordinate insert(segmented_coordinate it, value_type&& v) {
-		it = _insert(it);
-		construct_at(it, std::move(v));
-		return it;
+		auto [_it, changed] = _insert(it);
+		construct_at(_it, std::move(v));
+		update_segments(in, changed.first, changed.second, header_from_coordinate(_it), size_t(1), size_t(0));
+		return _it;
 	}
 
 	segmented_coordinate insert(segmented_coordinate it, const value_type& v) {
-		it = _insert(it);
-		construct_at(it, v);
-		return it;
+		auto [_it, changed] = _insert(it);
+		construct_at(_it, v);
+		update_segments(in, changed.first, changed.second, header_from_coordinate(_it), size_t(1), size_t(0));
+		return _it;
 	}
 
 	template<typename I>
@@ -1670,12 +4984,108 @@ using list_big_header = list_tmp<T, big_header_index<T, C, A>>;
 template<typename T, std::size_t C, typename A>
 using list_small_header = list_tmp<T, small_header_index<T, C, A>>;
 
+template<typename T, std::size_t C, typename A, std::size_t P = default_area_pool_bits>
+using list_compact_header = list_tmp<T, compact_header_index<T, C, A, P>>;
+
+template<typename T, std::size_t C, typename A>
+using list_gapped_header = list_tmp<T, gapped_header_index<T, C, A>>;
+
+template<typename T, std::size_t C, typename A>
+using list_growing_header = list_tmp<T, growing_header_index<T, C, A>>;
+
+template<typename T, std::size_t C, typename A, std::size_t B = default_header_block_capacity>
+using list_blocked_header = list_tmp<T, blocked_header_index<T, C, A, B>>;
+
+template<typename T, std::size_t C, typename A>
+using list_mapped_big_header = list_tmp<T, big_header_index<T, C, A, mapped_array<big_segment_header<T, C>>>>;
+
+template<typename T, std::size_t C, typename A>
+using list_counted_big_header = list_tmp<T, counted_index<big_header_index<T, C, A>>>;
+
+template<typename T, std::size_t C, typename A, typename VK>
+using list_fenced_big_header = list_tmp<T, fenced_index<big_header_index<T, C, A>, VK>>;
+
+template<typename T, std::size_t C, typename A, typename VK, std::size_t E = 16>
+using list_learned_big_header = list_tmp<T, fenced_index<big_header_index<T, C, A>, VK, learned_fence_locator<E>>>;
+
+template<typename T, std::size_t C, typename A, typename VK, std::size_t S = default_sample_stride>
+using list_sampled_big_header = list_tmp<T, sampled_index<big_header_index<T, C, A>, VK, S>>;
+
+template<typename T, std::size_t C, typename A, typename VK>
+using list_hashed_big_header = list_tmp<T, hashed_index<big_header_index<T, C, A>, VK>>;
+
 template<typename T, std::size_t C, typename A>
 using list = list_big_header<T, C, A>;
 
 
 
 
+// Immutable copy of the fence keys(last keys of the segments) in Eytzinger(breadth first) order.
+// Top levels of the implicit tree share cache lines for all searches, and the nodes four levels below
+// the current one are prefetched, so a search has about one cache miss for every four levels.
+template<typename K>
+// K models Regular
+struct eytzinger_fences
+{
+	// Children of keys[i] are keys[2i] and keys[2i + 1]; keys[0] isn't used.
+	// Fence keys[i] belongs to the segments[i]-th segment.
+	std::vector<K> keys;
+	std::vector<std::size_t> segments;
+
+	// Nodes this many levels below the current one are prefetched
+	static constexpr std::size_t prefetch_levels = 4;
+
+	bool empty() const { return keys.empty(); }
+	std::size_t size() const { return keys.empty() ? 0 : keys.size() - 1; }
+
+	void clear() {
+		keys.clear();
+		segments.clear();
+	}
+
+	template<typename I>
+	// I models InputIterator
+	// IteratorValueType<I> == K
+	void _build(I& first, std::size_t& j, std::size_t i) {
+		if (i >= keys.size()) return;
+		_build(first, j, 2 * i);
+		keys[i] = *first;
+		segments[i] = j;
+		++first;
+		++j;
+		_build(first, j, 2 * i + 1);
+	}
+
+	template<typename I>
+	// I models InputIterator
+	// IteratorValueType<I> == K
+	void build(I first, std::size_t n) {
+		keys.assign(n + 1, K());
+		segments.assign(n + 1, 0);
+		std::size_t j = 0;
+		_build(first, j, 1);
+	}
+
+	// Number of the first segment whose fence key doesn't satisfy "p"; size() if there isn't one
+	template<typename P>
+	// P models UnaryPredicate
+	// Domain<P> == K
+	std::size_t partition_point(P p) const {
+		// precondition: keys are partitioned by "p"
+		const std::size_t n = keys.size();
+		const K* k = keys.data();
+		std::size_t i = 1;
+		while (i < n) {
+			std::size_t ahead = i << prefetch_levels;
+			if (ahead < n) prefetch(k + ahead);
+			i = 2 * i + static_cast<std::size_t>(p(k[i]));
+		}
+		// Right turns at the bottom of the path are undone; the last left turn was made at the result
+		i = i >> (count_trailing_zeros(~static_cast<std::uint64_t>(i)) + 1);
+		return i == 0 ? size() : segments[i];
+	}
+};
+
 template<typename K, typename M, typename Cmp, typename SList, typename CmpAdapt, typename VK, typename FAdaptor, typename EqualRangeFAdaptor>
 // SList models SegmentedList
 // Cmp models StrictWeakOrdering
@@ -1704,21 +5114,47 @@ public:
 	using find_adaptor = FAdaptor;
 	using equal_range_find_adaptor = EqualRangeFAdaptor;
 
-private:
-	struct _move {
-		template<typename T>
-		T&& operator()(T& x) const {
-			return std::move(x);
+	// Operation of "apply_batch": insertion of "value()", erasure of the elements with the key "first()", or erasure of
+	// the elements with the keys in [first(), last()). Operations are ordered by "first()". Only the value or the
+	// keys which the operation needs are held, in the alternative of "payload" selected by its kind.
+	struct operation
+	{
+		enum kind_type { insert_value, erase_key, erase_keys };
+
+		std::variant<value_type, key_type, std::pair<key_type, key_type>> payload;
+
+		kind_type kind() const { return static_cast<kind_type>(payload.index()); }
+
+		const value_type& value() const { return std::get<insert_value>(payload); }
+
+		const key_type& first() const {
+			switch (kind()) {
+			case insert_value: return value_to_key::get(std::get<insert_value>(payload));
+			case erase_key: return std::get<erase_key>(payload);
+			default: return std::get<erase_keys>(payload).first;
+			}
 		}
-	};
 
-	struct _copy {
-		template<typename T>
-		const T& operator()(const T& x) const {
-			return x;
+		const key_type& last() const {
+			if (kind() == erase_keys) return std::get<erase_keys>(payload).second;
+			return first();
+		}
+
+		static operation insert(const value_type& v) {
+			return { decltype(payload)(std::in_place_index<insert_value>, v) };
+		}
+		static operation insert(value_type&& v) {
+			return { decltype(payload)(std::in_place_index<insert_value>, std::move(v)) };
+		}
+		static operation erase(const key_type& k) {
+			return { decltype(payload)(std::in_place_index<erase_key>, k) };
+		}
+		static operation erase_range(const key_type& first, const key_type& last) {
+			return { decltype(payload)(std::in_place_index<erase_keys>, first, last) };
 		}
 	};
 
+private:
 	struct equal_adaptor
 	{
 		compare_adaptor cmp;
@@ -1729,33 +5165,322 @@ private:
 		}
 	};
 
+	// Predicate "P" of the given key, over values
+	template<typename P>
+	struct key_predicate
+	{
+		key_compare cmp;
+		key_predicate(key_compare cmp) : cmp(cmp) {}
+
+		value_key_predicate<P, value_to_key> operator()(const key_type& k) const {
+			return P(k, cmp);
+		}
+	};
+
+	using lower_bound_key = key_predicate<lower_bound_predicate<key_type, key_compare>>;
+	using upper_bound_key = key_predicate<upper_bound_predicate<key_type, key_compare>>;
+
 	segmented_list list;
 	compare_adaptor cmp;
+	// Fence keys of the frozen container; empty if the container isn't frozen
+	eytzinger_fences<key_type> frozen_fences;
+	bool segment_cache = false;
+	// Number of the segment which held the result of the last cached lookup; it's only where the search starts,
+	// so lookups from several threads may overwrite it in any order
+	mutable std::atomic<size_t> cached_segment{ 0 };
+
+	// Segment, starting from the "first"-th one, which holds the partition point of "p"; only fence keys are searched
+	template<typename P>
+	// P models UnaryPredicate
+	// Domain<P> == key_type
+	size_t fence_partition_point(size_t first, const key_type& k, P p) const {
+		return list.segment_index().fence_partition_point(first, k, p);
+	}
+
+	// Partition point of "p" inside the "j"-th segment
+	template<typename C, typename P>
+	// C models SegmentedCoordinate
+	// P models UnaryPredicate
+	// Domain<P> == key_type
+	C fenced_coordinate(C first, size_t j, P p) const {
+		// precondition: first == begin()
+		SegmentIterator<C> fseg = seg::segment(first) + static_cast<IteratorDifferenceType<SegmentIterator<C>>>(j);
+		if (j == list.segment_index().size()) return C(fseg, std::begin(fseg));
+		if constexpr (is_sampled_index<index>::value) {
+			auto [lo, hi] = list.segment_index().sample_partition_range(j, p);
+			FlatIterator<C> f = std::begin(fseg);
+			return C(fseg, find_adaptor()(flat::successor(f, lo), flat::successor(f, hi), value_key_predicate<P, value_to_key>(p)));
+		}
+		else return C(fseg, find_adaptor()(std::begin(fseg), std::end(fseg), value_key_predicate<P, value_to_key>(p)));
+	}
+
+	template<typename C>
+	// C models SegmentedCoordinate
+	C fenced_lower_bound(C first, const key_type& k) const {
+		lower_bound_predicate<key_type, key_compare> p(k, key_comp());
+		return fenced_coordinate(first, fence_partition_point(0, k, p), p);
+	}
+
+	template<typename C>
+	// C models SegmentedCoordinate
+	C fenced_upper_bound(C first, const key_type& k) const {
+		upper_bound_predicate<key_type, key_compare> p(k, key_comp());
+		return fenced_coordinate(first, fence_partition_point(0, k, p), p);
+	}
+
+	template<typename C>
+	// C models SegmentedCoordinate
+	std::pair<C, C> fenced_equal_range(C first, const key_type& k) const {
+		lower_bound_predicate<key_type, key_compare> lp(k, key_comp());
+		upper_bound_predicate<key_type, key_compare> up(k, key_comp());
+		size_t lj = fence_partition_point(0, k, lp);
+		size_t uj = fence_partition_point(lj, k, up);
+		return { fenced_coordinate(first, lj, lp), fenced_coordinate(first, uj, up) };
+	}
+
+	static constexpr size_t no_segment = size_t(-1);
+
+	// The "j"-th segment, or one of its neighbours, if it holds the partition point of "p"; otherwise "no_segment".
+	// Segments are checked by their current last elements, so a remembered number stays usable after any change.
+	template<typename P>
+	// P models UnaryPredicate
+	// Domain<P> == key_type
+	size_t nearby_segment_partition_point(size_t j, P p) const {
+		const index& in = list.segment_index();
+		const size_t n = in.size();
+		// Segment "i" holds the partition point if its last element is the first one which doesn't satisfy "p"
+		auto fails = [&](size_t i) {
+			return i == n || !p(value_to_key::get(*flat::predecessor(seg::end(*flat::successor(std::cbegin(in), i)), 1)));
+		};
+		j = std::min(j, n);
+		if (fails(j)) {
+			if (j == 0 || !fails(j - 1)) return j;
+			if (j == 1 || !fails(j - 2)) return j - 1;
+		}
+		else if (fails(j + 1)) return j + 1;
+		return no_segment;
+	}
+
+	// Segment which holds the partition point of "p", searched as by "lower_bound" and "upper_bound"
+	template<typename P>
+	// P models UnaryPredicate
+	// Domain<P> == key_type
+	size_t segment_partition_point(const key_type& k, P p) const {
+		if (frozen()) return frozen_fences.partition_point(p);
+		if constexpr (is_fenced_index<index>::value) return fence_partition_point(0, k, p);
+		else {
+			const_segment_iterator fseg = seg::segment(cbegin());
+			const_segment_iterator s = seg::partition_point_segments_branchless(fseg, seg::segment(cend()), value_key_predicate<P, value_to_key>(p));
+			return static_cast<size_t>(std::distance(fseg, s));
+		}
+	}
 
-	template<typename I, typename C>
-	void insert_sorted(segmented_coordinate it, I first, size_type n, C c) {
-		if (n == 0) return;
+	template<typename C, typename P>
+	// C models SegmentedCoordinate
+	// P models UnaryPredicate
+	// Domain<P> == key_type
+	C cached_coordinate(C first, const key_type& k, P p) const {
+		// precondition: first == begin()
+		size_t j = nearby_segment_partition_point(cached_segment.load(std::memory_order_relaxed), p);
+		if (j == no_segment) j = segment_partition_point(k, p);
+		cached_segment.store(j, std::memory_order_relaxed);
+		return fenced_coordinate(first, j, p);
+	}
+
+	// Keys can be sorted by their bytes if they're integers ordered by "std::less"
+	static constexpr bool radix_sortable =
+		std::is_integral_v<key_type> && !std::is_same_v<key_type, bool> &&
+		std::is_same_v<key_compare, std::less<key_type>> &&
+		std::is_trivially_copy_constructible_v<value_type> && std::is_default_constructible_v<value_type>;
+
+	void sort_batch(std::vector<value_type>& b) const {
+		if constexpr (radix_sortable) {
+			std::vector<value_type> buffer(b.size());
+			flat::radix_sort(b.data(), b.data() + b.size(), buffer.data(), [](const value_type& x) { return flat::radix_key(value_to_key::get(x)); });
+		}
+		else std::stable_sort(b.begin(), b.end(), [this](const value_type& x, const value_type& y) { return cmp(x, y); });
+	}
 
-		segmented_coordinate it = begin();
-		while (n) {
-			it = upper_bound(it, *first);
-			it = insert_unguarded(it, c(*first));
-			++it;
+	template<typename I>
+	// I models RandomAccessIterator
+	// IteratorValueType<I> == value_type
+	void insert_sorted_runs(I first, I last) {
+		// precondition: [first, last) is sorted
+		thaw();
+		segmented_coordinate hint = begin();
+		while (first != last) {
+			segmented_coordinate it = upper_bound_from(hint, value_to_key::get(*first));
+			// Run of the elements which go in front of the last element of the segment of "it"
+			I l = last;
+			if (it != end()) {
+				const value_type& x = *flat::predecessor(std::end(seg::segment(it)), 1);
+				l = std::partition_point(first, last, [&](const value_type& y) { return cmp(y, x); });
+			}
+			hint = list.insert_move_merge(it, first, static_cast<size_type>(l - first), cmp);
+			first = l;
+		}
+	}
+
+	// Whether all of the elements "op" inserts or erases lie in front of "x"
+	bool in_front_of(const operation& op, const value_type& x) const {
+		const key_type& k = value_to_key::get(x);
+		if (op.kind() == operation::erase_keys) return !key_comp()(k, op.last());
+		return key_comp()(op.first(), k);
+	}
+
+	template<typename I, typename F>
+	// I models InputIterator
+	// IteratorValueType<I> == operation
+	// F models ForwardIterator
+	// IteratorValueType<F> == value_type
+	void apply_to_range(F f, F l, I first, I last, std::vector<value_type>& b) const {
+		// precondition: [first, last) is sorted, and all of its effects lie in front of "l"(see "in_front_of")
+		key_compare c = key_comp();
+		auto key = [](const value_type& x) -> const key_type& { return value_to_key::get(x); };
+		while (first != last) {
+			const operation& op = *first;
+			if (op.kind() == operation::insert_value) {
+				while (f != l && !c(op.first(), key(*f))) b.push_back(std::move(*f++));
+				b.push_back(op.value());
+			}
+			else if (op.kind() == operation::erase_key || c(op.first(), op.last())) {
+				while (f != l && c(key(*f), op.first())) b.push_back(std::move(*f++));
+				// Elements in "b" aren't greater than "op.first()", so the erased ones are at its end
+				while (!b.empty() && !c(key(b.back()), op.first())) b.pop_back();
+				if (op.kind() == operation::erase_key)
+					while (f != l && !c(op.first(), key(*f))) ++f;
+				else
+					while (f != l && c(key(*f), op.last())) ++f;
+			}
 			++first;
 		}
+		while (f != l) b.push_back(std::move(*f++));
+	}
+
+	segmented_coordinate apply(segmented_coordinate hint, const operation& op) {
+		if (op.kind() == operation::insert_value)
+			return list.insert(upper_bound_from(hint, op.first()), op.value());
+		if (op.kind() == operation::erase_keys && !key_comp()(op.first(), op.last())) return hint;
+		segmented_coordinate l = lower_bound_from(hint, op.first());
+		segmented_coordinate u = op.kind() == operation::erase_key ? upper_bound_from(l, op.first()) : lower_bound_from(l, op.last());
+		if (l == u) return l;
+		return list.erase(l, u);
+	}
+
+	template<typename C>
+	// C models SegmentedCoordinate
+	std::pair<C, C> hashed_equal_range(C first, C last, const key_type& k) const {
+		// precondition: first == begin() && last == end()
+		lower_bound_predicate<key_type, key_compare> lp(k, key_comp());
+		upper_bound_predicate<key_type, key_compare> up(k, key_comp());
+		value_key_predicate<decltype(lp), value_to_key> vlp(lp);
+		value_key_predicate<decltype(up), value_to_key> vup(up);
+		auto [j, o] = list.segment_index().hashed_position(k);
+		if (j != no_segment) {
+			// Key is expected to be off its position only by as many elements as were inserted or erased in front of it,
+			// so the bounds are searched by galloping from there
+			SegmentIterator<C> s = flat::successor(seg::segment(first), j);
+			FlatIterator<C> f = std::begin(s);
+			FlatIterator<C> e = std::end(s);
+			FlatIterator<C> h = flat::successor(f, o);
+			FlatIterator<C> l = h != e && vlp(*h) ?
+				flat::find_adaptor_galloping()(flat::successor(h, 1), e, vlp) :
+				flat::find_adaptor_galloping_backward()(f, h, vlp);
+			// Lower bound is in the segment, unless all of its elements are on one side of the key
+			if (l != e && (l != f || j == 0 || vlp(*flat::predecessor(std::end(flat::predecessor(s, 1)), 1)))) {
+				if (!vup(*l)) return { C(s, l), C(s, l) };
+				FlatIterator<C> u = flat::find_adaptor_galloping()(flat::successor(l, 1), e, vup);
+				if (u != e) return { C(s, l), C(s, u) };
+				SegmentIterator<C> t = flat::successor(s, 1);
+				return { C(s, l), seg::partition_point_galloping(C(t, std::begin(t)), last, vup) };
+			}
+		}
+		C l = fenced_coordinate(first, segment_partition_point(k, lp), lp);
+		return { l, seg::partition_point_galloping(l, last, vup) };
+	}
+
+	template<typename C>
+	// C models SegmentedCoordinate
+	C sampled_lower_bound(C first, const key_type& k) const {
+		lower_bound_predicate<key_type, key_compare> p(k, key_comp());
+		return fenced_coordinate(first, segment_partition_point(k, p), p);
+	}
+
+	template<typename C>
+	// C models SegmentedCoordinate
+	C sampled_upper_bound(C first, const key_type& k) const {
+		upper_bound_predicate<key_type, key_compare> p(k, key_comp());
+		return fenced_coordinate(first, segment_partition_point(k, p), p);
+	}
+
+	template<typename C>
+	// C models SegmentedCoordinate
+	std::pair<C, C> sampled_equal_range(C first, const key_type& k) const {
+		lower_bound_predicate<key_type, key_compare> lp(k, key_comp());
+		upper_bound_predicate<key_type, key_compare> up(k, key_comp());
+		return { fenced_coordinate(first, segment_partition_point(k, lp), lp), fenced_coordinate(first, segment_partition_point(k, up), up) };
+	}
+
+	template<typename C>
+	// C models SegmentedCoordinate
+	C frozen_lower_bound(C first, const key_type& k) const {
+		lower_bound_predicate<key_type, key_compare> p(k, key_comp());
+		return fenced_coordinate(first, frozen_fences.partition_point(p), p);
+	}
+
+	template<typename C>
+	// C models SegmentedCoordinate
+	C frozen_upper_bound(C first, const key_type& k) const {
+		upper_bound_predicate<key_type, key_compare> p(k, key_comp());
+		return fenced_coordinate(first, frozen_fences.partition_point(p), p);
+	}
+
+	template<typename C>
+	// C models SegmentedCoordinate
+	std::pair<C, C> frozen_equal_range(C first, const key_type& k) const {
+		lower_bound_predicate<key_type, key_compare> lp(k, key_comp());
+		upper_bound_predicate<key_type, key_compare> up(k, key_comp());
+		return { fenced_coordinate(first, frozen_fences.partition_point(lp), lp), fenced_coordinate(first, frozen_fences.partition_point(up), up) };
 	}
 
 public:
-	associative_container_tmp(associative_container_tmp&& other) = default;
-	associative_container_tmp(const associative_container_tmp& other) = default;
+	associative_container_tmp(associative_container_tmp&& other) :
+		list(std::move(other.list)),
+		cmp(std::move(other.cmp)),
+		frozen_fences(std::move(other.frozen_fences)),
+		segment_cache(other.segment_cache)
+	{}
+	// Copy isn't frozen, since its elements may be split into segments differently
+	associative_container_tmp(const associative_container_tmp& other) : list(other.list), cmp(other.cmp), segment_cache(other.segment_cache) {}
 	associative_container_tmp(key_compare&& cmp = key_compare(), allocator&& alloc = allocator()) : list(std::move(alloc)), cmp(std::move(cmp)) {}
 	associative_container_tmp(const key_compare& cmp, const allocator& alloc) : list(alloc), cmp(cmp) {}
 	associative_container_tmp(key_compare&& cmp, segmented_list&& list) : list(std::move(list)), cmp(std::move(cmp)) {}
 	associative_container_tmp(const key_compare& cmp, const segmented_list& list) : list(list), cmp(cmp) {}
+	// Bulk load of the sorted range [first, first + n)(see "assign_sorted")
+	template<typename I>
+	// I models InnputIterator
+	// IteratorValueType<I> == value_type
+	associative_container_tmp(I first, size_type n, double fill, key_compare&& cmp = key_compare(), allocator&& alloc = allocator()) :
+		list(std::move(alloc)), cmp(std::move(cmp))
+	{
+		list.assign(first, n, fill);
+	}
 	~associative_container_tmp() = default;
 
-	associative_container_tmp& operator=(associative_container_tmp&& other) = default;
-	associative_container_tmp& operator=(const associative_container_tmp& other) = default;
+	associative_container_tmp& operator=(associative_container_tmp&& other) {
+		list = std::move(other.list);
+		cmp = std::move(other.cmp);
+		frozen_fences = std::move(other.frozen_fences);
+		segment_cache = other.segment_cache;
+		return *this;
+	}
+	associative_container_tmp& operator=(const associative_container_tmp& other) {
+		list = other.list;
+		cmp = other.cmp;
+		segment_cache = other.segment_cache;
+		thaw();
+		return *this;
+	}
 
 	friend
 	bool operator==(const associative_container_tmp& x, const associative_container_tmp& y) {
@@ -1788,29 +5513,75 @@ public:
 
 	size_type size() const { return list.size(); }
 
-	key_compare key_comp() const { return cmp.key_comp(); }
+	const index& segment_index() const { return list.segment_index(); }
+
+	key_compare key_comp() const { return cmp.key_compare(); }
+
+	// Builds a read optimized search tree over the fence keys, which "lower_bound", "upper_bound" and "equal_range"
+	// use instead of searching the segments. Any insertion or erasure thaws the container.
+	void freeze() {
+		const index& in = list.segment_index();
+		std::vector<key_type> fences;
+		fences.reserve(in.size());
+		for (auto it = std::cbegin(in); it != std::cend(in); ++it)
+			fences.push_back(value_to_key::get(*flat::predecessor(seg::end(*it), 1)));
+		frozen_fences.build(std::begin(fences), fences.size());
+	}
+
+	void thaw() { frozen_fences.clear(); }
+
+	bool frozen() const { return !frozen_fences.empty(); }
+
+	// With the segment cache enabled, "lower_bound" and "upper_bound"(and so "insert") first check whether the result
+	// is in the segment which held the result of the previous such lookup, or in one of its neighbours, and search
+	// the whole container only if it isn't. It pays off when consecutive lookups are close to each other.
+	// The cache is a relaxed atomic, so const lookups may still be made by several threads at once; they only make each
+	// other start from a worse segment.
+	void enable_segment_cache() { segment_cache = true; }
+
+	void disable_segment_cache() { segment_cache = false; }
+
+	bool segment_cache_enabled() const { return segment_cache; }
 
 	void swap(segmented_list& _list) {
+		thaw();
 	    std::swap(_list, list);
 	}
 
 	void swap(index& _in, size_type& _s) {
+		thaw();
 		list.swap(_in, _s);
 	}
 
 	segmented_coordinate begin() { return list.begin(); }
 	segmented_coordinate end() { return list.end(); }
 
-	const_segmented_coordinate cbegin() { return list.cbegin(); }
-	const_segmented_coordinate cend() { return list.cend(); }
+	const_segmented_coordinate cbegin() const { return list.cbegin(); }
+	const_segmented_coordinate cend() const { return list.cend(); }
 
 	const_segmented_coordinate begin() const { return cbegin(); }
 	const_segmented_coordinate end() const { return cend(); }
 
+	segmented_coordinate nth(size_type i) { return list.nth(i); }
+	const_segmented_coordinate nth(size_type i) const { return list.nth(i); }
+
+	size_type rank(const_segmented_coordinate it) const { return list.rank(it); }
+
+	std::ptrdiff_t distance(const_segmented_coordinate first, const_segmented_coordinate last) const {
+		return list.distance(first, last);
+	}
+
+	segmented_coordinate successor(segmented_coordinate it, size_type n) { return list.successor(it, n); }
+	const_segmented_coordinate successor(const_segmented_coordinate it, size_type n) const { return list.successor(it, n); }
+
+	segmented_coordinate predecessor(segmented_coordinate it, size_type n) { return list.predecessor(it, n); }
+	const_segmented_coordinate predecessor(const_segmented_coordinate it, size_type n) const { return list.predecessor(it, n); }
+
 	template<typename I>
 	// I models InnputIterator
 	// IteratorValueType<I> == value_type
 	std::pair<segmented_coordinate, segmented_coordinate> insert_move_sorted_unguarded(segmented_coordinate it, I first, size_type n) {
+		thaw();
 		return list.insert_move(it, first, n);
 	}
 
@@ -1818,28 +5589,130 @@ public:
 	// I models InnputIterator
 	// IteratorValueType<I> == value_type
 	std::pair<segmented_coordinate, segmented_coordinate> insert_sorted_unguarded(segmented_coordinate it, I first, size_type n) {
+		thaw();
 		return list.insert(it, first, n);
 	}
 
+	// Elements are replaced by the sorted range [first, first + n). Segments are filled to "fill" of their capacity
+	// (clamped to [0.5, 1]): 1 for data which won't change, lower to leave room for later insertions.
+	// Index and all the segments are allocated at once, and the elements are copied segment by segment.
+
+	template<typename I>
+	// I models InnputIterator
+	// IteratorValueType<I> == value_type
+	void assign_sorted(I first, size_type n, double fill = 1.0) {
+		thaw();
+		list.assign(first, n, fill);
+	}
+
+	template<typename I>
+	// I models InnputIterator
+	// IteratorValueType<I> == value_type
+	void assign_move_sorted(I first, size_type n, double fill = 1.0) {
+		thaw();
+		list.assign_move(first, n, fill);
+	}
+
+	// Sorted range [first, first + n) is merged into the container in one pass: room for all of its elements is made
+	// at once(in fully packed new segments), and only the elements between its first and last keys are moved.
+	// Elements equal to existing ones go after them, as with "insert".
+
 	template<typename I>
 	// I models InnputIterator
 	// IteratorValueType<I> == value_type
 	void insert_sorted(I first, size_type n) {
-		insert_sorted(first, n, _copy());
+		if (n == 0) return;
+		segmented_coordinate it = upper_bound(value_to_key::get(*first));
+		thaw();
+		list.insert_merge(it, first, n, cmp);
 	}
 
 	template<typename I>
 	// I models InnputIterator
 	// IteratorValueType<I> == value_type
 	void insert_move_sorted(I first, size_type n) {
-		insert_sorted(first, n, _move());
+		if (n == 0) return;
+		segmented_coordinate it = upper_bound(value_to_key::get(*first));
+		thaw();
+		list.insert_move_merge(it, first, n, cmp);
+	}
+
+	// Elements of the unsorted range [first, first + n) are inserted as by "insert", in their order among equal ones.
+	// They're first sorted(by a radix sort if the keys are integers ordered by "std::less"), and then every run of
+	// them which goes into the same segment is merged into it at once(see "insert_sorted"). Positions of the runs
+	// are searched by galloping from the end of the previous run, so the index is swept only once.
+
+	template<typename I>
+	// I models InnputIterator
+	// IteratorValueType<I> == value_type
+	void insert_batch(I first, size_type n) {
+		if (n == 0) return;
+		std::vector<value_type> b;
+		b.reserve(n);
+		while (n) {
+			b.push_back(*first);
+			++first;
+			--n;
+		}
+		sort_batch(b);
+		insert_sorted_runs(b.begin(), b.end());
+	}
+
+	// Same as "insert_batch", but the range [first, first + n) is already sorted, and its elements are moved
+	template<typename I>
+	// I models RandomAccessIterator
+	// IteratorValueType<I> == value_type
+	void insert_move_sorted_batch(I first, size_type n) {
+		insert_sorted_runs(first, first + n);
+	}
+
+	// Operations of the sorted range [first, first + n) are applied in their order, in one pass over the segments.
+	// Every run of them whose effects lie inside the same segment is applied to a copy of its elements, which then
+	// replaces them; the segment is balanced with its neighbours once per run, instead of once per operation(see
+	// "replace_segment_move"). Operations which reach past the end of their segment are applied one by one.
+
+	template<typename I>
+	// I models ForwardIterator
+	// IteratorValueType<I> == operation
+	void apply_batch(I first, size_type n) {
+		// precondition: operations are sorted by "first()"
+		thaw();
+		std::vector<value_type> b;
+		segmented_coordinate hint = begin();
+		while (n) {
+			segmented_coordinate it = lower_bound_from(hint, first->first());
+			size_type m = 0;
+			I l = first;
+			if (it != end()) {
+				segment_iterator sg = seg::segment(it);
+				const value_type& x = *flat::predecessor(std::end(sg), 1);
+				while (m < n && in_front_of(*l, x)) {
+					++l;
+					++m;
+				}
+				if (m) {
+					apply_to_range(std::begin(sg), std::end(sg), first, l, b);
+					hint = list.replace_segment_move(sg, b.begin(), static_cast<size_type>(b.size()));
+					b.clear();
+				}
+			}
+			if (m == 0) {
+				hint = apply(hint, *first);
+				++l;
+				m = 1;
+			}
+			first = l;
+			n = n - m;
+		}
 	}
 
 	segmented_coordinate insert_unguarded(segmented_coordinate it, value_type&& v) {
+		thaw();
 		return list.insert(it, std::move(v));
 	}
 
 	segmented_coordinate insert_unguarded(segmented_coordinate it, const value_type& v) {
+		thaw();
 		return list.insert(it, v);
 	}
 
@@ -1851,10 +5724,21 @@ public:
 		return insert_unguarded(upper_bound(value_to_key::get(v)), v);
 	}
 
+	// Same as "insert", but the position is searched by galloping from "hint"(see "upper_bound_from")
+
+	segmented_coordinate insert_hint(const_segmented_coordinate hint, value_type&& v) {
+		return insert_unguarded(upper_bound_from(hint, value_to_key::get(v)), std::move(v));
+	}
+
+	segmented_coordinate insert_hint(const_segmented_coordinate hint, const value_type& v) {
+		return insert_unguarded(upper_bound_from(hint, value_to_key::get(v)), v);
+	}
+
 	template<typename I>
 	// I models InnputIterator
 	// IteratorValueType<I> == value_type
 	std::pair<segmented_coordinate, segmented_coordinate> insert_move_sorted_unguarded(const_segmented_coordinate it, I first, size_type n) {
+		thaw();
 		return list.insert_move(it, first, n);
 	}
 
@@ -1862,86 +5746,400 @@ public:
 	// I models InnputIterator
 	// IteratorValueType<I> == value_type
 	std::pair<segmented_coordinate, segmented_coordinate> insert_sorted_unguarded(const_segmented_coordinate it, I first, size_type n) {
+		thaw();
 		return list.insert(it, first, n);
 	}
 
 	segmented_coordinate insert_unguarded(const_segmented_coordinate it, value_type&& v) {
+		thaw();
 		return list.insert(it, std::move(v));
 	}
 	segmented_coordinate insert_unguarded(const_segmented_coordinate it, const value_type& v) {
+		thaw();
 		return list.insert(it, v);
 	}
 
-	segmented_coordinate erase(segmented_coordinate first, segmented_coordinate last) {
-		return list.erase(first, last);
-	}
-	segmented_coordinate erase(segmented_coordinate it) {
-		return list.erase(it);
+	segmented_coordinate erase(segmented_coordinate first, segmented_coordinate last) {
+		thaw();
+		return list.erase(first, last);
+	}
+	segmented_coordinate erase(segmented_coordinate it) {
+		thaw();
+		return list.erase(it);
+	}
+
+	void clear() {
+		thaw();
+		list.clear();
+	}
+
+	segmented_coordinate erase(const_segmented_coordinate first, const_segmented_coordinate last) {
+		thaw();
+		return list.erase(first, last);
+	}
+	segmented_coordinate erase(const_segmented_coordinate it) {
+		thaw();
+		return list.erase(it);
+	}
+
+
+	// If the container is frozen, the segment holding the result is found by searching the frozen fence keys.
+	// If the index keeps fence keys(models "FencedSegmentIndex"), the segment holding the result is found
+	// by searching only the fence keys; otherwise by searching the last elements of the segments.
+	// If the index keeps samples of the segments("sampled_index"), the result is then searched only among
+	// the elements between the two samples of its segment which surround it.
+	// If the index keeps a hash table of positions("hashed_index"), "equal_range" gallops from the position which
+	// the table names for the key, and searches as if there were no table when the key isn't in that segment.
+
+	segmented_coordinate lower_bound(const key_type& k) {
+		if (segment_cache) return cached_coordinate(begin(), k, lower_bound_predicate<key_type, key_compare>(k, key_comp()));
+		if (frozen()) return frozen_lower_bound(begin(), k);
+		if constexpr (is_fenced_index<index>::value) return fenced_lower_bound(begin(), k);
+		else if constexpr (is_sampled_index<index>::value) return sampled_lower_bound(begin(), k);
+		else return seg::lower_bound(begin(), end(), k, cmp, find_adaptor());
+	}
+	const_segmented_coordinate lower_bound(const key_type& k) const {
+		if (segment_cache) return cached_coordinate(cbegin(), k, lower_bound_predicate<key_type, key_compare>(k, key_comp()));
+		if (frozen()) return frozen_lower_bound(cbegin(), k);
+		if constexpr (is_fenced_index<index>::value) return fenced_lower_bound(cbegin(), k);
+		else if constexpr (is_sampled_index<index>::value) return sampled_lower_bound(cbegin(), k);
+		else return seg::lower_bound(cbegin(), cend(), k, cmp, find_adaptor());
+	}
+
+	segmented_coordinate upper_bound(const key_type& k) {
+		if (segment_cache) return cached_coordinate(begin(), k, upper_bound_predicate<key_type, key_compare>(k, key_comp()));
+		if (frozen()) return frozen_upper_bound(begin(), k);
+		if constexpr (is_fenced_index<index>::value) return fenced_upper_bound(begin(), k);
+		else if constexpr (is_sampled_index<index>::value) return sampled_upper_bound(begin(), k);
+		else return seg::upper_bound(begin(), end(), k, cmp, find_adaptor());
+	}
+	const_segmented_coordinate upper_bound(const key_type& k) const {
+		if (segment_cache) return cached_coordinate(cbegin(), k, upper_bound_predicate<key_type, key_compare>(k, key_comp()));
+		if (frozen()) return frozen_upper_bound(cbegin(), k);
+		if constexpr (is_fenced_index<index>::value) return fenced_upper_bound(cbegin(), k);
+		else if constexpr (is_sampled_index<index>::value) return sampled_upper_bound(cbegin(), k);
+		else return seg::upper_bound(cbegin(), cend(), k, cmp, find_adaptor());
+	}
+
+	std::pair<segmented_coordinate, segmented_coordinate> equal_range(const key_type& k) {
+		if (frozen()) return frozen_equal_range(begin(), k);
+		if constexpr (is_hashed_index<index>::value) return hashed_equal_range(begin(), end(), k);
+		else if constexpr (is_fenced_index<index>::value) return fenced_equal_range(begin(), k);
+		else if constexpr (is_sampled_index<index>::value) return sampled_equal_range(begin(), k);
+		else return seg::equal_range(begin(), end(), k, cmp, equal_range_find_adaptor());
+	}
+	std::pair<const_segmented_coordinate, const_segmented_coordinate> equal_range(const key_type& k) const {
+		if (frozen()) return frozen_equal_range(cbegin(), k);
+		if constexpr (is_hashed_index<index>::value) return hashed_equal_range(cbegin(), cend(), k);
+		else if constexpr (is_fenced_index<index>::value) return fenced_equal_range(cbegin(), k);
+		else if constexpr (is_sampled_index<index>::value) return sampled_equal_range(cbegin(), k);
+		else return seg::equal_range(cbegin(), cend(), k, cmp, equal_range_find_adaptor());
+	}
+
+	// Lower bounds of the keys of [kf, kl) are written to "out", in the same order. Searches of up to
+	// "seg::batch_group_size" keys are interleaved, so their cache misses overlap(see "seg::partition_point_batch").
+
+	template<typename I, typename O>
+	// I models ForwardIterator
+	// IteratorValueType<I> == key_type
+	// O models OutputIterator
+	// ValueType<O> == segmented_coordinate
+	O lower_bound_batch(I kf, I kl, O out) {
+		return seg::partition_point_batch(begin(), end(), kf, kl, out, lower_bound_key(key_comp()));
+	}
+	template<typename I, typename O>
+	// I models ForwardIterator
+	// IteratorValueType<I> == key_type
+	// O models OutputIterator
+	// ValueType<O> == const_segmented_coordinate
+	O lower_bound_batch(I kf, I kl, O out) const {
+		return seg::partition_point_batch(cbegin(), cend(), kf, kl, out, lower_bound_key(key_comp()));
+	}
+
+	// Lower bounds or equal ranges of the sorted keys of [kf, kl) are written to "out", in the same order.
+	// Every search gallops forward from the result of the previous one(see "seg::partition_point_sorted_batch").
+
+	template<typename I, typename O>
+	// I models InputIterator
+	// IteratorValueType<I> == key_type
+	// O models OutputIterator
+	// ValueType<O> == segmented_coordinate
+	O lower_bound_sorted_batch(I kf, I kl, O out) {
+		// precondition: [kf, kl) is sorted by "key_comp()"
+		return seg::partition_point_sorted_batch(begin(), end(), kf, kl, out, lower_bound_key(key_comp()));
+	}
+	template<typename I, typename O>
+	// I models InputIterator
+	// IteratorValueType<I> == key_type
+	// O models OutputIterator
+	// ValueType<O> == const_segmented_coordinate
+	O lower_bound_sorted_batch(I kf, I kl, O out) const {
+		// precondition: [kf, kl) is sorted by "key_comp()"
+		return seg::partition_point_sorted_batch(cbegin(), cend(), kf, kl, out, lower_bound_key(key_comp()));
+	}
+
+	template<typename I, typename O>
+	// I models InputIterator
+	// IteratorValueType<I> == key_type
+	// O models OutputIterator
+	// ValueType<O> == std::pair<segmented_coordinate, segmented_coordinate>
+	O equal_range_sorted_batch(I kf, I kl, O out) {
+		// precondition: [kf, kl) is sorted by "key_comp()"
+		return seg::partition_range_sorted_batch(begin(), end(), kf, kl, out, lower_bound_key(key_comp()), upper_bound_key(key_comp()));
+	}
+	template<typename I, typename O>
+	// I models InputIterator
+	// IteratorValueType<I> == key_type
+	// O models OutputIterator
+	// ValueType<O> == std::pair<const_segmented_coordinate, const_segmented_coordinate>
+	O equal_range_sorted_batch(I kf, I kl, O out) const {
+		// precondition: [kf, kl) is sorted by "key_comp()"
+		return seg::partition_range_sorted_batch(cbegin(), cend(), kf, kl, out, lower_bound_key(key_comp()), upper_bound_key(key_comp()));
+	}
+
+	segmented_coordinate lower_bound(segmented_coordinate it, const key_type& k) {
+		return seg::lower_bound(it, end(), k, cmp, find_adaptor());
+	}
+	segmented_coordinate lower_bound(const_segmented_coordinate it, const key_type& k) {
+		return seg::lower_bound(list.coordinate_from_const(it), end(), k, cmp, find_adaptor());
+	}
+	const_segmented_coordinate lower_bound(const_segmented_coordinate it, const key_type& k) const {
+		return seg::lower_bound(it, cend(), k, cmp, find_adaptor());
+	}
+
+	segmented_coordinate upper_bound(segmented_coordinate it, const key_type& k) {
+		return seg::upper_bound(it, end(), k, cmp, find_adaptor());
+	}
+	segmented_coordinate upper_bound(const_segmented_coordinate it, const key_type& k) {
+		return seg::upper_bound(list.coordinate_from_const(it), end(), k, cmp, find_adaptor());
+	}
+	const_segmented_coordinate upper_bound(const_segmented_coordinate it, const key_type& k) const {
+		return seg::upper_bound(it, cend(), k, cmp, find_adaptor());
+	}
+
+	std::pair<segmented_coordinate, segmented_coordinate> equal_range(segmented_coordinate it, const key_type& k) {
+		return seg::equal_range(it, end(), k, cmp, find_adaptor());
+	}
+	std::pair<segmented_coordinate, segmented_coordinate> equal_range(const_segmented_coordinate it, const key_type& k) {
+		return seg::equal_range(list.coordinate_from_const(it), end(), k, cmp, find_adaptor());
+	}
+	std::pair<const_segmented_coordinate, const_segmented_coordinate> equal_range(const_segmented_coordinate it, const key_type& k) const {
+		return seg::equal_range(it, cend(), k, cmp, find_adaptor());
+	}
+
+	// Bounds searched by galloping from "hint" towards them, forward or backward(see "seg::partition_point_from");
+	// they cost O(log d), where "d" is the distance between the hint and the bound. Hint is any coordinate of the container.
+
+	segmented_coordinate lower_bound_from(segmented_coordinate hint, const key_type& k) {
+		return seg::partition_point_from(begin(), hint, end(), lower_bound_key(key_comp())(k));
+	}
+	segmented_coordinate lower_bound_from(const_segmented_coordinate hint, const key_type& k) {
+		return lower_bound_from(list.coordinate_from_const(hint), k);
+	}
+	const_segmented_coordinate lower_bound_from(const_segmented_coordinate hint, const key_type& k) const {
+		return seg::partition_point_from(cbegin(), hint, cend(), lower_bound_key(key_comp())(k));
+	}
+
+	segmented_coordinate upper_bound_from(segmented_coordinate hint, const key_type& k) {
+		return seg::partition_point_from(begin(), hint, end(), upper_bound_key(key_comp())(k));
+	}
+	segmented_coordinate upper_bound_from(const_segmented_coordinate hint, const key_type& k) {
+		return upper_bound_from(list.coordinate_from_const(hint), k);
+	}
+	const_segmented_coordinate upper_bound_from(const_segmented_coordinate hint, const key_type& k) const {
+		return seg::partition_point_from(cbegin(), hint, cend(), upper_bound_key(key_comp())(k));
+	}
+};
+
+
+//************************************************************************
+// BUFFERED CONTAINER
+//************************************************************************
+
+template<typename I, typename Cmp>
+// I models ForwardIterator
+// Cmp models StrictWeakOrdering
+// Domain<Cmp> == IteratorValueType<I>
+struct merged_iterator
+{
+	// Iterates over the merge of the sorted ranges [x, x_last) and [y, y_last);
+	// of the equal elements, the ones from [x, x_last) come first
+	using value_type = IteratorValueType<I>;
+	using difference_type = std::ptrdiff_t;
+	using reference = IteratorReference<I>;
+	using pointer = std::remove_reference_t<reference>*;
+	using iterator_category = std::forward_iterator_tag;
+
+	I x;
+	I x_last;
+	I y;
+	I y_last;
+	Cmp cmp;
+
+	merged_iterator(I x, I x_last, I y, I y_last, Cmp cmp) : x(x), x_last(x_last), y(y), y_last(y_last), cmp(cmp) {}
+
+	// Whether the current element comes from [y, y_last)
+	bool second() const { return y != y_last && (x == x_last || cmp(*y, *x)); }
+
+	reference operator*() const { return second() ? *y : *x; }
+	pointer operator->() const { return &**this; }
+
+	merged_iterator& operator++() {
+		if (second()) ++y;
+		else ++x;
+		return *this;
 	}
 
-	void clear() {
-		list.clear();
+	merged_iterator operator++(int) {
+		merged_iterator tmp = *this;
+		++*this;
+		return tmp;
 	}
 
-	segmented_coordinate erase(const_segmented_coordinate first, const_segmented_coordinate last) {
-		return list.erase(first, last);
+	friend
+	bool operator==(const merged_iterator& a, const merged_iterator& b) {
+		return a.x == b.x && a.y == b.y;
 	}
-	segmented_coordinate erase(const_segmented_coordinate it) {
-		return list.erase(it);
+
+	friend
+	bool operator!=(const merged_iterator& a, const merged_iterator& b) {
+		return !(a == b);
 	}
+};
 
+template<typename C>
+// C models the multiset or multimap of "associative_container_tmp"
+class buffered_container_tmp
+{
+	// Container "C" with a small write buffer in front of it, which is a "C" itself. Insertions go into the buffer,
+	// which is merged into the container in bulk once it holds "threshold" elements(see "insert_move_sorted_batch").
+	// Lookups consult both of them, and iteration goes over their merged view. Reads are slower by a search of the
+	// buffer, in exchange for much cheaper insertions of elements which are spread over the whole container.
+public:
+	using container = C;
+	using key_type = typename C::key_type;
+	using value_type = typename C::value_type;
+	using key_compare = typename C::key_compare;
+	using value_to_key = typename C::value_to_key;
+	using compare_adaptor = typename C::compare_adaptor;
+	using size_type = typename C::size_type;
+	using const_segmented_coordinate = typename C::const_segmented_coordinate;
+	using const_iterator = merged_iterator<const_segmented_coordinate, compare_adaptor>;
+	// Elements can't be changed in place, since they would have to be looked up in both of the containers
+	using iterator = const_iterator;
+
+	static constexpr size_type default_threshold = 1 << 16;
+	// Buffer is merged linearly if it holds at least this many elements per segment of the container
+	static constexpr size_type linear_merge_density = 4;
 
-	segmented_coordinate lower_bound(const key_type& k) {
-		return seg::lower_bound(begin(), end(), k, cmp, find_adaptor());
-	}
-	const_segmented_coordinate lower_bound(const key_type& k) const {
-		return seg::lower_bound(cbegin(), cend(), k, cmp, find_adaptor());
-	}
+private:
+	C c;
+	C buffer;
+	size_type threshold;
 
-	segmented_coordinate upper_bound(const key_type& k) {
-		return seg::upper_bound(begin(), end(), k, cmp, find_adaptor());
-	}
-	const_segmented_coordinate upper_bound(const key_type& k) const {
-		return seg::upper_bound(cbegin(), cend(), k, cmp, find_adaptor());
+	const_iterator merged(const_segmented_coordinate x, const_segmented_coordinate y) const {
+		return const_iterator(x, c.cend(), y, buffer.cend(), compare_adaptor(c.key_comp()));
 	}
 
-	std::pair<segmented_coordinate, segmented_coordinate> equal_range(const key_type& k) {
-		return seg::equal_range(begin(), end(), k, cmp, equal_range_find_adaptor());
+	static size_type erase_from(C& x, const key_type& k) {
+		auto [first, last] = x.equal_range(k);
+		size_type n = static_cast<size_type>(seg::distance(first, last));
+		x.erase(first, last);
+		return n;
 	}
-	std::pair<const_segmented_coordinate, const_segmented_coordinate> equal_range(const key_type& k) const {
-		return seg::equal_range(cbegin(), cend(), k, cmp, equal_range_find_adaptor());
+
+public:
+	buffered_container_tmp(size_type threshold = default_threshold) : threshold(std::max(threshold, size_type(1))) {}
+
+	bool empty() const { return c.empty() && buffer.empty(); }
+
+	size_type size() const { return c.size() + buffer.size(); }
+
+	// Number of elements which haven't been merged into the container yet
+	size_type buffered() const { return buffer.size(); }
+
+	size_type buffer_threshold() const { return threshold; }
+
+	// Container holding all of the merged elements
+	const container& base() const { return c; }
+
+	key_compare key_comp() const { return c.key_comp(); }
+
+	const_iterator begin() const { return cbegin(); }
+	const_iterator end() const { return cend(); }
+
+	const_iterator cbegin() const { return merged(c.cbegin(), buffer.cbegin()); }
+	const_iterator cend() const { return merged(c.cend(), buffer.cend()); }
+
+	// Elements are replaced by the sorted range [first, first + n), which goes straight into the container(see "assign_sorted")
+	template<typename I>
+	// I models InputIterator
+	// IteratorValueType<I> == value_type
+	void assign_sorted(I first, size_type n, double fill = 1.0) {
+		buffer.clear();
+		c.assign_sorted(first, n, fill);
 	}
 
-	segmented_coordinate lower_bound(segmented_coordinate it, const key_type& k) {
-		return seg::lower_bound(it, end(), k, cmp, find_adaptor());
+	void insert(value_type&& v) {
+		buffer.insert(std::move(v));
+		if (buffer.size() >= threshold) flush();
 	}
-	segmented_coordinate lower_bound(const_segmented_coordinate it, const key_type& k) {
-		return seg::lower_bound(segmented_list::coordinate_from_const(it), end(), k, cmp, find_adaptor());
+
+	void insert(const value_type& v) {
+		buffer.insert(v);
+		if (buffer.size() >= threshold) flush();
 	}
-	const_segmented_coordinate lower_bound(const_segmented_coordinate it, const key_type& k) const {
-		return seg::lower_bound(it, cend(), k, cmp, find_adaptor());
+
+	// Buffered elements are merged into the container. Merge of every run of them which goes into the same segment
+	// (see "insert_move_sorted_batch") costs about a segment per run, while a linear merge(see "insert_move_sorted")
+	// moves every element after the first insertion point once. With "b" random elements spread over "s" segments,
+	// about s * (1 - e^(-b / s)) segments are touched, so once the buffer holds a few elements per segment, nearly
+	// all of them are, and the linear merge is cheaper.
+	void flush() {
+		if (buffer.empty()) return;
+		std::vector<value_type> b;
+		b.reserve(buffer.size());
+		for (auto it = buffer.begin(); it != buffer.end(); ++it) b.push_back(std::move(*it));
+		buffer.clear();
+		if (b.size() >= linear_merge_density * std::size(c.segment_index()))
+			c.insert_move_sorted(b.begin(), static_cast<size_type>(b.size()));
+		else
+			c.insert_move_sorted_batch(b.begin(), static_cast<size_type>(b.size()));
 	}
 
-	segmented_coordinate upper_bound(segmented_coordinate it, const key_type& k) {
-		return seg::upper_bound(it, end(), k, cmp, find_adaptor());
+	// Erases all of the elements with the key "k", and returns their number
+	size_type erase(const key_type& k) {
+		return erase_from(c, k) + erase_from(buffer, k);
 	}
-	segmented_coordinate upper_bound(const_segmented_coordinate it, const key_type& k) {
-		return seg::upper_bound(segmented_list::coordinate_from_const(it), end(), k, cmp, find_adaptor());
+
+	void clear() {
+		c.clear();
+		buffer.clear();
 	}
-	const_segmented_coordinate upper_bound(const_segmented_coordinate it, const key_type& k) const {
-		return seg::upper_bound(it, cend(), k, cmp, find_adaptor());
+
+	const_iterator lower_bound(const key_type& k) const {
+		return merged(c.lower_bound(k), buffer.lower_bound(k));
 	}
 
-	std::pair<segmented_coordinate, segmented_coordinate> equal_range(segmented_coordinate it, const key_type& k) {
-		return seg::equal_range(it, end(), k, cmp, find_adaptor());
+	const_iterator upper_bound(const key_type& k) const {
+		return merged(c.upper_bound(k), buffer.upper_bound(k));
 	}
-	std::pair<segmented_coordinate, segmented_coordinate> equal_range(const_segmented_coordinate it, const key_type& k) {
-		return seg::equal_range(segmented_list::coordinate_from_const(it), end(), k, cmp, find_adaptor());
+
+	std::pair<const_iterator, const_iterator> equal_range(const key_type& k) const {
+		auto [first, last] = c.equal_range(k);
+		auto [buffer_first, buffer_last] = buffer.equal_range(k);
+		return { merged(first, buffer_first), merged(last, buffer_last) };
 	}
-	std::pair<const_segmented_coordinate, const_segmented_coordinate> equal_range(const_segmented_coordinate it, const key_type& k) const {
-		return seg::equal_range(it, cend(), k, cmp, find_adaptor());
+
+	size_type count(const key_type& k) const {
+		auto [first, last] = c.equal_range(k);
+		auto [buffer_first, buffer_last] = buffer.equal_range(k);
+		return static_cast<size_type>(seg::distance(first, last) + seg::distance(buffer_first, buffer_last));
 	}
 };
+//************************************************************************
+// ~BUFFERED CONTAINER
+//************************************************************************
 
 template<typename Cmp>
 // Cmp models StrictWeakOrdering
@@ -1964,6 +6162,8 @@ template<typename Cmp>
 // Cmp models StrictWeakOrdering
 struct set_compare_adaptor
 {
+	using forwarded_compare = Cmp;
+
 	Cmp cmp;
 
 	set_compare_adaptor(const Cmp& cmp) : cmp(cmp) {}
@@ -2014,6 +6214,16 @@ template<
 	typename EqualRangeFAdaptor>
 using multimap_big_header = multimap_tmp<K, M, Cmp, list_big_header<std::pair<K, M>, C, A>, FAdaptor, EqualRangeFAdaptor>;
 
+template<
+	typename K,
+	typename M,
+	typename Cmp,
+	segment_size_t C,
+	typename A,
+	typename FAdaptor,
+	typename EqualRangeFAdaptor>
+using multimap_mapped_big_header = multimap_tmp<K, M, Cmp, list_mapped_big_header<std::pair<K, M>, C, A>, FAdaptor, EqualRangeFAdaptor>;
+
 template<
 	typename K,
 	typename M,
@@ -2024,6 +6234,97 @@ template<
 	typename EqualRangeFAdaptor>
 using multimap_small_header = multimap_tmp<K, M, Cmp, list_small_header<std::pair<K, M>, C, A>, FAdaptor, EqualRangeFAdaptor>;
 
+template<
+	typename K,
+	typename M,
+	typename Cmp,
+	segment_size_t C,
+	typename A,
+	typename FAdaptor,
+	typename EqualRangeFAdaptor,
+	std::size_t P = default_area_pool_bits>
+using multimap_compact_header = multimap_tmp<K, M, Cmp, list_compact_header<std::pair<K, M>, C, A, P>, FAdaptor, EqualRangeFAdaptor>;
+
+template<
+	typename K,
+	typename M,
+	typename Cmp,
+	segment_size_t C,
+	typename A,
+	typename FAdaptor,
+	typename EqualRangeFAdaptor>
+using multimap_gapped_header = multimap_tmp<K, M, Cmp, list_gapped_header<std::pair<K, M>, C, A>, FAdaptor, EqualRangeFAdaptor>;
+
+template<
+	typename K,
+	typename M,
+	typename Cmp,
+	segment_size_t C,
+	typename A,
+	typename FAdaptor,
+	typename EqualRangeFAdaptor>
+using multimap_growing_header = multimap_tmp<K, M, Cmp, list_growing_header<std::pair<K, M>, C, A>, FAdaptor, EqualRangeFAdaptor>;
+
+template<
+	typename K,
+	typename M,
+	typename Cmp,
+	segment_size_t C,
+	typename A,
+	typename FAdaptor,
+	typename EqualRangeFAdaptor>
+using multimap_blocked_header = multimap_tmp<K, M, Cmp, list_blocked_header<std::pair<K, M>, C, A>, FAdaptor, EqualRangeFAdaptor>;
+
+template<
+	typename K,
+	typename M,
+	typename Cmp,
+	segment_size_t C,
+	typename A,
+	typename FAdaptor,
+	typename EqualRangeFAdaptor>
+using multimap_counted_big_header = multimap_tmp<K, M, Cmp, list_counted_big_header<std::pair<K, M>, C, A>, FAdaptor, EqualRangeFAdaptor>;
+
+template<
+	typename K,
+	typename M,
+	typename Cmp,
+	segment_size_t C,
+	typename A,
+	typename FAdaptor,
+	typename EqualRangeFAdaptor>
+using multimap_fenced_big_header = multimap_tmp<K, M, Cmp, list_fenced_big_header<std::pair<K, M>, C, A, map_value_to_key>, FAdaptor, EqualRangeFAdaptor>;
+
+template<
+	typename K,
+	typename M,
+	typename Cmp,
+	segment_size_t C,
+	typename A,
+	typename FAdaptor,
+	typename EqualRangeFAdaptor>
+using multimap_learned_big_header = multimap_tmp<K, M, Cmp, list_learned_big_header<std::pair<K, M>, C, A, map_value_to_key>, FAdaptor, EqualRangeFAdaptor>;
+
+template<
+	typename K,
+	typename M,
+	typename Cmp,
+	segment_size_t C,
+	typename A,
+	typename FAdaptor,
+	typename EqualRangeFAdaptor>
+using multimap_sampled_big_header = multimap_tmp<K, M, Cmp, list_sampled_big_header<std::pair<K, M>, C, A, map_value_to_key>, FAdaptor, EqualRangeFAdaptor>;
+
+template<
+	typename K,
+	typename M,
+	typename Cmp,
+	segment_size_t C,
+	typename A,
+	typename FAdaptor,
+	typename EqualRangeFAdaptor>
+using multimap_hashed_big_header = multimap_tmp<K, M, Cmp, list_hashed_big_header<std::pair<K, M>, C, A, map_value_to_key>, FAdaptor, EqualRangeFAdaptor>;
+
 template<
 	typename K,
 	typename M,
@@ -2032,6 +6333,14 @@ template<
 	typename A = std::allocator<std::pair<K, M>>>
 using multimap = multimap_big_header<K, M, Cmp, C, A, flat::find_adaptor_linear, flat::equal_range_adaptor_linear>;
 
+template<
+	typename K,
+	typename M,
+	typename Cmp = std::less<K>,
+	segment_size_t C = default_capacity_for_type<std::pair<K, M>>(),
+	typename A = std::allocator<std::pair<K, M>>>
+using multimap_adaptive = multimap_big_header<K, M, Cmp, C, A, flat::find_adaptor_adaptive, flat::equal_range_adaptor_adaptive>;
+
 template<
 	typename K,
 	typename Cmp,
@@ -2049,6 +6358,15 @@ template<
 	typename EqualRangeFAdaptor>
 using multiset_big_header = multiset_tmp<K, Cmp, list_big_header<K, C, A>, FAdaptor, EqualRangeFAdaptor>;
 
+template<
+	typename K,
+	typename Cmp,
+	segment_size_t C,
+	typename A,
+	typename FAdaptor,
+	typename EqualRangeFAdaptor>
+using multiset_mapped_big_header = multiset_tmp<K, Cmp, list_mapped_big_header<K, C, A>, FAdaptor, EqualRangeFAdaptor>;
+
 template<
 	typename K,
 	typename Cmp,
@@ -2058,6 +6376,88 @@ template<
 	typename EqualRangeFAdaptor>
 using multiset_small_header = multiset_tmp<K, Cmp, list_small_header<K, C, A>, FAdaptor, EqualRangeFAdaptor>;
 
+template<
+	typename K,
+	typename Cmp,
+	segment_size_t C,
+	typename A,
+	typename FAdaptor,
+	typename EqualRangeFAdaptor,
+	std::size_t P = default_area_pool_bits>
+using multiset_compact_header = multiset_tmp<K, Cmp, list_compact_header<K, C, A, P>, FAdaptor, EqualRangeFAdaptor>;
+
+template<
+	typename K,
+	typename Cmp,
+	segment_size_t C,
+	typename A,
+	typename FAdaptor,
+	typename EqualRangeFAdaptor>
+using multiset_gapped_header = multiset_tmp<K, Cmp, list_gapped_header<K, C, A>, FAdaptor, EqualRangeFAdaptor>;
+
+template<
+	typename K,
+	typename Cmp,
+	segment_size_t C,
+	typename A,
+	typename FAdaptor,
+	typename EqualRangeFAdaptor>
+using multiset_growing_header = multiset_tmp<K, Cmp, list_growing_header<K, C, A>, FAdaptor, EqualRangeFAdaptor>;
+
+template<
+	typename K,
+	typename Cmp,
+	segment_size_t C,
+	typename A,
+	typename FAdaptor,
+	typename EqualRangeFAdaptor>
+using multiset_blocked_header = multiset_tmp<K, Cmp, list_blocked_header<K, C, A>, FAdaptor, EqualRangeFAdaptor>;
+
+template<
+	typename K,
+	typename Cmp,
+	segment_size_t C,
+	typename A,
+	typename FAdaptor,
+	typename EqualRangeFAdaptor>
+using multiset_counted_big_header = multiset_tmp<K, Cmp, list_counted_big_header<K, C, A>, FAdaptor, EqualRangeFAdaptor>;
+
+template<
+	typename K,
+	typename Cmp,
+	segment_size_t C,
+	typename A,
+	typename FAdaptor,
+	typename EqualRangeFAdaptor>
+using multiset_fenced_big_header = multiset_tmp<K, Cmp, list_fenced_big_header<K, C, A, set_value_to_key>, FAdaptor, EqualRangeFAdaptor>;
+
+template<
+	typename K,
+	typename Cmp,
+	segment_size_t C,
+	typename A,
+	typename FAdaptor,
+	typename EqualRangeFAdaptor>
+using multiset_learned_big_header = multiset_tmp<K, Cmp, list_learned_big_header<K, C, A, set_value_to_key>, FAdaptor, EqualRangeFAdaptor>;
+
+template<
+	typename K,
+	typename Cmp,
+	segment_size_t C,
+	typename A,
+	typename FAdaptor,
+	typename EqualRangeFAdaptor>
+using multiset_sampled_big_header = multiset_tmp<K, Cmp, list_sampled_big_header<K, C, A, set_value_to_key>, FAdaptor, EqualRangeFAdaptor>;
+
+template<
+	typename K,
+	typename Cmp,
+	segment_size_t C,
+	typename A,
+	typename FAdaptor,
+	typename EqualRangeFAdaptor>
+using multiset_hashed_big_header = multiset_tmp<K, Cmp, list_hashed_big_header<K, C, A, set_value_to_key>, FAdaptor, EqualRangeFAdaptor>;
+
 template<
 	typename K,
 	typename Cmp = std::less<K>,
@@ -2065,6 +6465,20 @@ template<
 	typename A = std::allocator<K>>
 using multiset = multiset_big_header<K, Cmp, C, A, flat::find_adaptor_linear, flat::equal_range_adaptor_linear>;
 
+template<
+	typename K,
+	typename Cmp = std::less<K>,
+	segment_size_t C = default_capacity_for_type<K>(),
+	typename A = std::allocator<K>>
+using multiset_adaptive = multiset_big_header<K, Cmp, C, A, flat::find_adaptor_adaptive, flat::equal_range_adaptor_adaptive>;
+
+template<
+	typename K,
+	typename Cmp = std::less<K>,
+	segment_size_t C = default_capacity_for_type<K>(),
+	typename A = std::allocator<K>>
+using buffered_multiset = buffered_container_tmp<multiset<K, Cmp, C, A>>;
+
 } // namespace seg
 
 
@@ -1,6 +1,12 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <stdexcept>
 #include <vector>
 #include <utility>
 
@@ -176,6 +182,218 @@ inline
 size_t end_index(const small_segment_header<T, C>& h) { return static_cast<size_t>(h.area->last); }
 
 
+constexpr size_t default_area_pool_bits = 10;
+
+// Pool of "segment areas" owned by a single container. Areas are addressed with 32 bit handles; the high
+// "pool_bits" of a handle are the number under which the pool has registered its chunk table, so an area
+// is found from the handle alone. Chunk "k" holds 2^(k + first_chunk_log) areas, so the chunk and the
+// position inside it are computed from the rest of the handle. Chunks are allocated with the allocator of
+// the container, never move, and are given back when the pool is destroyed; released areas are kept in a
+// free list. "P" splits the handle between the two: at most "max_pools" pools of the same area type and "P"
+// hold areas at the same time, each with at most "max_areas" areas. Going over either limit throws
+// "std::length_error"; containers which are many at the same time should use a larger "P".
+template<typename Area, typename A, size_t P = default_area_pool_bits>
+// A models Allocator
+class compact_area_pool
+{
+public:
+	using area_type = Area;
+	using handle_type = std::uint32_t;
+	using allocator = AllocatorRebindType<A, area_type>;
+	static constexpr handle_type null_handle = std::numeric_limits<handle_type>::max();
+	static constexpr size_t pool_bits = P;
+
+private:
+	static_assert(sizeof(area_type) >= sizeof(handle_type), "Area must be able to hold a free list link");
+	static_assert(0 < P && P <= 24, "Handle must hold both the number of the pool and the area inside it");
+
+	static constexpr size_t local_bits = 32 - pool_bits;
+	static constexpr handle_type local_mask = (handle_type(1) << local_bits) - 1;
+	static constexpr size_t pool_nm = size_t(1) << pool_bits;
+	static constexpr size_t first_chunk_log = 4;
+	// The last chunk is never allocated; "null_handle" maps into it
+	static constexpr size_t chunk_nm = local_bits - first_chunk_log + 1;
+
+public:
+	static constexpr size_t max_pools = pool_nm - 1;
+	static constexpr size_t max_areas = (size_t(1) << local_bits) - (size_t(1) << first_chunk_log);
+
+private:
+
+	// Chunk tables of the pools which hold areas, by their numbers. The last number is never given out;
+	// its table is empty, so that "null_handle" maps into an unallocated chunk.
+	struct registry
+	{
+		area_type* const* tables[pool_nm];
+
+		constexpr registry() : tables() { tables[pool_nm - 1] = null_chunks; }
+	};
+
+	inline static area_type* const null_chunks[chunk_nm] = {};
+	inline static registry pools = registry();
+
+	static std::mutex& mutex() {
+		static std::mutex* m = new std::mutex(); // Never destroyed; pools may be destroyed during static destruction
+		return *m;
+	}
+
+	area_type* chunks[chunk_nm] = {};
+	// Number of the pool in the high bits, or "null_handle" while the pool holds no chunks
+	handle_type id = null_handle;
+	handle_type next = 0;
+	handle_type free_list = null_handle;
+	allocator alloc;
+
+	static area_type* area(area_type* const* t, handle_type h) {
+		std::uint64_t x = static_cast<std::uint64_t>(h & local_mask) + (std::uint64_t(1) << first_chunk_log);
+		size_t k = log2_floor(x);
+		return t[k - first_chunk_log] + (x - (std::uint64_t(1) << k));
+	}
+
+	void register_pool() {
+		std::lock_guard<std::mutex> lock(mutex());
+		size_t i = 0;
+		while (i != pool_nm - 1 && pools.tables[i] != nullptr) ++i;
+		if (i == pool_nm - 1) throw std::length_error("Too many compact area pools hold areas at the same time");
+		pools.tables[i] = chunks;
+		id = static_cast<handle_type>(i << local_bits);
+	}
+
+	void move_from(compact_area_pool& other) {
+		std::copy(std::begin(other.chunks), std::end(other.chunks), std::begin(chunks));
+		std::fill(std::begin(other.chunks), std::end(other.chunks), nullptr);
+		id = other.id;
+		next = other.next;
+		free_list = other.free_list;
+		other.id = null_handle;
+		other.next = 0;
+		other.free_list = null_handle;
+		if (id != null_handle) {
+			std::lock_guard<std::mutex> lock(mutex());
+			pools.tables[id >> local_bits] = chunks;
+		}
+	}
+
+public:
+	compact_area_pool(const allocator& alloc = allocator()) : alloc(alloc) {}
+	compact_area_pool(compact_area_pool&& other) : alloc(std::move(other.alloc)) { move_from(other); }
+	compact_area_pool(const compact_area_pool&) = delete;
+	~compact_area_pool() { release(); }
+
+	compact_area_pool& operator=(compact_area_pool&& other) {
+		if (this == &other) return *this;
+		release();
+		alloc = std::move(other.alloc);
+		move_from(other);
+		return *this;
+	}
+	compact_area_pool& operator=(const compact_area_pool&) = delete;
+
+	static area_type* area(handle_type h) {
+		return area(pools.tables[h >> local_bits], h);
+	}
+
+	handle_type allocate() {
+		if (free_list != null_handle) {
+			handle_type h = free_list;
+			std::memcpy(&free_list, static_cast<void*>(area(chunks, h)), sizeof(handle_type));
+			return h;
+		}
+		size_t k = log2_floor(static_cast<std::uint64_t>(next) + (std::uint64_t(1) << first_chunk_log));
+		if (k - first_chunk_log == chunk_nm - 1) throw std::length_error("Compact area pool holds too many areas");
+		if (chunks[k - first_chunk_log] == nullptr) {
+			if (id == null_handle) register_pool();
+			chunks[k - first_chunk_log] = alloc.allocate(size_t(1) << k);
+		}
+		return id | next++;
+	}
+
+	void deallocate(handle_type h) {
+		std::memcpy(static_cast<void*>(area(chunks, h)), &free_list, sizeof(handle_type));
+		free_list = h;
+	}
+
+	// Gives all chunks back to the allocator; handles of all areas become invalid
+	void release() {
+		if (id == null_handle) return;
+		for (size_t i = 0; i != chunk_nm - 1 && chunks[i] != nullptr; ++i) {
+			alloc.deallocate(chunks[i], size_t(1) << (i + first_chunk_log));
+			chunks[i] = nullptr;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex());
+			pools.tables[id >> local_bits] = nullptr;
+		}
+		id = null_handle;
+		next = 0;
+		free_list = null_handle;
+	}
+};
+
+template<typename T, segment_size_t C, typename A, size_t P = default_area_pool_bits>
+// T models Regular
+// A models Allocator
+struct compact_segment_header
+{
+	using value_type = T;
+	struct area_type { T data[C]; };
+	using pool_type = compact_area_pool<area_type, A, P>;
+	using handle_type = typename pool_type::handle_type;
+	static constexpr segment_size_t capacity = C;
+
+	handle_type handle;
+	segment_size_t first;
+	segment_size_t last;
+};
+
+template<typename T, segment_size_t C, typename A, size_t P>
+// T models Regular
+inline
+typename compact_segment_header<T, C, A, P>::handle_type handle(const compact_segment_header<T, C, A, P>& h) { return h.handle; }
+
+template<typename T, segment_size_t C, typename A, size_t P>
+// T models Regular
+inline
+void set_handle(compact_segment_header<T, C, A, P>& h, typename compact_segment_header<T, C, A, P>::handle_type handle) { h.handle = handle; }
+
+template<typename T, segment_size_t C, typename A, size_t P>
+// T models Regular
+inline
+AreaType<compact_segment_header<T, C, A, P>>* area(const compact_segment_header<T, C, A, P>& h) {
+	return compact_segment_header<T, C, A, P>::pool_type::area(h.handle);
+}
+
+template<typename T, segment_size_t C, typename A, size_t P>
+// T models Regular
+inline
+ValueType<compact_segment_header<T, C, A, P>>* data(compact_segment_header<T, C, A, P>& h) { return area(h)->data; }
+
+template<typename T, segment_size_t C, typename A, size_t P>
+// T models Regular
+inline
+const ValueType<compact_segment_header<T, C, A, P>>* data(const compact_segment_header<T, C, A, P>& h) { return area(h)->data; }
+
+template<typename T, segment_size_t C, typename A, size_t P>
+// T models Regular
+inline
+void set_begin_index(compact_segment_header<T, C, A, P>& h, size_t index) { h.first = static_cast<segment_size_t>(index); }
+
+template<typename T, segment_size_t C, typename A, size_t P>
+// T models Regular
+inline
+void set_end_index(compact_segment_header<T, C, A, P>& h, size_t index) { h.last = static_cast<segment_size_t>(index); }
+
+template<typename T, segment_size_t C, typename A, size_t P>
+// T models Regular
+inline
+size_t begin_index(const compact_segment_header<T, C, A, P>& h) { return static_cast<size_t>(h.first); }
+
+template<typename T, segment_size_t C, typename A, size_t P>
+// T models Regular
+inline
+size_t end_index(const compact_segment_header<T, C, A, P>& h) { return static_cast<size_t>(h.last); }
+
+
 template<typename H>
 // H models SegmentHeader
 inline
@@ -641,7 +859,9 @@ struct const_segmented_coordinate
 	pointer operator->() const { return pointer(&**this); }
 
 	const_segmented_coordinate& operator++() {
-		if (_flat == --std::end(_seg)) {
+		flat_iterator __flat = std::end(_seg);
+		--__flat;
+		if (_flat == __flat) {
 			++_seg;
 			_flat = std::begin(_seg); // Reason why must "last" segment must be after the segment which holds the last element
 		}
@@ -657,7 +877,9 @@ struct const_segmented_coordinate
 	}
 	const_segmented_coordinate& operator--() {
 		if (_flat == std::begin(_seg)) {
-			_flat = --std::end(--_seg);
+			--_seg;
+			_flat = std::end(_seg);
+			--_flat;
 		}
 		else {
 			--_flat;
@@ -4,4 +4,5 @@
 #include "seg_container.h"
 #include "seg_algorithm.h"
 #include "flat_algorithm.h"
-#include "pool_allocator.h"
\ No newline at end of file
+#include "pool_allocator.h"
+#include "mapped_array.h"
\ No newline at end of file
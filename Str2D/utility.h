@@ -5,8 +5,13 @@
 #include <memory>
 #include <utility>
 #include <cstdlib>
+#include <cstdint>
 #include <vector>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 namespace str2d
 { 
 
@@ -195,5 +200,68 @@ struct upper_bound_predicate
 	}
 };
 
+template<typename P, typename VK>
+// P models UnaryPredicate
+// VK models ValueToKey
+// Domain<P> == key type of VK
+struct value_key_predicate
+{
+	P p;
+
+	value_key_predicate(P p) : p(p) {}
+
+	template<typename T>
+	// T == value type of VK
+	bool operator()(const T& y) const {
+		return p(VK::get(y));
+	}
+};
+
+// Position of the highest set bit of "x"
+inline
+std::size_t log2_floor(std::uint64_t x) {
+	// precondition: x != 0
+#if defined(_MSC_VER)
+	unsigned long i;
+	_BitScanReverse64(&i, x);
+	return static_cast<std::size_t>(i);
+#else
+	return static_cast<std::size_t>(63 - __builtin_clzll(x));
+#endif
+}
+
+// Position of the lowest set bit of "x"
+inline
+std::size_t count_trailing_zeros(std::uint64_t x) {
+	// precondition: x != 0
+#if defined(_MSC_VER)
+	unsigned long i;
+	_BitScanForward64(&i, x);
+	return static_cast<std::size_t>(i);
+#else
+	return static_cast<std::size_t>(__builtin_ctzll(x));
+#endif
+}
+
+// Number of set bits of "x"
+inline
+std::size_t popcount(std::uint64_t x) {
+#if defined(_MSC_VER)
+	return static_cast<std::size_t>(__popcnt64(x));
+#else
+	return static_cast<std::size_t>(__builtin_popcountll(x));
+#endif
+}
+
+// Asks the processor to bring the cache line holding "p" into the cache, without waiting for it
+inline
+void prefetch(const void* p) {
+#if defined(_MSC_VER)
+	_mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#else
+	__builtin_prefetch(p);
+#endif
+}
+
 
-} // namespace str2d
\ No newline at end of file
+} // namespace str2d
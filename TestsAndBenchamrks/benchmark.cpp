@@ -20,6 +20,11 @@
 #define ERASE_SINGLE_TEST 0
 #define INSERT_SORTED_UNGUARDED_TEST 0
 #define ERASE_RANGE 1
+#define INSERT_LATENCY_TEST 0
+#define HEADER_GROWTH_TEST 0
+#define HEADER_CHURN_TEST 0
+#define BULK_LOAD_TEST 0
+#define INGEST_TEST 0
 
 
 #define _BENCHMARK_REGISTER_F(Fix, TestName, TimeUnit) BENCHMARK_REGISTER_F(Fix, TestName) \
@@ -75,6 +80,115 @@ using segmented_set_big_binary = str2d::seg::multiset_big_header<
 	str2d::flat::find_adaptor_binary,
 	str2d::flat::equal_range_adaptor_binary>;
 
+template<typename T, std::size_t C>
+using segmented_set_buffered_binary = str2d::seg::buffered_container_tmp<segmented_set_big_binary<T, C>>;
+
+template<typename T, std::size_t C>
+using segmented_set_big_simd = str2d::seg::multiset_big_header<
+	T,
+	std::less<T>,
+	C,
+	std::allocator<T>,
+	str2d::flat::find_adaptor_simd,
+	str2d::flat::equal_range_adaptor_simd>;
+
+template<typename T, std::size_t C>
+using segmented_set_big_interpolation = str2d::seg::multiset_big_header<
+	T,
+	std::less<T>,
+	C,
+	std::allocator<T>,
+	str2d::flat::find_adaptor_interpolation,
+	str2d::flat::equal_range_adaptor_interpolation>;
+
+template<typename T, std::size_t C>
+using segmented_set_big_adaptive = str2d::seg::multiset_big_header<
+	T,
+	std::less<T>,
+	C,
+	std::allocator<T>,
+	str2d::flat::find_adaptor_adaptive,
+	str2d::flat::equal_range_adaptor_adaptive>;
+
+template<typename T, std::size_t C>
+using segmented_set_big_branchless = str2d::seg::multiset_big_header<
+	T,
+	std::less<T>,
+	C,
+	std::allocator<T>,
+	str2d::flat::branchless_segments<str2d::flat::find_adaptor_binary>,
+	str2d::flat::branchless_segments<str2d::flat::equal_range_adaptor_binary>>;
+
+template<typename T, std::size_t C>
+using segmented_set_blocked_binary = str2d::seg::multiset_blocked_header<
+	T,
+	std::less<T>,
+	C,
+	std::allocator<T>,
+	str2d::flat::find_adaptor_binary,
+	str2d::flat::equal_range_adaptor_binary>;
+
+template<typename T, std::size_t C>
+using segmented_set_counted_binary = str2d::seg::multiset_counted_big_header<
+	T,
+	std::less<T>,
+	C,
+	std::allocator<T>,
+	str2d::flat::find_adaptor_binary,
+	str2d::flat::equal_range_adaptor_binary>;
+
+template<typename T, std::size_t C>
+using segmented_set_compact_binary = str2d::seg::multiset_compact_header<
+	T,
+	std::less<T>,
+	C,
+	std::allocator<T>,
+	str2d::flat::find_adaptor_binary,
+	str2d::flat::equal_range_adaptor_binary>;
+
+template<typename T, std::size_t C>
+using segmented_set_gapped_binary = str2d::seg::multiset_gapped_header<
+	T,
+	std::less<T>,
+	C,
+	std::allocator<T>,
+	str2d::flat::find_adaptor_binary,
+	str2d::flat::equal_range_adaptor_binary>;
+
+template<typename T, std::size_t C>
+using segmented_set_growing_binary = str2d::seg::multiset_growing_header<
+	T,
+	std::less<T>,
+	C,
+	std::allocator<T>,
+	str2d::flat::find_adaptor_binary,
+	str2d::flat::equal_range_adaptor_binary>;
+template<typename T, std::size_t C>
+using segmented_set_learned_binary = str2d::seg::multiset_learned_big_header<
+	T,
+	std::less<T>,
+	C,
+	std::allocator<T>,
+	str2d::flat::find_adaptor_binary,
+	str2d::flat::equal_range_adaptor_binary>;
+
+template<typename T, std::size_t C>
+using segmented_set_sampled_binary = str2d::seg::multiset_sampled_big_header<
+	T,
+	std::less<T>,
+	C,
+	std::allocator<T>,
+	str2d::flat::find_adaptor_binary,
+	str2d::flat::equal_range_adaptor_binary>;
+template<typename T, std::size_t C>
+using segmented_set_hashed_binary = str2d::seg::multiset_hashed_big_header<
+	T,
+	std::less<T>,
+	C,
+	std::allocator<T>,
+	str2d::flat::find_adaptor_binary,
+	str2d::flat::equal_range_adaptor_binary>;
+
 
 static std::default_random_engine rand_engine(static_cast<unsigned int>(std::chrono::system_clock::now().time_since_epoch().count()));
 static std::uniform_int_distribution<bint> rand_int_distribution(std::numeric_limits<bint>::min(), std::numeric_limits<bint>::max());
@@ -155,7 +269,7 @@ void ConstructSegmentedSetFromSorted(C& set, std::size_t s) {
 	if (Fixture::sorted.empty()) return;
 
 	if constexpr (std::is_same_v<str2d::ValueType<C>, bint>) {
-		set.insert_sorted_unguarded(set.upper_bound(Fixture::sorted.front()), Fixture::sorted.begin(), s);
+		set.assign_sorted(Fixture::sorted.begin(), s);
 	}
 }
 
@@ -214,6 +328,40 @@ void SegmentedSetInsertSingleLoop(C& set, benchmark::State& state) {
 	}
 }
 
+// Elements go into the write buffer, which is merged into the set once it's full; the set grows by one element every iteration
+template<typename C>
+inline
+void SegmentedSetInsertBufferedLoop(C& set, benchmark::State& state) {
+	ConstructSegmentedSetFromSorted(set, state.range(0));
+
+	std::size_t i = 0;
+	for (auto _ : state) {
+		set.insert(Fixture::unsorted[i]);
+		++i;
+	}
+}
+
+// Elements are inserted in order, each hinted with the position of the previous one
+template<typename C>
+inline
+void SegmentedSetInsertHintLoop(C& set, benchmark::State& state) {
+	ConstructSegmentedSetFromSorted(set, state.range(0));
+
+	std::size_t i = 0;
+	auto hint = set.cbegin();
+	for (auto _ : state) {
+		auto it = set.insert_hint(hint, Fixture::sorted[i]);
+		state.PauseTiming();
+		hint = set.erase(it);
+		++i;
+		if (i == static_cast<std::size_t>(state.range(0))) {
+			i = 0;
+			hint = set.cbegin();
+		}
+		state.ResumeTiming();
+	}
+}
+
 BENCHMARK_DEFINE_F(Fixture, SetInsertSingle_INT64)(benchmark::State& state) {
 	SetInsertSingleLoop(std::multiset<std::int64_t>(), state);
 }
@@ -276,6 +424,84 @@ BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSingle_BIG_BINARY_INT64_C8192)(ben
 	SegmentedSetInsertSingleLoop(segmented_set_big_binary<std::int64_t, 8192>(), state);
 }
 
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSingle_BLOCKED_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetInsertSingleLoop(segmented_set_blocked_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSingle_BLOCKED_BINARY_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetInsertSingleLoop(segmented_set_blocked_binary<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSingle_BLOCKED_BINARY_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetInsertSingleLoop(segmented_set_blocked_binary<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSingle_BLOCKED_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetInsertSingleLoop(segmented_set_blocked_binary<std::int64_t, 8192>(), state);
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSingle_HASHED_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetInsertSingleLoop(segmented_set_hashed_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSingle_HASHED_BINARY_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetInsertSingleLoop(segmented_set_hashed_binary<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSingle_HASHED_BINARY_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetInsertSingleLoop(segmented_set_hashed_binary<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSingle_HASHED_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetInsertSingleLoop(segmented_set_hashed_binary<std::int64_t, 8192>(), state);
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSingle_COMPACT_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetInsertSingleLoop(segmented_set_compact_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSingle_COMPACT_BINARY_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetInsertSingleLoop(segmented_set_compact_binary<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSingle_COMPACT_BINARY_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetInsertSingleLoop(segmented_set_compact_binary<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSingle_COMPACT_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetInsertSingleLoop(segmented_set_compact_binary<std::int64_t, 8192>(), state);
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSingle_GAPPED_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetInsertSingleLoop(segmented_set_gapped_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSingle_GAPPED_BINARY_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetInsertSingleLoop(segmented_set_gapped_binary<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSingle_GAPPED_BINARY_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetInsertSingleLoop(segmented_set_gapped_binary<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSingle_GAPPED_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetInsertSingleLoop(segmented_set_gapped_binary<std::int64_t, 8192>(), state);
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertHint_BIG_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetInsertHintLoop(segmented_set_big_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertHint_BIG_BINARY_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetInsertHintLoop(segmented_set_big_binary<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertHint_BIG_BINARY_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetInsertHintLoop(segmented_set_big_binary<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertHint_BIG_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetInsertHintLoop(segmented_set_big_binary<std::int64_t, 8192>(), state);
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertBuffered_BIG_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetInsertBufferedLoop(segmented_set_buffered_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertBuffered_BIG_BINARY_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetInsertBufferedLoop(segmented_set_buffered_binary<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertBuffered_BIG_BINARY_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetInsertBufferedLoop(segmented_set_buffered_binary<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertBuffered_BIG_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetInsertBufferedLoop(segmented_set_buffered_binary<std::int64_t, 8192>(), state);
+}
+
 #define _BENCHMARK_REGISTER_F_INSERT_SINGLE(Fix, TestName) _BENCHMARK_REGISTER_F(Fix, TestName, benchmark::kNanosecond);
 
 _BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SetInsertSingle_INT64)
@@ -303,8 +529,37 @@ _BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertSingle_BIG_BINARY
 _BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertSingle_BIG_BINARY_INT64_C4096)
 _BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertSingle_BIG_BINARY_INT64_C8192)
 
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertSingle_BLOCKED_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertSingle_BLOCKED_BINARY_INT64_C2048)
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertSingle_BLOCKED_BINARY_INT64_C4096)
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertSingle_BLOCKED_BINARY_INT64_C8192)
+
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertSingle_HASHED_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertSingle_HASHED_BINARY_INT64_C2048)
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertSingle_HASHED_BINARY_INT64_C4096)
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertSingle_HASHED_BINARY_INT64_C8192)
+
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertSingle_COMPACT_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertSingle_COMPACT_BINARY_INT64_C2048)
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertSingle_COMPACT_BINARY_INT64_C4096)
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertSingle_COMPACT_BINARY_INT64_C8192)
+
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertSingle_GAPPED_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertSingle_GAPPED_BINARY_INT64_C2048)
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertSingle_GAPPED_BINARY_INT64_C4096)
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertSingle_GAPPED_BINARY_INT64_C8192)
+
+
 
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertHint_BIG_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertHint_BIG_BINARY_INT64_C2048)
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertHint_BIG_BINARY_INT64_C4096)
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertHint_BIG_BINARY_INT64_C8192)
 
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertBuffered_BIG_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertBuffered_BIG_BINARY_INT64_C2048)
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertBuffered_BIG_BINARY_INT64_C4096)
+_BENCHMARK_REGISTER_F_INSERT_SINGLE(Fixture, SegmentedSetInsertBuffered_BIG_BINARY_INT64_C8192)
 #endif // INSERT_SINGLE_TEST
 
 
@@ -449,6 +704,87 @@ void SegmentedSetLookupLoop(C& set, benchmark::State& state) {
 	}
 }
 
+template<typename C>
+inline
+void SegmentedSetFrozenLookupLoop(C& set, benchmark::State& state) {
+	ConstructSegmentedSetFromSorted(set, state.range(0));
+	set.freeze();
+	std::size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(set.lower_bound(Fixture::unsorted[i]));
+		++i;
+	}
+}
+
+// Every lookup is for one of the 2000 elements around the previous one
+template<typename C>
+inline
+void SegmentedSetClusteredLookupLoop(C& set, benchmark::State& state, bool cached) {
+	ConstructSegmentedSetFromSorted(set, state.range(0));
+	if (cached) set.enable_segment_cache();
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	std::size_t j = n / 2;
+	std::size_t i = 0;
+	for (auto _ : state) {
+		j = (j + n + static_cast<std::size_t>(Fixture::unsorted[i]) % 2001 - 1000) % n;
+		benchmark::DoNotOptimize(set.lower_bound(Fixture::sorted[j]));
+		++i;
+	}
+}
+
+// Every lookup is for one of the first "lookup_hot_nm" unsorted elements
+static constexpr std::size_t lookup_hot_nm = 1 << 16;
+
+template<typename C>
+inline
+void SegmentedSetHotEqualRangeLoop(C& set, benchmark::State& state) {
+	ConstructSegmentedSetFromSorted(set, state.range(0));
+	std::size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(set.equal_range(Fixture::unsorted[i & (lookup_hot_nm - 1)]));
+		++i;
+	}
+}
+
+// Every iteration looks up a batch of "lookup_batch_nm" keys
+static constexpr std::size_t lookup_batch_nm = 256;
+
+template<typename C>
+inline
+void SegmentedSetBatchLookupLoop(C& set, benchmark::State& state) {
+	ConstructSegmentedSetFromSorted(set, state.range(0));
+	std::vector<typename C::segmented_coordinate> out(lookup_batch_nm);
+	std::size_t i = 0;
+	for (auto _ : state) {
+		auto first = Fixture::unsorted.begin() + i;
+		set.lower_bound_batch(first, first + lookup_batch_nm, out.begin());
+		benchmark::DoNotOptimize(out.data());
+		i = i + lookup_batch_nm;
+		if (i + lookup_batch_nm > Fixture::unsorted.size()) i = 0;
+	}
+	state.SetItemsProcessed(state.iterations() * lookup_batch_nm);
+}
+
+// Same as "SegmentedSetBatchLookupLoop", but keys of every batch are sorted
+template<typename C>
+inline
+void SegmentedSetSortedBatchLookupLoop(C& set, benchmark::State& state) {
+	ConstructSegmentedSetFromSorted(set, state.range(0));
+	std::vector<bint> keys(Fixture::unsorted.begin(), Fixture::unsorted.begin() + std::min(Fixture::unsorted.size(), std::size_t(1) << 20));
+	for (std::size_t i = 0; i + lookup_batch_nm <= keys.size(); i = i + lookup_batch_nm)
+		std::sort(keys.begin() + i, keys.begin() + i + lookup_batch_nm);
+	std::vector<typename C::segmented_coordinate> out(lookup_batch_nm);
+	std::size_t i = 0;
+	for (auto _ : state) {
+		auto first = keys.begin() + i;
+		set.lower_bound_sorted_batch(first, first + lookup_batch_nm, out.begin());
+		benchmark::DoNotOptimize(out.data());
+		i = i + lookup_batch_nm;
+		if (i + lookup_batch_nm > keys.size()) i = 0;
+	}
+	state.SetItemsProcessed(state.iterations() * lookup_batch_nm);
+}
+
 BENCHMARK_DEFINE_F(Fixture, SetLookup_INT64)(benchmark::State& state) {
 	SetLookupLoop(std::multiset<std::int64_t>(), state);
 }
@@ -514,6 +850,189 @@ BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_BIG_BINARY_INT64_C8192)(benchmark
 	SegmentedSetLookupLoop(segmented_set_big_binary<std::int64_t, 8192>(), state);
 }
 
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_BIG_BRANCHLESS_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_big_branchless<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_BIG_BRANCHLESS_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_big_branchless<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_BIG_BRANCHLESS_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_big_branchless<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_BIG_BRANCHLESS_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_big_branchless<std::int64_t, 8192>(), state);
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetBatchLookup_BIG_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetBatchLookupLoop(segmented_set_big_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetBatchLookup_BIG_BINARY_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetBatchLookupLoop(segmented_set_big_binary<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetBatchLookup_BIG_BINARY_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetBatchLookupLoop(segmented_set_big_binary<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetBatchLookup_BIG_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetBatchLookupLoop(segmented_set_big_binary<std::int64_t, 8192>(), state);
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetSortedBatchLookup_BIG_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetSortedBatchLookupLoop(segmented_set_big_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetSortedBatchLookup_BIG_BINARY_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetSortedBatchLookupLoop(segmented_set_big_binary<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetSortedBatchLookup_BIG_BINARY_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetSortedBatchLookupLoop(segmented_set_big_binary<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetSortedBatchLookup_BIG_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetSortedBatchLookupLoop(segmented_set_big_binary<std::int64_t, 8192>(), state);
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetClusteredLookup_BIG_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetClusteredLookupLoop(segmented_set_big_binary<std::int64_t, 1024>(), state, false);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetCachedLookup_BIG_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetClusteredLookupLoop(segmented_set_big_binary<std::int64_t, 1024>(), state, true);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetClusteredLookup_BIG_BINARY_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetClusteredLookupLoop(segmented_set_big_binary<std::int64_t, 2048>(), state, false);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetCachedLookup_BIG_BINARY_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetClusteredLookupLoop(segmented_set_big_binary<std::int64_t, 2048>(), state, true);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetClusteredLookup_BIG_BINARY_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetClusteredLookupLoop(segmented_set_big_binary<std::int64_t, 4096>(), state, false);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetCachedLookup_BIG_BINARY_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetClusteredLookupLoop(segmented_set_big_binary<std::int64_t, 4096>(), state, true);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetClusteredLookup_BIG_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetClusteredLookupLoop(segmented_set_big_binary<std::int64_t, 8192>(), state, false);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetCachedLookup_BIG_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetClusteredLookupLoop(segmented_set_big_binary<std::int64_t, 8192>(), state, true);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetHotEqualRange_BIG_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetHotEqualRangeLoop(segmented_set_big_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetHotEqualRange_HASHED_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetHotEqualRangeLoop(segmented_set_hashed_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetHotEqualRange_BIG_BINARY_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetHotEqualRangeLoop(segmented_set_big_binary<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetHotEqualRange_HASHED_BINARY_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetHotEqualRangeLoop(segmented_set_hashed_binary<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetHotEqualRange_BIG_BINARY_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetHotEqualRangeLoop(segmented_set_big_binary<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetHotEqualRange_HASHED_BINARY_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetHotEqualRangeLoop(segmented_set_hashed_binary<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetHotEqualRange_BIG_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetHotEqualRangeLoop(segmented_set_big_binary<std::int64_t, 8192>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetHotEqualRange_HASHED_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetHotEqualRangeLoop(segmented_set_hashed_binary<std::int64_t, 8192>(), state);
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_BIG_ADAPTIVE_INT64_C1024)(benchmark::State& state) {
+	str2d::flat::calibrate<std::int64_t>();
+	SegmentedSetLookupLoop(segmented_set_big_adaptive<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_BIG_ADAPTIVE_INT64_C2048)(benchmark::State& state) {
+	str2d::flat::calibrate<std::int64_t>();
+	SegmentedSetLookupLoop(segmented_set_big_adaptive<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_BIG_ADAPTIVE_INT64_C4096)(benchmark::State& state) {
+	str2d::flat::calibrate<std::int64_t>();
+	SegmentedSetLookupLoop(segmented_set_big_adaptive<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_BIG_ADAPTIVE_INT64_C8192)(benchmark::State& state) {
+	str2d::flat::calibrate<std::int64_t>();
+	SegmentedSetLookupLoop(segmented_set_big_adaptive<std::int64_t, 8192>(), state);
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_BIG_INTERPOLATION_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_big_interpolation<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_BIG_INTERPOLATION_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_big_interpolation<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_BIG_INTERPOLATION_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_big_interpolation<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_BIG_INTERPOLATION_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_big_interpolation<std::int64_t, 8192>(), state);
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_BIG_SIMD_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_big_simd<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_BIG_SIMD_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_big_simd<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_BIG_SIMD_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_big_simd<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_BIG_SIMD_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_big_simd<std::int64_t, 8192>(), state);
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_COMPACT_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_compact_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_COMPACT_BINARY_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_compact_binary<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_COMPACT_BINARY_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_compact_binary<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_COMPACT_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_compact_binary<std::int64_t, 8192>(), state);
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_LEARNED_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_learned_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_LEARNED_BINARY_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_learned_binary<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_LEARNED_BINARY_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_learned_binary<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_LEARNED_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_learned_binary<std::int64_t, 8192>(), state);
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_SAMPLED_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_sampled_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_SAMPLED_BINARY_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_sampled_binary<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_SAMPLED_BINARY_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_sampled_binary<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_SAMPLED_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetLookupLoop(segmented_set_sampled_binary<std::int64_t, 8192>(), state);
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_FROZEN_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetFrozenLookupLoop(segmented_set_big_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_FROZEN_BINARY_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetFrozenLookupLoop(segmented_set_big_binary<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_FROZEN_BINARY_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetFrozenLookupLoop(segmented_set_big_binary<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetLookup_FROZEN_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetFrozenLookupLoop(segmented_set_big_binary<std::int64_t, 8192>(), state);
+}
+
 #define _BENCHMARK_REGISTER_F_LOOKUP(Fix, TestName) _BENCHMARK_REGISTER_F(Fix, TestName, benchmark::kNanosecond);
 
 _BENCHMARK_REGISTER_F_LOOKUP(Fixture, SetLookup_INT64)
@@ -541,10 +1060,318 @@ _BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_BIG_BINARY_INT64_C2048)
 _BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_BIG_BINARY_INT64_C4096)
 _BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_BIG_BINARY_INT64_C8192)
 
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_BIG_BRANCHLESS_INT64_C1024)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_BIG_BRANCHLESS_INT64_C2048)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_BIG_BRANCHLESS_INT64_C4096)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_BIG_BRANCHLESS_INT64_C8192)
+
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetBatchLookup_BIG_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetBatchLookup_BIG_BINARY_INT64_C2048)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetBatchLookup_BIG_BINARY_INT64_C4096)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetBatchLookup_BIG_BINARY_INT64_C8192)
+
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetSortedBatchLookup_BIG_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetSortedBatchLookup_BIG_BINARY_INT64_C2048)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetSortedBatchLookup_BIG_BINARY_INT64_C4096)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetSortedBatchLookup_BIG_BINARY_INT64_C8192)
+
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetClusteredLookup_BIG_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetClusteredLookup_BIG_BINARY_INT64_C2048)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetClusteredLookup_BIG_BINARY_INT64_C4096)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetClusteredLookup_BIG_BINARY_INT64_C8192)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetCachedLookup_BIG_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetCachedLookup_BIG_BINARY_INT64_C2048)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetCachedLookup_BIG_BINARY_INT64_C4096)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetCachedLookup_BIG_BINARY_INT64_C8192)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetHotEqualRange_BIG_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetHotEqualRange_BIG_BINARY_INT64_C2048)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetHotEqualRange_BIG_BINARY_INT64_C4096)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetHotEqualRange_BIG_BINARY_INT64_C8192)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetHotEqualRange_HASHED_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetHotEqualRange_HASHED_BINARY_INT64_C2048)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetHotEqualRange_HASHED_BINARY_INT64_C4096)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetHotEqualRange_HASHED_BINARY_INT64_C8192)
+
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_BIG_ADAPTIVE_INT64_C1024)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_BIG_ADAPTIVE_INT64_C2048)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_BIG_ADAPTIVE_INT64_C4096)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_BIG_ADAPTIVE_INT64_C8192)
+
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_BIG_INTERPOLATION_INT64_C1024)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_BIG_INTERPOLATION_INT64_C2048)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_BIG_INTERPOLATION_INT64_C4096)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_BIG_INTERPOLATION_INT64_C8192)
+
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_BIG_SIMD_INT64_C1024)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_BIG_SIMD_INT64_C2048)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_BIG_SIMD_INT64_C4096)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_BIG_SIMD_INT64_C8192)
+
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_COMPACT_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_COMPACT_BINARY_INT64_C2048)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_COMPACT_BINARY_INT64_C4096)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_COMPACT_BINARY_INT64_C8192)
+
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_LEARNED_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_LEARNED_BINARY_INT64_C2048)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_LEARNED_BINARY_INT64_C4096)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_LEARNED_BINARY_INT64_C8192)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_SAMPLED_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_SAMPLED_BINARY_INT64_C2048)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_SAMPLED_BINARY_INT64_C4096)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_SAMPLED_BINARY_INT64_C8192)
+
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_FROZEN_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_FROZEN_BINARY_INT64_C2048)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_FROZEN_BINARY_INT64_C4096)
+_BENCHMARK_REGISTER_F_LOOKUP(Fixture, SegmentedSetLookup_FROZEN_BINARY_INT64_C8192)
+
 #endif // LOOKUP_TEST
 
 
 
+#if INSERT_LATENCY_TEST
+
+// Inserts "state.range(0)" random elements into an empty set, timing every insertion on its own.
+// Reports the 99th and 99.9th percentile and the largest latency, which includes growing the index of headers.
+template<typename C>
+inline
+void SegmentedSetInsertLatencyLoop(C& set, benchmark::State& state) {
+	std::size_t s = static_cast<std::size_t>(state.range(0));
+	std::vector<double> latencies(s);
+	for (auto _ : state) {
+		state.PauseTiming();
+		set.clear();
+		state.ResumeTiming();
+		for (std::size_t i = 0; i < s; ++i) {
+			auto start = std::chrono::steady_clock::now();
+			set.insert(Fixture::unsorted[i]);
+			latencies[i] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		}
+	}
+	std::sort(latencies.begin(), latencies.end());
+	state.counters["p99_ns"] = latencies[s * 99 / 100];
+	state.counters["p999_ns"] = latencies[s * 999 / 1000];
+	state.counters["max_ns"] = latencies.back();
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertLatency_BIG_BINARY_INT64_C16)(benchmark::State& state) {
+	SegmentedSetInsertLatencyLoop(segmented_set_big_binary<std::int64_t, 16>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertLatency_BIG_BINARY_INT64_C64)(benchmark::State& state) {
+	SegmentedSetInsertLatencyLoop(segmented_set_big_binary<std::int64_t, 64>(), state);
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertLatency_GROWING_BINARY_INT64_C16)(benchmark::State& state) {
+	SegmentedSetInsertLatencyLoop(segmented_set_growing_binary<std::int64_t, 16>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertLatency_GROWING_BINARY_INT64_C64)(benchmark::State& state) {
+	SegmentedSetInsertLatencyLoop(segmented_set_growing_binary<std::int64_t, 64>(), state);
+}
+
+#define _BENCHMARK_REGISTER_F_INSERT_LATENCY(Fix, TestName) BENCHMARK_REGISTER_F(Fix, TestName) \
+	->Arg(1 << 22)  \
+	->Arg(1 << 25)  \
+	->Iterations(1) \
+	->Unit(benchmark::kMillisecond);
+
+_BENCHMARK_REGISTER_F_INSERT_LATENCY(Fixture, SegmentedSetInsertLatency_BIG_BINARY_INT64_C16)
+_BENCHMARK_REGISTER_F_INSERT_LATENCY(Fixture, SegmentedSetInsertLatency_BIG_BINARY_INT64_C64)
+
+_BENCHMARK_REGISTER_F_INSERT_LATENCY(Fixture, SegmentedSetInsertLatency_GROWING_BINARY_INT64_C16)
+_BENCHMARK_REGISTER_F_INSERT_LATENCY(Fixture, SegmentedSetInsertLatency_GROWING_BINARY_INT64_C64)
+
+#endif // INSERT_LATENCY_TEST
+
+
+
+#if HEADER_GROWTH_TEST
+
+using big_header_int64 = str2d::seg::big_segment_header<bint, 1024>;
+
+// Grows a full container of "state.range(0)" headers by inserting one header in the middle of it,
+// the way "big_header_index" does when it runs out of free headers.
+template<typename C>
+inline
+void HeaderGrowthLoop(benchmark::State& state) {
+	std::size_t s = static_cast<std::size_t>(state.range(0));
+	C headers;
+	for (auto _ : state) {
+		state.PauseTiming();
+		headers = C(s);
+		auto first = std::begin(headers);
+		auto last = std::end(headers);
+		auto insert = first + (s >> 1);
+		state.ResumeTiming();
+		str2d::seg::grow_headers(headers, first, last, insert, 1u);
+		benchmark::DoNotOptimize(&*insert);
+	}
+}
+
+BENCHMARK_DEFINE_F(Fixture, HeaderGrowth_VECTOR)(benchmark::State& state) {
+	HeaderGrowthLoop<std::vector<big_header_int64>>(state);
+}
+BENCHMARK_DEFINE_F(Fixture, HeaderGrowth_MAPPED_ARRAY)(benchmark::State& state) {
+	HeaderGrowthLoop<str2d::mapped_array<big_header_int64>>(state);
+}
+
+#define _BENCHMARK_REGISTER_F_HEADER_GROWTH(Fix, TestName) BENCHMARK_REGISTER_F(Fix, TestName) \
+	->Arg(1000000)   \
+	->Arg(10000000)  \
+	->Arg(100000000) \
+	->Unit(benchmark::kMillisecond);
+
+_BENCHMARK_REGISTER_F_HEADER_GROWTH(Fixture, HeaderGrowth_VECTOR)
+_BENCHMARK_REGISTER_F_HEADER_GROWTH(Fixture, HeaderGrowth_MAPPED_ARRAY)
+
+#endif // HEADER_GROWTH_TEST
+
+
+#if HEADER_CHURN_TEST
+
+// Inserts a segment worth of copies of a random element into a set of "state.range(0)" elements and erases them again,
+// so that every iteration allocates segments in the middle of the index and deallocates them.
+template<typename C>
+inline
+void SegmentedSetHeaderChurnLoop(C& set, benchmark::State& state, std::size_t capacity) {
+	ConstructSegmentedSetFromSorted(set, state.range(0));
+
+	std::vector<bint> copies(capacity);
+	std::size_t i = 0;
+	for (auto _ : state) {
+		std::fill(copies.begin(), copies.end(), Fixture::unsorted[i]);
+		set.insert_batch(copies.begin(), copies.size());
+		set.erase(set.lower_bound(Fixture::unsorted[i]), set.upper_bound(Fixture::unsorted[i]));
+		++i;
+	}
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetHeaderChurn_BIG_BINARY_INT64_C64)(benchmark::State& state) {
+	SegmentedSetHeaderChurnLoop(segmented_set_big_binary<std::int64_t, 64>(), state, 64);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetHeaderChurn_COUNTED_BINARY_INT64_C64)(benchmark::State& state) {
+	SegmentedSetHeaderChurnLoop(segmented_set_counted_binary<std::int64_t, 64>(), state, 64);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetHeaderChurn_BLOCKED_BINARY_INT64_C64)(benchmark::State& state) {
+	SegmentedSetHeaderChurnLoop(segmented_set_blocked_binary<std::int64_t, 64>(), state, 64);
+}
+
+#define _BENCHMARK_REGISTER_F_HEADER_CHURN(Fix, TestName) BENCHMARK_REGISTER_F(Fix, TestName) \
+	->Arg(1 << 20)  \
+	->Arg(1 << 22)  \
+	->Arg(1 << 24)  \
+	->Unit(benchmark::kMicrosecond);
+
+_BENCHMARK_REGISTER_F_HEADER_CHURN(Fixture, SegmentedSetHeaderChurn_BIG_BINARY_INT64_C64)
+_BENCHMARK_REGISTER_F_HEADER_CHURN(Fixture, SegmentedSetHeaderChurn_COUNTED_BINARY_INT64_C64)
+_BENCHMARK_REGISTER_F_HEADER_CHURN(Fixture, SegmentedSetHeaderChurn_BLOCKED_BINARY_INT64_C64)
+
+#endif // HEADER_CHURN_TEST
+
+
+#if BULK_LOAD_TEST
+
+// Loads "state.range(0)" sorted elements into an empty set, filling the segments to "fill" of their capacity
+template<typename C>
+inline
+void SegmentedSetBulkLoadLoop(C& set, benchmark::State& state, double fill) {
+	str2d::SizeType<C> n = str2d::SizeType<C>(state.range(0));
+	for (auto _ : state) {
+		set.assign_sorted(Fixture::sorted.begin(), n, fill);
+		state.PauseTiming();
+		set.clear();
+		state.ResumeTiming();
+	}
+}
+
+// Same as above, one element at a time
+template<typename C>
+inline
+void SegmentedSetInsertLoadLoop(C& set, benchmark::State& state) {
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	for (auto _ : state) {
+		for (std::size_t i = 0; i < n; ++i) set.insert_unguarded(set.end(), Fixture::sorted[i]);
+		state.PauseTiming();
+		set.clear();
+		state.ResumeTiming();
+	}
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertLoad_BIG_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetInsertLoadLoop(segmented_set_big_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetBulkLoad_BIG_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetBulkLoadLoop(segmented_set_big_binary<std::int64_t, 1024>(), state, 1.0);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetBulkLoad75_BIG_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetBulkLoadLoop(segmented_set_big_binary<std::int64_t, 1024>(), state, 0.75);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetBulkLoad_BIG_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetBulkLoadLoop(segmented_set_big_binary<std::int64_t, 8192>(), state, 1.0);
+}
+
+#define _BENCHMARK_REGISTER_F_BULK_LOAD(Fix, TestName) _BENCHMARK_REGISTER_F(Fix, TestName, benchmark::kMillisecond);
+
+_BENCHMARK_REGISTER_F_BULK_LOAD(Fixture, SegmentedSetInsertLoad_BIG_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_BULK_LOAD(Fixture, SegmentedSetBulkLoad_BIG_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_BULK_LOAD(Fixture, SegmentedSetBulkLoad75_BIG_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_BULK_LOAD(Fixture, SegmentedSetBulkLoad_BIG_BINARY_INT64_C8192)
+
+#endif // BULK_LOAD_TEST
+
+
+
+#if INGEST_TEST
+
+template<typename C>
+inline
+void FlushBuffer(C&) {}
+
+template<typename C>
+inline
+void FlushBuffer(str2d::seg::buffered_container_tmp<C>& set) {
+	set.flush();
+}
+
+// Inserts "state.range(0)" unsorted elements into an empty set, one at a time, and reports the elements per second;
+// buffered sets merge whatever is left in the buffer at the end
+template<typename C>
+inline
+void SegmentedSetIngestLoop(C& set, benchmark::State& state) {
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	for (auto _ : state) {
+		for (std::size_t i = 0; i < n; ++i) set.insert(Fixture::unsorted[i]);
+		FlushBuffer(set);
+		state.PauseTiming();
+		set.clear();
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) * state.range(0));
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetIngest_BIG_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetIngestLoop(segmented_set_big_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetIngestBuffered_BIG_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetIngestLoop(segmented_set_buffered_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetIngestBuffered_BIG_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetIngestLoop(segmented_set_buffered_binary<std::int64_t, 8192>(), state);
+}
+
+#define _BENCHMARK_REGISTER_F_INGEST(Fix, TestName) BENCHMARK_REGISTER_F(Fix, TestName) \
+	->Arg(10000000)   \
+	->Arg(100000000)  \
+	->Unit(benchmark::kMillisecond);
+
+_BENCHMARK_REGISTER_F_INGEST(Fixture, SegmentedSetIngest_BIG_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_INGEST(Fixture, SegmentedSetIngestBuffered_BIG_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_INGEST(Fixture, SegmentedSetIngestBuffered_BIG_BINARY_INT64_C8192)
+
+#endif // INGEST_TEST
+
+
+
 #if ERASE_SINGLE_TEST
 
 template<typename C>
@@ -705,6 +1532,70 @@ void SetInsertSortedUnguardedLoop(C& set, benchmark::State& state) {
 	}
 }
 
+// Every iteration merges "state.range(1)" keys spread evenly over the whole set
+template<typename C>
+inline
+void SegmentedSetInsertSortedMergeLoop(C& set, benchmark::State& state) {
+	ConstructSegmentedSetFromSorted(set, state.range(0));
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	std::size_t m = static_cast<std::size_t>(state.range(1));
+	std::vector<bint> batch(m);
+	for (std::size_t i = 0; i < m; ++i) batch[i] = Fixture::sorted[i * (n / m)];
+	for (auto _ : state) {
+		set.insert_sorted(batch.begin(), str2d::SizeType<C>(m));
+		state.PauseTiming();
+		for (bint x : batch) set.erase(set.lower_bound(x));
+		state.ResumeTiming();
+	}
+}
+
+// Every iteration inserts the first "state.range(1)" unsorted elements as one batch
+template<typename C>
+inline
+void SegmentedSetInsertBatchLoop(C& set, benchmark::State& state) {
+	ConstructSegmentedSetFromSorted(set, state.range(0));
+	std::size_t m = static_cast<std::size_t>(state.range(1));
+	for (auto _ : state) {
+		set.insert_batch(Fixture::unsorted.begin(), str2d::SizeType<C>(m));
+		state.PauseTiming();
+		for (std::size_t i = 0; i < m; ++i) set.erase(set.lower_bound(Fixture::unsorted[i]));
+		state.ResumeTiming();
+	}
+}
+
+// Every iteration replaces "state.range(1)" elements spread over the set: each of them is erased, and inserted again
+template<typename C>
+inline
+void SegmentedSetApplyBatchLoop(C& set, benchmark::State& state) {
+	using operation = typename C::operation;
+	ConstructSegmentedSetFromSorted(set, state.range(0));
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	std::size_t m = static_cast<std::size_t>(state.range(1));
+	std::vector<operation> batch;
+	for (std::size_t i = 0; i < m; ++i) {
+		batch.push_back(operation::erase(Fixture::sorted[i * (n / m)]));
+		batch.push_back(operation::insert(Fixture::sorted[i * (n / m)]));
+	}
+	for (auto _ : state) {
+		set.apply_batch(batch.begin(), str2d::SizeType<C>(batch.size()));
+	}
+}
+
+template<typename C>
+inline
+void SegmentedSetReplaceLoop(C& set, benchmark::State& state) {
+	ConstructSegmentedSetFromSorted(set, state.range(0));
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	std::size_t m = static_cast<std::size_t>(state.range(1));
+	for (auto _ : state) {
+		for (std::size_t i = 0; i < m; ++i) {
+			bint x = Fixture::sorted[i * (n / m)];
+			set.erase(set.lower_bound(x));
+			set.insert(x);
+		}
+	}
+}
+
 template<typename C>
 inline
 void SegmentedSetInsertSortedUnguardedLoop(C& set, benchmark::State& state) {
@@ -779,6 +1670,58 @@ BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSortedUnguarded_BIG_BINARY_INT64_C
 	SegmentedSetInsertSortedUnguardedLoop(segmented_set_big_binary<std::int64_t, 8192>(), state);
 }
 
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertBatch_BIG_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetInsertBatchLoop(segmented_set_big_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertBatch_BIG_BINARY_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetInsertBatchLoop(segmented_set_big_binary<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertBatch_BIG_BINARY_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetInsertBatchLoop(segmented_set_big_binary<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertBatch_BIG_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetInsertBatchLoop(segmented_set_big_binary<std::int64_t, 8192>(), state);
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetApplyBatch_BIG_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetApplyBatchLoop(segmented_set_big_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetApplyBatch_BIG_BINARY_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetApplyBatchLoop(segmented_set_big_binary<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetApplyBatch_BIG_BINARY_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetApplyBatchLoop(segmented_set_big_binary<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetApplyBatch_BIG_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetApplyBatchLoop(segmented_set_big_binary<std::int64_t, 8192>(), state);
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetReplace_BIG_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetReplaceLoop(segmented_set_big_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetReplace_BIG_BINARY_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetReplaceLoop(segmented_set_big_binary<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetReplace_BIG_BINARY_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetReplaceLoop(segmented_set_big_binary<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetReplace_BIG_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetReplaceLoop(segmented_set_big_binary<std::int64_t, 8192>(), state);
+}
+
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSortedMerge_BIG_BINARY_INT64_C1024)(benchmark::State& state) {
+	SegmentedSetInsertSortedMergeLoop(segmented_set_big_binary<std::int64_t, 1024>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSortedMerge_BIG_BINARY_INT64_C2048)(benchmark::State& state) {
+	SegmentedSetInsertSortedMergeLoop(segmented_set_big_binary<std::int64_t, 2048>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSortedMerge_BIG_BINARY_INT64_C4096)(benchmark::State& state) {
+	SegmentedSetInsertSortedMergeLoop(segmented_set_big_binary<std::int64_t, 4096>(), state);
+}
+BENCHMARK_DEFINE_F(Fixture, SegmentedSetInsertSortedMerge_BIG_BINARY_INT64_C8192)(benchmark::State& state) {
+	SegmentedSetInsertSortedMergeLoop(segmented_set_big_binary<std::int64_t, 8192>(), state);
+}
+
 #define _BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fix, TestName) _BENCHMARK_REGISTER_SORTED_UNGUARDED_F(Fix, TestName, benchmark::kNanosecond);
 
 _BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fixture, SetInsertSortedUnguarded_INT64)
@@ -805,6 +1748,26 @@ _BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fixture, SegmentedSetInsertSortedU
 _BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fixture, SegmentedSetInsertSortedUnguarded_BIG_BINARY_INT64_C4096)
 _BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fixture, SegmentedSetInsertSortedUnguarded_BIG_BINARY_INT64_C8192)
 
+_BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fixture, SegmentedSetInsertSortedMerge_BIG_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fixture, SegmentedSetInsertSortedMerge_BIG_BINARY_INT64_C2048)
+_BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fixture, SegmentedSetInsertSortedMerge_BIG_BINARY_INT64_C4096)
+_BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fixture, SegmentedSetInsertSortedMerge_BIG_BINARY_INT64_C8192)
+
+_BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fixture, SegmentedSetInsertBatch_BIG_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fixture, SegmentedSetInsertBatch_BIG_BINARY_INT64_C2048)
+_BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fixture, SegmentedSetInsertBatch_BIG_BINARY_INT64_C4096)
+_BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fixture, SegmentedSetInsertBatch_BIG_BINARY_INT64_C8192)
+
+_BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fixture, SegmentedSetApplyBatch_BIG_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fixture, SegmentedSetApplyBatch_BIG_BINARY_INT64_C2048)
+_BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fixture, SegmentedSetApplyBatch_BIG_BINARY_INT64_C4096)
+_BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fixture, SegmentedSetApplyBatch_BIG_BINARY_INT64_C8192)
+
+_BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fixture, SegmentedSetReplace_BIG_BINARY_INT64_C1024)
+_BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fixture, SegmentedSetReplace_BIG_BINARY_INT64_C2048)
+_BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fixture, SegmentedSetReplace_BIG_BINARY_INT64_C4096)
+_BENCHMARK_REGISTER_F_INSERT_SORTED_UNGUARDED(Fixture, SegmentedSetReplace_BIG_BINARY_INT64_C8192)
+
 
 #endif // INSERT_SORTED_TEST
 
@@ -28,9 +28,33 @@
 #define INTERNAL_SEGMENT_SLIDE_TEST
 #define INTERNAL_SEGMENT_MOVE_TEST
 #define INTERNAL_INDEX_TEST
+#define INTERNAL_SMALL_INDEX_TEST
+#define INTERNAL_COMPACT_INDEX_TEST
+#define INTERNAL_BLOCKED_INDEX_TEST
+#define INTERNAL_GAPPED_INDEX_TEST
+#define INTERNAL_GROWING_INDEX_TEST
+#define INTERNAL_MAPPED_INDEX_TEST
+#define INTERNAL_COUNTED_INDEX_TEST
+#define INTERNAL_FENCED_INDEX_TEST
+#define INTERNAL_LEARNED_INDEX_TEST
+#define INTERNAL_SAMPLED_INDEX_TEST
+#define INTERNAL_HASHED_INDEX_TEST
+#define INTERNAL_FROZEN_SET_TEST
 #define INTERNAL_SEGMENTED_INSERT_TEST
 #define INTERNAL_SEGMENTED_ERASE_TEST
 #define INTERNAL_SEARCH_TEST
+#define INTERNAL_SIMD_SEARCH_TEST
+#define INTERNAL_INTERPOLATION_SEARCH_TEST
+#define INTERNAL_ADAPTIVE_SEARCH_TEST
+#define INTERNAL_BRANCHLESS_SEARCH_TEST
+#define INTERNAL_BATCH_SEARCH_TEST
+#define INTERNAL_HINTED_SEARCH_TEST
+#define INTERNAL_SEGMENT_CACHE_TEST
+#define INTERNAL_MERGE_INSERT_TEST
+#define INTERNAL_BULK_LOAD_TEST
+#define INTERNAL_BATCH_INSERT_TEST
+#define INTERNAL_APPLY_BATCH_TEST
+#define INTERNAL_BUFFERED_SET_TEST
 
 #endif // INTERNAL_TEST
 
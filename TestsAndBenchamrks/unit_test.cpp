@@ -12,6 +12,9 @@
 #include <chrono>
 #include <cstddef>
 #include <numeric>
+#include <map>
+#include <string>
+#include <limits>
 
 #include "gtest/gtest.h"
 
@@ -53,7 +56,7 @@ int value_of(value_type v) {
 
 static constexpr size_t capacity = 100;
 
-#ifdef BIG_HEADER
+#if defined(BIG_HEADER) || defined(BLOCKED_INDEX) || defined(GAPPED_INDEX) || defined(GROWING_INDEX)
 using header = big_segment_header<value_type, capacity>;
 #else
 using header = small_segment_header<value_type, capacity>;
@@ -82,6 +85,28 @@ const char* allocator_base::counter_names[number_ops] = {
 	"deallocation",
 };
 
+struct allocator;
+
+template<typename T>
+struct storage_allocator;
+
+// Index rebinds "allocator" to allocate its own storage(e.g. buffers of headers); only areas are counted
+template<typename O>
+using rebound_allocator = std::conditional_t<std::is_same_v<O, area>, allocator, storage_allocator<O>>;
+
+template<typename T>
+struct storage_allocator : std::allocator<T>
+{
+	storage_allocator() = default;
+	template<typename A>
+	storage_allocator(const A&) {}
+
+	template<typename O>
+	struct rebind {
+		using other = rebound_allocator<O>;
+	};
+};
+
 #ifdef POOL_ALLOCATOR_TEST
 
 #include "..\Str2D\pool_allocator.h"
@@ -102,7 +127,7 @@ struct allocator : allocator_base
 
 	template<typename O>
 	struct rebind {
-		using other = allocator;
+		using other = rebound_allocator<O>;
 	};
 
 	value_type* allocate(size_t n) {
@@ -119,8 +144,15 @@ struct allocator : allocator_base
 
 struct allocator : allocator_base
 {
+	using value_type = area;
+
 	std::allocator<area> alloc;
 
+	template<typename O>
+	struct rebind {
+		using other = rebound_allocator<O>;
+	};
+
 	area* allocate(size_t n) {
 		++counts[allocation];
 		return alloc.allocate(n);
@@ -133,7 +165,13 @@ struct allocator : allocator_base
 
 #endif
 
-#ifdef BIG_HEADER
+#if defined(BLOCKED_INDEX)
+using segmented_list = seg::list_blocked_header<value_type, capacity, allocator, 4>;
+#elif defined(GAPPED_INDEX)
+using segmented_list = seg::list_gapped_header<value_type, capacity, allocator>;
+#elif defined(GROWING_INDEX)
+using segmented_list = seg::list_growing_header<value_type, capacity, allocator>;
+#elif defined(BIG_HEADER)
 using segmented_list = seg::list_big_header<value_type, capacity, allocator>;
 #else
 using segmented_list = seg::list_small_header<value_type, capacity, allocator>;
@@ -1020,473 +1058,3016 @@ std::vector<header> TestIndex::v;
 #endif // INTERNAL_INDEX_TEST
 
 
-#define MEMORY_OVERFLOW_BUG
-
+// Blocked, gapped and growing indices, and big header index over a mapped array, hold big headers, which the test allocator only allocates when big headers are tested
+#if defined(BIG_HEADER) || defined(BLOCKED_INDEX) || defined(GAPPED_INDEX) || defined(GROWING_INDEX)
+#define BIG_HEADER_TEST
+#endif
 
-#if defined(INTERNAL_SEGMENTED_INSERT_TEST) || defined(INTERNAL_SEGMENTED_ERASE_TEST)
+#if defined(INTERNAL_BLOCKED_INDEX_TEST) && defined(BIG_HEADER_TEST)
 
-struct TestSegmentRangeBase : public InternalTestBase
+struct TestBlockedIndex : public InternalTestBase
 {
-	static std::vector<value_type> v;
-	static index in;
-	static segmented_coordinate first_inserted;
-	static segmented_coordinate last_inserted;
+	using blocked_index = blocked_header_index<value_type, capacity, allocator, 4>;
+	using blocked_iterator = Iterator<blocked_index>;
 
-	void SetUpSeg() override {
-		first_inserted = begin();
-		last_inserted = begin();
-	}
+	static blocked_index in;
+	static std::vector<area*> v;
 
 	void TearDownSeg() override {
-		seg::destruct(begin(), first_inserted);
-		seg::destruct(last_inserted, end());
 		in.clear();
 		v.clear();
 	}
 
-	segmented_coordinate begin() { return segmented_coordinate(in.begin(), seg::begin(*in.begin())); }
-	segmented_coordinate end() { return segmented_coordinate(in.end(), seg::begin(*in.end())); }
-	header_iterator left() { return in.begin(); }
-	header_iterator right() { return --in.end(); }
+	void Insert(size_t at, size_t n) {
+		blocked_iterator it = in.insert(in.begin() + at, n);
 
-	size_t InitRandRange(size_t nm_segments) {
-		in.insert(in.begin(), static_cast<SizeType<index>>(nm_segments));
-		size_t s = create_rand_range(in.begin(), nm_segments);
-		v.resize(static_cast<SizeType<std::vector<value_type>>>(s));
-		seg::copy_seg_flat(begin(), end(), v.begin());
-		return s;
-	}
+		ASSERT_EQ(it - in.begin(), at) <<
+			"Inserted range is not placed into the right position";
 
-	void InitLeft(size_t _first_init_index, size_t _last_init_index) {
-		header_iterator it = in.insert(in.begin(), 1);
-		create_segment(*it, _first_init_index, _last_init_index);
-		v.insert(v.begin(), seg::begin(*it), seg::end(*it));
+		std::vector<area*> areas(n);
+		std::transform(it, it + n, areas.begin(), [](auto& h) { return seg::area(h); });
+		v.insert(v.begin() + at, areas.begin(), areas.end());
 	}
 
-	void InitRight(size_t _first_init_index, size_t _last_init_index) {
-		header_iterator it = in.insert(in.end(), 1);
-		create_segment(*it, _first_init_index, _last_init_index);
-		v.insert(v.end(), seg::begin(*it), seg::end(*it));
-	}
+	void Erase(size_t at, size_t n) {
+		blocked_iterator it = in.erase(in.begin() + at, in.begin() + (at + n));
 
-	void InitLeft(std::pair<size_t, size_t> p) {
-		InitLeft(p.first, p.second);
+		ASSERT_EQ(it - in.begin(), at) <<
+			"Erased range is not placed into the right position";
+
+		v.erase(v.begin() + at, v.begin() + (at + n));
 	}
 
-	void InitRight(std::pair<size_t, size_t> p) {
-		InitRight(p.first, p.second);
+	void CheckEqualHeaders() {
+		check_equal(
+			in.size(),
+			v.size(),
+			"Size of the index is smaller than it should be",
+			"Size of the index is larger than it should be");
+
+		ASSERT_TRUE(seg::area(*in.end()) == nullptr && seg::empty(*in.end())) <<
+			"Edge last header is not at the end of the index";
+
+		size_t i = 0;
+		for (blocked_iterator it = in.begin(); it != in.end(); ++it, ++i) {
+			ASSERT_EQ(seg::area(*it), v[i]) <<
+				"Headers are not in the right order";
+			ASSERT_EQ(it, in.begin() + i) <<
+				"Random access doesn't match the increment";
+			ASSERT_EQ(seg::area(*(in.end() - (v.size() - i))), v[i]) <<
+				"Random access from the end doesn't match the increment";
+		}
 	}
 };
 
-index TestSegmentRangeBase::in;
-std::vector<value_type> TestSegmentRangeBase::v;
-segmented_coordinate TestSegmentRangeBase::first_inserted;
-segmented_coordinate TestSegmentRangeBase::last_inserted;
-
-#endif 
+blocked_header_index<value_type, capacity, allocator, 4> TestBlockedIndex::in;
+std::vector<area*> TestBlockedIndex::v;
 
+TEST_F(TestBlockedIndex, InsertErase) {
+	for (int i = 0; i < 200; ++i) {
+		if (rand(2) || v.empty()) {
+			size_t n = rand(1) ? rand(3) : rand(20);
+			Insert(rand(v.size()), n);
+		}
+		else {
+			size_t n = rand(v.size() > 10 ? 10 : v.size());
+			Erase(rand(v.size() - n), n);
+		}
+		CheckEqualHeaders();
+	}
 
+	ASSERT_LE(in.blocks_size(), in.size() + 1) <<
+		"Empty blocks are not removed";
+}
 
-#ifdef INTERNAL_SEGMENTED_INSERT_TEST 
+TEST_F(TestBlockedIndex, Move) {
+	for (int i = 0; i < 10; ++i) Insert(rand(v.size()), 5);
+	blocked_iterator it = in.begin() + 20;
+	blocked_index moved(std::move(in));
+	ASSERT_EQ(it - moved.begin(), 20) <<
+		"Iterator is not valid after the index was moved";
+	for (size_t i = 20; it != moved.end(); ++it, ++i) {
+		ASSERT_EQ(seg::area(*it), v[i]) <<
+			"Iterator is not valid after the index was moved";
+		ASSERT_TRUE(it + static_cast<std::ptrdiff_t>(v.size() - i) == moved.end()) <<
+			"Random access is not valid after the index was moved";
+	}
+	in = std::move(moved);
+	CheckEqualHeaders();
+}
 
+#endif // INTERNAL_BLOCKED_INDEX_TEST
 
-struct TestSegmentInsert : public TestSegmentRangeBase
-{
-	void TestRangeInsertedCorrectly(
-		segmented_coordinate first,
-		segmented_coordinate last,
-		size_t insert_nm,
-		header_iterator first_balance,
-		header_iterator last_balance) {
 
-		first_inserted = first;
-		last_inserted = last;
-		test_correct_segment_and_range_size(in.begin(), in.end(), insert_nm + v.size());
-		test_per_segment_balance(first_balance, last_balance);
+#if defined(INTERNAL_GAPPED_INDEX_TEST) && defined(BIG_HEADER_TEST)
 
-		ASSERT_LE(first, last) <<
-			"First element of the inserted rage is after last";
+struct TestGappedIndex : public InternalTestBase
+{
+	using gapped_index = gapped_header_index<value_type, capacity, allocator>;
+	using gapped_iterator = Iterator<gapped_index>;
 
-		check_equal(
-			seg::distance(first, last),
-			insert_nm,
-			"Inserted range is smaller than it should be",
-			"Inserted range is larger than it should be");
+	static gapped_index in;
+	static std::vector<area*> v;
 
-		ASSERT_LE(begin(), first) <<
-			"First element of the inserted range is before the first element of the entire range";
-		ASSERT_GE(end(), last) <<
-			"Last element of the inserted range is after the last element of the entire range";
+	void TearDownSeg() override {
+		in.clear();
+		v.clear();
+	}
 
-		size_t left_size = seg::distance(begin(), first);
+	void Insert(size_t at, size_t n) {
+		gapped_iterator it = in.insert(in.begin() + at, n);
 
-		ASSERT_TRUE(seg::equal_flat_n_seg(v.begin(), left_size, begin(), first)) <<
-			"Left range is no longer the same";
+		ASSERT_EQ(it - in.begin(), at) <<
+			"Inserted range is not placed into the right position";
 
-		ASSERT_TRUE(seg::equal_flat_n_seg(flat::successor(v.begin(), left_size), static_cast<size_t>(v.size()) - left_size, last, end())) <<
-			"Right range is no longer the same";
+		std::vector<area*> areas(n);
+		std::transform(it, it + n, areas.begin(), [](auto& h) { return seg::area(h); });
+		v.insert(v.begin() + at, areas.begin(), areas.end());
 	}
 
-	void TestRangeInsertedCorrectly(
-		pair2<header_iterator, size_t> r,
-		size_t insert_nm,
-		header_iterator first_balance,
-		header_iterator last_balance) {
+	void Erase(size_t at, size_t n) {
+		gapped_iterator it = in.erase(in.begin() + at, in.begin() + (at + n));
 
-		segment_iterator fseg = segment_iterator(r.first.first);
-		segmented_coordinate first(fseg, std::begin(fseg) + r.first.second);
-		segment_iterator lseg = segment_iterator(r.second.first);
-		segmented_coordinate last(lseg, std::begin(lseg) + r.second.second);
+		ASSERT_EQ(it - in.begin(), at) <<
+			"Erased range is not placed into the right position";
 
-		TestRangeInsertedCorrectly(first, last, insert_nm, first_balance, last_balance);
+		v.erase(v.begin() + at, v.begin() + (at + n));
 	}
 
-	void TestRangeInsertedCorrectly(
-		pair2<header_iterator, size_t> r,
-		size_t insert_nm) {
-
-		TestRangeInsertedCorrectly(r, insert_nm, in.end(), in.end());
+	void CheckEqualHeaders() {
+		check_equal(
+			in.size(),
+			v.size(),
+			"Size of the index is smaller than it should be",
+			"Size of the index is larger than it should be");
+
+		ASSERT_TRUE(seg::area(*in.end()) == nullptr && seg::empty(*in.end())) <<
+			"Edge last header is not at the end of the index";
+
+		ASSERT_LE(in.headers_capacity(), std::max<size_t>(gapped_leaf_capacity, 16 * (in.size() + 1))) <<
+			"Array of headers is too sparse";
+
+		size_t i = 0;
+		for (gapped_iterator it = in.begin(); it != in.end(); ++it, ++i) {
+			ASSERT_EQ(seg::area(*it), v[i]) <<
+				"Headers are not in the right order";
+			ASSERT_EQ(it, in.begin() + i) <<
+				"Random access doesn't match the increment";
+			ASSERT_EQ(seg::area(*(in.end() - (v.size() - i))), v[i]) <<
+				"Random access from the end doesn't match the increment";
+		}
 	}
 };
 
-TEST_F(TestSegmentInsert, InsertCurrentAvailable)
-{
-	InitRandRange(1);
-	size_t left_size = seg::size(*left());
-	size_t insert_nm = rand(capacity - left_size);
-	size_t insert_at = rand(left_size);
+gapped_header_index<value_type, capacity, allocator> TestGappedIndex::in;
+std::vector<area*> TestGappedIndex::v;
 
-	TestRangeInsertedCorrectly(
-		seg::insert_current_available_aux(left(), insert_at, insert_nm),
-		insert_nm);
+TEST_F(TestGappedIndex, InsertErase) {
+	for (int i = 0; i < 400; ++i) {
+		if (rand(3) || v.empty()) {
+			size_t n = rand(1) ? rand(3) : rand(40);
+			Insert(rand(v.size()), n);
+		}
+		else {
+			size_t n = rand(v.size() > 30 ? 30 : v.size());
+			Erase(rand(v.size() - n), n);
+		}
+		CheckEqualHeaders();
+	}
+	while (!v.empty()) {
+		size_t n = rand(1, v.size() > 30 ? 30 : v.size());
+		Erase(rand(v.size() - n), n);
+		CheckEqualHeaders();
+	}
 }
 
-TEST_F(TestSegmentInsert, InsertBalanceLeftSimple)
-{
-	auto [left_first, left_last] = rand_begin_and_end_not_full_edge(capacity);
-	InitLeft(left_first, left_last);
-	auto [right_first, right_last] = rand_begin_and_end_not_full(capacity);
-	InitRight(right_first, right_last);
+TEST_F(TestGappedIndex, Move) {
+	for (int i = 0; i < 10; ++i) Insert(rand(v.size()), 5);
+	gapped_iterator it = in.begin() + 20;
+	gapped_index moved(std::move(in));
+	ASSERT_EQ(it - moved.begin(), 20) <<
+		"Iterator is not valid after the index was moved";
+	for (size_t i = 20; it != moved.end(); ++it, ++i) {
+		ASSERT_EQ(seg::area(*it), v[i]) <<
+			"Iterator is not valid after the index was moved";
+		ASSERT_TRUE(it + static_cast<std::ptrdiff_t>(v.size() - i) == moved.end()) <<
+			"Random access is not valid after the index was moved";
+	}
+	in = std::move(moved);
+	CheckEqualHeaders();
+}
 
-	size_t left_size = left_last - left_first;
-	size_t right_size = right_last - right_first;
-	size_t insert_at = rand(right_size);
-	size_t available_right = capacity - right_size;
-	size_t insert_nm = rand(available_right + 1, available_right + (capacity - left_size));
+#endif // INTERNAL_GAPPED_INDEX_TEST
 
-	TestRangeInsertedCorrectly(
-		seg::insert_balance_left_simple(right(), left(), (seg::size(*left()) + seg::size(*right()) + insert_nm) >> 1, insert_at, insert_nm),
-		insert_nm);
-}
 
-TEST_F(TestSegmentInsert, InsertBalanceRightSimple)
+#if defined(INTERNAL_MAPPED_INDEX_TEST) && defined(BIG_HEADER_TEST)
+
+struct TestMappedIndex : public InternalTestBase
 {
-	auto [left_first, left_last] = rand_begin_and_end_not_full(capacity);
-	InitLeft(left_first, left_last);
-	auto [right_first, right_last] = rand_begin_and_end_not_full_edge(capacity);
-	InitRight(right_first, right_last);
+	using mapped_index = big_header_index<value_type, capacity, allocator, mapped_array<header>>;
+	using mapped_iterator = Iterator<mapped_index>;
 
-	size_t left_size = left_last - left_first;
-	size_t right_size = right_last - right_first;
-	size_t insert_at = rand(left_size);
-	size_t available_left = capacity - left_size;
-	size_t insert_nm = rand(available_left + 1, available_left + (capacity - right_size));
+	static mapped_index in;
+	static std::vector<area*> v;
 
-	TestRangeInsertedCorrectly(
-		seg::insert_balance_right_simple(left(), right(), (seg::size(*left()) + seg::size(*right()) + insert_nm) >> 1, insert_at, insert_nm),
-		insert_nm);
-}
+	void TearDownSeg() override {
+		in.clear();
+		v.clear();
+	}
 
-TEST_F(TestSegmentInsert, InsertBalanceLeftIncreaseEmpty)
-{
-	auto [right_first, right_last] = rand_begin_and_end_not_full(capacity);
-	InitRight(right_first, right_last);
-	size_t nm_used_segments = rand(2, 10);
-	size_t right_size = right_last - right_first;
-	size_t max_size = capacity * nm_used_segments;
-	size_t min_size = ((nm_used_segments - 1) * capacity) + 1;
-	size_t size = rand(min_size, max_size);
-	size_t insert_nm = size - right_size;
+	void Insert(size_t at, size_t n) {
+		mapped_iterator it = in.insert(in.begin() + at, n);
 
-	auto [nm_segments, m, s] = seg::segment_range_info(capacity, 0, seg::size(*right()), insert_nm);
-	header_iterator first = in.insert(right(), nm_segments - 1);
-	std::pair<header_iterator, size_t> p = seg::insert_balance_left_increase_empty(first, right(), m, s, insert_nm);
-	segment_iterator it(p.first);
+		ASSERT_EQ(it - in.begin(), at) <<
+			"Inserted range is not placed into the right position";
 
-	TestRangeInsertedCorrectly(
-		begin(), 
-		segmented_coordinate(it, std::begin(it) + p.second), 
-		insert_nm,
-		left(), 
-		right());
-}
+		std::vector<area*> areas(n);
+		std::transform(it, it + n, areas.begin(), [](auto& h) { return seg::area(h); });
+		v.insert(v.begin() + at, areas.begin(), areas.end());
+	}
 
-TEST_F(TestSegmentInsert, InsertBalanceLeftIncrease)
-{
-	auto [right_first, right_last] = rand_begin_and_end_not_full(capacity);
-	InitRight(right_first, right_last);
-	size_t nm_used_segments = rand(2, 10);
-	size_t right_size = right_last - right_first;
-	size_t max_size = capacity * nm_used_segments;
-	size_t min_size = ((nm_used_segments - 1) * capacity) + 1;
-	size_t size = rand(min_size, max_size);
-	size_t insert_nm = size - right_size;
-	size_t insert_at = rand(right_size);
+	void Erase(size_t at, size_t n) {
+		mapped_iterator it = in.erase(in.begin() + at, in.begin() + (at + n));
 
-	auto [nm_segments, m, s] = seg::segment_range_info(capacity, 0, seg::size(*right()), insert_nm);
-	size_t left_final_size = m > 0 ? s + 1 : s;
-	size_t left_size = rand(1, left_final_size - 1);
-	if (left_size >= insert_nm) 
-		left_size = insert_nm >> 1;
-	insert_nm = insert_nm - left_size;
-	size_t left_first = balanced_begin(capacity, left_final_size);
-	InitLeft(left_first, left_first + left_size);
+		ASSERT_EQ(it - in.begin(), at) <<
+			"Erased range is not placed into the right position";
 
-	in.insert(right(), nm_segments - 2);
-	TestRangeInsertedCorrectly(
-		seg::insert_balance_left_increase(left(), right(), m, s, insert_at, insert_nm),
-		insert_nm,
-		left(),
-		right());
-}
+		v.erase(v.begin() + at, v.begin() + (at + n));
+	}
 
-TEST_F(TestSegmentInsert, InsertBalanceLeft)
-{
-	auto [right_first, right_last] = rand_begin_and_end_not_full(capacity);
-	InitRight(right_first, right_last);
+	void CheckEqualHeaders() {
+		check_equal(
+			in.size(),
+			v.size(),
+			"Size of the index is smaller than it should be",
+			"Size of the index is larger than it should be");
+
+		ASSERT_TRUE(seg::area(*in.end()) == nullptr && seg::empty(*in.end())) <<
+			"Edge last header is not at the end of the index";
+
+		size_t i = 0;
+		for (mapped_iterator it = in.begin(); it != in.end(); ++it, ++i) {
+			ASSERT_EQ(seg::area(*it), v[i]) <<
+				"Headers are not in the right order";
+			ASSERT_EQ(it, in.begin() + i) <<
+				"Random access doesn't match the increment";
+			ASSERT_EQ(seg::area(*(in.end() - (v.size() - i))), v[i]) <<
+				"Random access from the end doesn't match the increment";
+		}
+	}
+};
 
-	auto [left_first, left_last] = rand_begin_and_end_not_full_edge(capacity);
-	InitLeft(left_first, left_last);
+big_header_index<value_type, capacity, allocator, mapped_array<header>> TestMappedIndex::in;
+std::vector<area*> TestMappedIndex::v;
 
-	size_t right_size = right_last - right_first;
-	size_t left_size = left_last - left_first;
-	size_t init_size = right_size + left_size;
-	size_t left_available = capacity - left_size;
-	size_t right_available = capacity - right_size;
-	size_t nm_used_segments = rand(2, 10);
-	size_t max_size = (capacity * nm_used_segments);
-	size_t min_size = (nm_used_segments - 1) * capacity + 1;
-	size_t size = rand(min_size, max_size);
-	if (size < init_size) {
-		size = init_size + right_available + (left_available >> 1);
+TEST_F(TestMappedIndex, InsertErase) {
+	for (int i = 0; i < 1000; ++i) {
+		if (rand(3) || v.empty()) {
+			size_t n = rand(1) ? rand(3) : rand(40);
+			Insert(rand(v.size()), n);
+		}
+		else {
+			size_t n = rand(v.size() > 30 ? 30 : v.size());
+			Erase(rand(v.size() - n), n);
+		}
+		CheckEqualHeaders();
 	}
-	size_t insert_nm = size - (left_size + right_size);
-	if (insert_nm <= right_available) {
-		insert_nm = right_available + (left_available >> 1);
+	while (!v.empty()) {
+		size_t n = rand(1, v.size() > 30 ? 30 : v.size());
+		Erase(rand(v.size() - n), n);
+		CheckEqualHeaders();
 	}
-	size_t insert_at = rand(right_size);
+}
 
-	auto [nm_segments, m, s] = seg::segment_range_info(capacity, seg::size(*left()), seg::size(*right()), insert_nm);
-	header_iterator first = in.insert(right(), nm_segments - 2);
+#endif // INTERNAL_MAPPED_INDEX_TEST
 
-	size_t _insert_at = insert_at;
-	size_t _insert_nm = insert_nm;
+
+#if defined(INTERNAL_GROWING_INDEX_TEST) && defined(BIG_HEADER_TEST)
+
+struct TestGrowingIndex : public InternalTestBase
+{
+	using growing_index = growing_header_index<value_type, capacity, allocator>;
+	using growing_iterator = Iterator<growing_index>;
+
+	static growing_index in;
+	static std::vector<area*> v;
+	static size_t growing_checks;
+
+	void TearDownSeg() override {
+		in.clear();
+		v.clear();
+	}
+
+	void Insert(size_t at, size_t n) {
+		growing_iterator it = in.insert(in.begin() + at, n);
+
+		ASSERT_EQ(it - in.begin(), at) <<
+			"Inserted range is not placed into the right position";
+
+		std::vector<area*> areas(n);
+		std::transform(it, it + n, areas.begin(), [](auto& h) { return seg::area(h); });
+		v.insert(v.begin() + at, areas.begin(), areas.end());
+	}
+
+	void Erase(size_t at, size_t n) {
+		growing_iterator it = in.erase(in.begin() + at, in.begin() + (at + n));
+
+		ASSERT_EQ(it - in.begin(), at) <<
+			"Erased range is not placed into the right position";
+
+		v.erase(v.begin() + at, v.begin() + (at + n));
+	}
+
+	void CheckEqualHeaders() {
+		check_equal(
+			in.size(),
+			v.size(),
+			"Size of the index is smaller than it should be",
+			"Size of the index is larger than it should be");
+
+		ASSERT_TRUE(seg::area(*in.end()) == nullptr && seg::empty(*in.end())) <<
+			"Edge last header is not at the end of the index";
+
+		size_t i = 0;
+		for (growing_iterator it = in.begin(); it != in.end(); ++it, ++i) {
+			ASSERT_EQ(seg::area(*it), v[i]) <<
+				"Headers are not in the right order";
+			ASSERT_EQ(it, in.begin() + i) <<
+				"Random access doesn't match the increment";
+			ASSERT_EQ(seg::area(*(in.end() - (v.size() - i))), v[i]) <<
+				"Random access from the end doesn't match the increment";
+			ASSERT_EQ(in.end() - it, v.size() - i) <<
+				"Distance to the end doesn't match the increment";
+		}
+		if (in.growing()) ++growing_checks;
+	}
+};
+
+growing_header_index<value_type, capacity, allocator> TestGrowingIndex::in;
+std::vector<area*> TestGrowingIndex::v;
+size_t TestGrowingIndex::growing_checks = 0;
+
+TEST_F(TestGrowingIndex, InsertErase) {
+	for (int i = 0; i < 400; ++i) {
+		if (rand(3) || v.empty()) {
+			size_t n = rand(1) ? rand(3) : rand(40);
+			Insert(rand(v.size()), n);
+		}
+		else {
+			size_t n = rand(v.size() > 30 ? 30 : v.size());
+			Erase(rand(v.size() - n), n);
+		}
+		CheckEqualHeaders();
+	}
+	while (!v.empty()) {
+		size_t n = rand(1, v.size() > 30 ? 30 : v.size());
+		Erase(rand(v.size() - n), n);
+		CheckEqualHeaders();
+	}
+	ASSERT_GT(growing_checks, 0) <<
+		"Headers were never held by both buffers";
+}
+
+TEST_F(TestGrowingIndex, Move) {
+	for (int i = 0; i < 10; ++i) Insert(rand(v.size()), 5);
+	// Index is moved while its headers are held by both buffers
+	while (!in.growing()) Insert(rand(v.size()), 1);
+	growing_iterator it = in.begin() + 20;
+	growing_index moved(std::move(in));
+	ASSERT_EQ(it - moved.begin(), 20) <<
+		"Iterator is not valid after the index was moved";
+	for (size_t i = 20; it != moved.end(); ++it, ++i) {
+		ASSERT_EQ(seg::area(*it), v[i]) <<
+			"Iterator is not valid after the index was moved";
+		ASSERT_TRUE(it + static_cast<std::ptrdiff_t>(v.size() - i) == moved.end()) <<
+			"Random access is not valid after the index was moved";
+	}
+	in = std::move(moved);
+	CheckEqualHeaders();
+}
+
+#endif // INTERNAL_GROWING_INDEX_TEST
+
+
+#ifdef INTERNAL_COUNTED_INDEX_TEST
+
+using counted_multiset = seg::multiset_tmp<
+	value_type, 
+	std::less<value_type>, 
+	seg::list_tmp<value_type, counted_index<index>>, 
+	flat::find_adaptor_linear, 
+	flat::equal_range_adaptor_linear>;
+
+struct TestCountedIndex : public InternalTestBase
+{
+	static counted_multiset set;
+	static std::vector<value_type> v;
+
+	void TearDownSeg() override {
+		set.clear();
+		v.clear();
+	}
+
+	void InsertRand(size_t n) {
+		while (n) {
+			value_type x = value_type(static_cast<int>(rand(1000)));
+			set.insert(x);
+			v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+			--n;
+		}
+	}
+
+	void EraseRand(size_t n) {
+		size_t i = rand(v.size() - n);
+		set.erase(set.nth(i), set.nth(i + n));
+		v.erase(v.begin() + i, v.begin() + (i + n));
+	}
+
+	void CheckOrderStatistics() {
+		ASSERT_EQ(set.size(), v.size()) <<
+			"Size of the set is not correct";
+
+		ASSERT_TRUE(set.nth(set.size()) == set.end()) <<
+			"Element after the last one is not at the end";
+
+		segmented_coordinate it = set.begin();
+		for (size_t i = 0; i < v.size(); ++i, ++it) {
+			ASSERT_TRUE(set.nth(i) == it) <<
+				"N-th element is not in the right position";
+			ASSERT_EQ(*set.nth(i), v[i]) <<
+				"N-th element is not correct";
+			ASSERT_EQ(set.rank(it), i) <<
+				"Rank of the element is not correct";
+		}
+
+		for (int i = 0; i < 20 && !v.empty(); ++i) {
+			size_t first = rand(v.size());
+			size_t last = rand(first, v.size());
+			ASSERT_TRUE(set.successor(set.nth(first), last - first) == set.nth(last)) <<
+				"Successor is not in the right position";
+			ASSERT_TRUE(set.predecessor(set.nth(last), last - first) == set.nth(first)) <<
+				"Predecessor is not in the right position";
+			ASSERT_EQ(set.distance(set.nth(first), set.nth(last)), static_cast<std::ptrdiff_t>(last - first)) <<
+				"Distance is not correct";
+		}
+	}
+};
+
+counted_multiset TestCountedIndex::set;
+std::vector<value_type> TestCountedIndex::v;
+
+TEST_F(TestCountedIndex, OrderStatistics) {
+	for (int i = 0; i < 50; ++i) {
+		InsertRand(rand(300));
+		CheckOrderStatistics();
+		EraseRand(rand(v.size()));
+		CheckOrderStatistics();
+	}
+}
+
+TEST_F(TestCountedIndex, Batches) {
+	// Sizes are kept up to date by the paths which insert or erase many segments at once
+	for (int i = 0; i < 20; ++i) {
+		std::vector<value_type> b;
+		for (size_t j = rand(2000); j; --j) b.push_back(value_type(static_cast<int>(rand(1000))));
+		if (i % 5 == 0) {
+			std::sort(b.begin(), b.end());
+			set.assign_sorted(b.begin(), b.size(), 0.5 + 0.1 * rand(6));
+			v = b;
+		}
+		else {
+			set.insert_batch(b.begin(), b.size());
+			for (value_type x : b) v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+		}
+		CheckOrderStatistics();
+		EraseRand(rand(v.size()));
+		CheckOrderStatistics();
+	}
+}
+
+TEST_F(TestCountedIndex, CountTree) {
+	// Tree follows a vector of sizes through insertions and erasures of many segments, growing and shrinking in height
+	segment_count_tree t;
+	std::vector<size_t> s;
+	for (int i = 0; i < 300; ++i) {
+		size_t p = rand(s.size());
+		size_t n = rand(i % 4 ? 300 : 3000);
+		t.insert(p, n);
+		s.insert(s.begin() + p, n, 0);
+		for (size_t j = 0; j < n; ++j) {
+			s[p + j] = rand(capacity);
+			t.set(p + j, s[p + j]);
+		}
+		p = rand(s.size());
+		n = i % 100 == 99 ? s.size() - p : rand(std::min(s.size() - p, size_t(i % 5 ? 200 : 5000)));
+		t.erase(p, n);
+		s.erase(s.begin() + p, s.begin() + (p + n));
+		for (size_t j = 0; j < 50 && !s.empty(); ++j) {
+			p = rand(s.size() - 1);
+			s[p] = rand(capacity);
+			t.set(p, s[p]);
+		}
+
+		std::vector<size_t> prefixes(1, 0);
+		for (size_t x : s) prefixes.push_back(prefixes.back() + x);
+		for (p = 0; p <= s.size(); ++p) {
+			ASSERT_EQ(t.prefix(p), prefixes[p]) <<
+				"Number of elements before the segment is not correct";
+		}
+		for (size_t j = 0; j < 200; ++j) {
+			size_t e = rand(prefixes.back());
+			size_t q = static_cast<size_t>(std::upper_bound(prefixes.begin(), prefixes.end(), e) - prefixes.begin()) - 1;
+			ASSERT_EQ(t.locate(e), std::make_pair(q, e - prefixes[q])) <<
+				"Segment holding the element is not correct";
+		}
+	}
+}
+
+TEST_F(TestCountedIndex, WalkingFallback) {
+	// Without a counted index the queries walk over the segments
+	multiset m;
+	segmented_list l;
+	for (size_t n = 0; n < 2000; ++n) {
+		value_type x = value_type(static_cast<int>(rand(1000)));
+		m.insert(x);
+		l.insert(l.end(), x);
+		v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+	}
+	for (int i = 0; i < 200; ++i) {
+		size_t first = rand(v.size());
+		size_t last = rand(first, v.size());
+		ASSERT_TRUE(m.predecessor(m.nth(last), last - first) == m.nth(first)) <<
+			"Predecessor in the multiset is not in the right position";
+		ASSERT_TRUE(m.successor(m.nth(first), last - first) == m.nth(last)) <<
+			"Successor in the multiset is not in the right position";
+		ASSERT_EQ(m.rank(m.nth(last)), last) <<
+			"Rank in the multiset is not correct";
+		ASSERT_TRUE(l.predecessor(l.nth(last), last - first) == l.nth(first)) <<
+			"Predecessor in the list is not in the right position";
+		ASSERT_EQ(l.distance(l.nth(first), l.nth(last)), static_cast<std::ptrdiff_t>(last - first)) <<
+			"Distance in the list is not correct";
+	}
+	ASSERT_TRUE(m.predecessor(m.end(), v.size()) == m.begin()) <<
+		"Predecessor of the end is not at the beginning";
+}
+
+#endif // INTERNAL_COUNTED_INDEX_TEST
+
+
+#ifdef INTERNAL_FENCED_INDEX_TEST
+
+using fenced_multiset = seg::multiset_tmp<
+	value_type, 
+	std::less<value_type>, 
+	seg::list_tmp<value_type, fenced_index<index, seg::set_value_to_key>>, 
+	flat::find_adaptor_linear, 
+	flat::equal_range_adaptor_linear>;
+
+struct TestFencedIndex : public InternalTestBase
+{
+	static fenced_multiset set;
+	static std::vector<value_type> v;
+
+	void TearDownSeg() override {
+		set.clear();
+		v.clear();
+	}
+
+	void InsertRand(size_t n) {
+		while (n) {
+			value_type x = value_type(static_cast<int>(rand(1000)));
+			set.insert(x);
+			v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+			--n;
+		}
+	}
+
+	void EraseRand(size_t n) {
+		size_t i = rand(v.size() - n);
+		set.erase(seg::successor(set.begin(), i), seg::successor(set.begin(), i + n));
+		v.erase(v.begin() + i, v.begin() + (i + n));
+	}
+
+	void CheckFences() {
+		const auto& fences = set.segment_index().fences();
+		auto first = seg::segment(set.begin());
+		auto last = seg::segment(set.end());
+		ASSERT_EQ(static_cast<std::ptrdiff_t>(fences.size()), last - first) <<
+			"Number of fence keys is not equal to the number of segments";
+
+		for (size_t i = 0; first != last; ++first, ++i) {
+			ASSERT_EQ(fences[i], *flat::predecessor(std::end(first), 1)) <<
+				"Fence key is not the last key of its segment";
+		}
+	}
+
+	void CheckBounds() {
+		ASSERT_EQ(set.size(), v.size()) <<
+			"Size of the set is not correct";
+
+		for (int k = -1; k <= 1001; ++k) {
+			value_type x = value_type(k);
+			std::ptrdiff_t l = std::lower_bound(v.begin(), v.end(), x) - v.begin();
+			std::ptrdiff_t u = std::upper_bound(v.begin(), v.end(), x) - v.begin();
+			ASSERT_EQ(seg::distance(set.begin(), set.lower_bound(x)), l) <<
+				"Lower bound is not in the right position";
+			ASSERT_EQ(seg::distance(set.begin(), set.upper_bound(x)), u) <<
+				"Upper bound is not in the right position";
+
+			auto r = set.equal_range(x);
+			ASSERT_TRUE(r.first == set.lower_bound(x) && r.second == set.upper_bound(x)) <<
+				"Equal range is not correct";
+		}
+	}
+};
+
+fenced_multiset TestFencedIndex::set;
+std::vector<value_type> TestFencedIndex::v;
+
+TEST_F(TestFencedIndex, Bounds) {
+	for (int i = 0; i < 30; ++i) {
+		InsertRand(rand(300));
+		CheckFences();
+		CheckBounds();
+		EraseRand(rand(v.size()));
+		CheckFences();
+		CheckBounds();
+	}
+}
+
+TEST_F(TestFencedIndex, SelfAssignment) {
+	InsertRand(500);
+	using index_type = std::decay_t<decltype(set.segment_index())>;
+	index_type& in = const_cast<index_type&>(set.segment_index());
+	index_type& same = in;
+	in = same;
+	CheckFences();
+	CheckBounds();
+	in = std::move(same);
+	CheckFences();
+	CheckBounds();
+}
+
+#endif // INTERNAL_FENCED_INDEX_TEST
+
+
+// Learned locator predicts positions from arithmetic keys
+#if defined(INTERNAL_LEARNED_INDEX_TEST) && defined(SEG_POD_TEST)
+
+using learned_multiset = seg::multiset_tmp<
+	value_type, 
+	std::less<value_type>, 
+	seg::list_tmp<value_type, fenced_index<index, seg::set_value_to_key, seg::learned_fence_locator<4>>>, 
+	flat::find_adaptor_linear, 
+	flat::equal_range_adaptor_linear>;
+
+struct TestLearnedIndex : public InternalTestBase
+{
+	static learned_multiset set;
+	static std::vector<value_type> v;
+
+	void TearDownSeg() override {
+		set.clear();
+		v.clear();
+	}
+
+	void InsertRand(size_t n) {
+		while (n) {
+			value_type x = value_type(static_cast<int>(rand(1000)));
+			set.insert(x);
+			v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+			--n;
+		}
+	}
+
+	void EraseRand(size_t n) {
+		size_t i = rand(v.size() - n);
+		set.erase(seg::successor(set.begin(), i), seg::successor(set.begin(), i + n));
+		v.erase(v.begin() + i, v.begin() + (i + n));
+	}
+
+	void CheckFences() {
+		const auto& fences = set.segment_index().fences();
+		auto first = seg::segment(set.begin());
+		auto last = seg::segment(set.end());
+		ASSERT_EQ(static_cast<std::ptrdiff_t>(fences.size()), last - first) <<
+			"Number of fence keys is not equal to the number of segments";
+
+		for (size_t i = 0; first != last; ++first, ++i) {
+			ASSERT_EQ(fences[i], *flat::predecessor(std::end(first), 1)) <<
+				"Fence key is not the last key of its segment";
+		}
+
+		const auto& locator = set.segment_index().locator;
+		ASSERT_TRUE(fences.empty() || (locator.built && locator.changes <= locator.max_error)) <<
+			"Model was not rebuilt by the insertion or erasure";
+	}
+
+	void CheckBounds() {
+		ASSERT_EQ(set.size(), v.size()) <<
+			"Size of the set is not correct";
+
+		for (int k = -1; k <= 1001; ++k) {
+			value_type x = value_type(k);
+			std::ptrdiff_t l = std::lower_bound(v.begin(), v.end(), x) - v.begin();
+			std::ptrdiff_t u = std::upper_bound(v.begin(), v.end(), x) - v.begin();
+			ASSERT_EQ(seg::distance(set.begin(), set.lower_bound(x)), l) <<
+				"Lower bound is not in the right position";
+			ASSERT_EQ(seg::distance(set.begin(), set.upper_bound(x)), u) <<
+				"Upper bound is not in the right position";
+
+			auto r = set.equal_range(x);
+			ASSERT_TRUE(r.first == set.lower_bound(x) && r.second == set.upper_bound(x)) <<
+				"Equal range is not correct";
+		}
+	}
+};
+
+learned_multiset TestLearnedIndex::set;
+std::vector<value_type> TestLearnedIndex::v;
+
+TEST_F(TestLearnedIndex, Bounds) {
+	for (int i = 0; i < 30; ++i) {
+		InsertRand(rand(300));
+		CheckFences();
+		CheckBounds();
+		EraseRand(rand(v.size()));
+		CheckFences();
+		CheckBounds();
+	}
+}
+
+TEST_F(TestLearnedIndex, SkewedKeys) {
+	for (int i = 0; i < 3000; ++i) {
+		value_type x = value_type(i < 2000 ? i / 8 : 250 + (i - 2000) * (i - 2000) / 1500);
+		set.insert(x);
+		v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+	}
+	CheckFences();
+	CheckBounds();
+	for (int i = 0; i < 10; ++i) {
+		InsertRand(rand(100));
+		EraseRand(rand(100));
+		CheckBounds();
+	}
+}
+
+#endif // INTERNAL_LEARNED_INDEX_TEST && SEG_POD_TEST
+
+#if defined(INTERNAL_SAMPLED_INDEX_TEST) && defined(SEG_POD_TEST)
+
+using sampled_multiset = seg::multiset_tmp<
+	value_type,
+	std::less<value_type>,
+	seg::list_tmp<value_type, seg::sampled_index<index, seg::set_value_to_key, 8>>,
+	flat::find_adaptor_linear,
+	flat::equal_range_adaptor_linear>;
+
+using sampled_fenced_multiset = seg::multiset_tmp<
+	value_type,
+	std::less<value_type>,
+	seg::list_tmp<value_type, seg::sampled_index<fenced_index<index, seg::set_value_to_key>, seg::set_value_to_key, 8>>,
+	flat::find_adaptor_linear,
+	flat::equal_range_adaptor_linear>;
+
+struct TestSampledIndex : public InternalTestBase
+{
+	static std::vector<value_type> v;
+
+	void TearDownSeg() override {
+		v.clear();
+	}
+
+	template<typename S>
+	void InsertRand(S& set, size_t n) {
+		while (n) {
+			value_type x = value_type(static_cast<int>(rand(1000)));
+			set.insert(x);
+			v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+			--n;
+		}
+	}
+
+	template<typename S>
+	void EraseRand(S& set, size_t n) {
+		size_t i = rand(v.size() - n);
+		set.erase(seg::successor(set.begin(), i), seg::successor(set.begin(), i + n));
+		v.erase(v.begin() + i, v.begin() + (i + n));
+	}
+
+	template<typename S>
+	void CheckSamples(const S& set) {
+		const auto& in = set.segment_index();
+		constexpr size_t stride = std::decay_t<decltype(in)>::sample_stride;
+		constexpr size_t segment_samples = std::decay_t<decltype(in)>::segment_samples;
+		size_t j = 0;
+		for (auto it = in.begin(); it != in.end(); ++it, ++j) {
+			for (size_t i = 0; i < seg::size(*it) / stride; ++i) {
+				ASSERT_EQ(in._samples[j * segment_samples + i], seg::begin(*it)[(i + 1) * stride - 1]) <<
+					"Sample is not the key of its element";
+			}
+		}
+	}
+
+	template<typename S>
+	void CheckBounds(const S& set) {
+		ASSERT_EQ(set.size(), v.size()) <<
+			"Size of the set is not correct";
+
+		for (int k = -1; k <= 1001; ++k) {
+			value_type x = value_type(k);
+			std::ptrdiff_t l = std::lower_bound(v.begin(), v.end(), x) - v.begin();
+			std::ptrdiff_t u = std::upper_bound(v.begin(), v.end(), x) - v.begin();
+			ASSERT_EQ(seg::distance(set.begin(), set.lower_bound(x)), l) <<
+				"Lower bound is not in the right position";
+			ASSERT_EQ(seg::distance(set.begin(), set.upper_bound(x)), u) <<
+				"Upper bound is not in the right position";
+
+			auto r = set.equal_range(x);
+			ASSERT_TRUE(r.first == set.lower_bound(x) && r.second == set.upper_bound(x)) <<
+				"Equal range is not correct";
+		}
+	}
+
+	template<typename S>
+	void CheckSet() {
+		S set;
+		for (int i = 0; i < 20; ++i) {
+			InsertRand(set, rand(300));
+			CheckSamples(set);
+			CheckBounds(set);
+			EraseRand(set, rand(v.size()));
+			CheckSamples(set);
+			CheckBounds(set);
+		}
+		S copy(set);
+		CheckBounds(copy);
+
+		using index_type = std::decay_t<decltype(set.segment_index())>;
+		index_type& in = const_cast<index_type&>(set.segment_index());
+		index_type& same = in;
+		in = same;
+		CheckSamples(set);
+		CheckBounds(set);
+		in = std::move(same);
+		CheckSamples(set);
+		CheckBounds(set);
+
+		set.clear();
+		v.clear();
+		CheckBounds(set);
+	}
+};
+
+std::vector<value_type> TestSampledIndex::v;
+
+TEST_F(TestSampledIndex, Bounds) {
+	CheckSet<sampled_multiset>();
+}
+
+TEST_F(TestSampledIndex, Fenced) {
+	CheckSet<sampled_fenced_multiset>();
+}
+
+#endif // INTERNAL_SAMPLED_INDEX_TEST && SEG_POD_TEST
+
+#if defined(INTERNAL_HASHED_INDEX_TEST) && defined(SEG_POD_TEST)
+
+using hashed_multiset = seg::multiset_tmp<
+	value_type,
+	std::less<value_type>,
+	seg::list_tmp<value_type, seg::hashed_index<index, seg::set_value_to_key>>,
+	flat::find_adaptor_linear,
+	flat::equal_range_adaptor_linear>;
+
+using hashed_fenced_multiset = seg::multiset_tmp<
+	value_type,
+	std::less<value_type>,
+	seg::list_tmp<value_type, seg::hashed_index<fenced_index<index, seg::set_value_to_key>, seg::set_value_to_key>>,
+	flat::find_adaptor_linear,
+	flat::equal_range_adaptor_linear>;
+
+struct TestHashedIndex : public InternalTestBase
+{
+	static std::vector<value_type> v;
+
+	void TearDownSeg() override {
+		v.clear();
+	}
+
+	template<typename S>
+	void InsertRand(S& set, size_t n) {
+		while (n) {
+			value_type x = value_type(static_cast<int>(rand(100)));
+			set.insert(x);
+			v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+			--n;
+		}
+	}
+
+	template<typename S>
+	void EraseRand(S& set, size_t n) {
+		size_t i = rand(v.size() - n);
+		set.erase(seg::successor(set.begin(), i), seg::successor(set.begin(), i + n));
+		v.erase(v.begin() + i, v.begin() + (i + n));
+	}
+
+	template<typename S>
+	void CheckEqualRanges(const S& set) {
+		ASSERT_EQ(set.size(), v.size()) <<
+			"Size of the set is not correct";
+
+		for (int k = -1; k <= 101; ++k) {
+			value_type x = value_type(k);
+			auto r = set.equal_range(x);
+			ASSERT_EQ(seg::distance(set.begin(), r.first), std::lower_bound(v.begin(), v.end(), x) - v.begin()) <<
+				"Start of the equal range is not in the right position";
+			ASSERT_EQ(seg::distance(set.begin(), r.second), std::upper_bound(v.begin(), v.end(), x) - v.begin()) <<
+				"End of the equal range is not in the right position";
+		}
+	}
+
+	template<typename S>
+	void CheckSet() {
+		S set;
+		for (int i = 0; i < 20; ++i) {
+			InsertRand(set, rand(300));
+			CheckEqualRanges(set);
+			EraseRand(set, rand(v.size()));
+			CheckEqualRanges(set);
+			InsertRand(set, rand(3));
+			CheckEqualRanges(set);
+		}
+		using index_type = std::decay_t<decltype(set.segment_index())>;
+		index_type& in = const_cast<index_type&>(set.segment_index());
+		index_type& same = in;
+		in = same;
+		in = std::move(same);
+		CheckEqualRanges(set);
+		S copy(set);
+		CheckEqualRanges(copy);
+		S moved(std::move(copy));
+		CheckEqualRanges(moved);
+		set.clear();
+		v.clear();
+		CheckEqualRanges(set);
+	}
+};
+
+std::vector<value_type> TestHashedIndex::v;
+
+TEST_F(TestHashedIndex, EqualRange) {
+	CheckSet<hashed_multiset>();
+}
+
+TEST_F(TestHashedIndex, Fenced) {
+	CheckSet<hashed_fenced_multiset>();
+}
+
+TEST_F(TestHashedIndex, Collisions) {
+	// Every key has one of three hashes, so the table names the wrong segment for most of them
+	struct three_hashes
+	{
+		size_t operator()(value_type x) const { return std::hash<value_type>()(x % 3); }
+	};
+	using colliding_multiset = seg::multiset_tmp<
+		value_type,
+		std::less<value_type>,
+		seg::list_tmp<value_type, seg::hashed_index<index, seg::set_value_to_key, three_hashes>>,
+		flat::find_adaptor_linear,
+		flat::equal_range_adaptor_linear>;
+	CheckSet<colliding_multiset>();
+}
+
+TEST_F(TestHashedIndex, MovedKeys) {
+	// Only inserted keys and keys which moved to another segment are entered, yet the table names the segment of every key,
+	// except of the few keys whose slots were taken by other keys with the same 16 bits of the hash
+	hashed_multiset set;
+	std::vector<value_type> keys(5000);
+	std::iota(keys.begin(), keys.end(), value_type(0));
+	std::shuffle(keys.begin(), keys.end(), rand_engine);
+	for (size_t i = 0; i < keys.size(); ++i) {
+		set.insert(keys[i]);
+		if (i % 3 == 0) {
+			value_type x = keys[rand(i)];
+			auto it = set.lower_bound(x);
+			if (it != set.end() && *it == x) set.erase(it);
+		}
+		if (i % 100 == 99) {
+			size_t f = rand(set.size());
+			size_t l = rand(f, std::min(set.size(), f + 300));
+			set.erase(seg::successor(set.begin(), f), seg::successor(set.begin(), l));
+		}
+		if (i % 50 == 49) {
+			const auto& in = set.segment_index();
+			size_t j = 0;
+			size_t misses = 0;
+			for (auto h = std::begin(in); h != std::end(in); ++h, ++j) {
+				for (auto f = seg::begin(*h); f != seg::end(*h); ++f) {
+					if (in.hashed_segment(*f) != j) ++misses;
+				}
+			}
+			ASSERT_LE(misses, set.size() / 100) <<
+				"Table doesn't name the segments which hold the keys";
+		}
+	}
+}
+
+TEST_F(TestHashedIndex, Positions) {
+	// Keys are only appended, so nothing is inserted in front of a key in its segment, and the table knows where every
+	// key is, even after the segments were split and their elements moved to the neighbours
+	hashed_multiset set;
+	for (int i = 0; i < 5000; ++i) {
+		set.insert(value_type(i));
+		if (i % 50 == 49) {
+			const auto& in = set.segment_index();
+			size_t j = 0;
+			size_t misses = 0;
+			for (auto h = std::begin(in); h != std::end(in); ++h, ++j) {
+				for (auto f = seg::begin(*h); f != seg::end(*h); ++f) {
+					if (in.hashed_position(*f) != std::make_pair(j, static_cast<size_t>(f - seg::begin(*h)))) ++misses;
+				}
+			}
+			ASSERT_LE(misses, set.size() / 100) <<
+				"Table doesn't know where the keys are";
+		}
+	}
+}
+
+using string_pair = std::pair<std::string, int>;
+using hashed_string_multimap = seg::multimap_tmp<
+	std::string,
+	int,
+	std::less<std::string>,
+	seg::list_tmp<string_pair, seg::hashed_index<
+		fenced_index<seg::big_header_index<string_pair, 16, std::allocator<string_pair>>, seg::map_value_to_key>,
+		seg::map_value_to_key>>,
+	flat::find_adaptor_linear,
+	flat::equal_range_adaptor_linear>;
+
+TEST_F(TestHashedIndex, Multimap) {
+	hashed_string_multimap map;
+	std::multimap<std::string, int> m;
+	for (int i = 0; i < 20; ++i) {
+		for (size_t n = rand(300); n; --n) {
+			string_pair x("key" + std::to_string(rand(100)), i);
+			map.insert(x);
+			m.insert(x);
+		}
+		for (size_t n = rand(100); n; --n) {
+			std::string k = "key" + std::to_string(rand(100));
+			auto r = map.equal_range(k);
+			map.erase(r.first, r.second);
+			m.erase(k);
+		}
+		for (int j = 0; j < 2; ++j) {
+			for (int k = 0; k < 100; ++k) {
+				std::string x = "key" + std::to_string(k);
+				auto r = map.equal_range(x);
+				auto e = m.equal_range(x);
+				ASSERT_EQ(seg::distance(map.begin(), r.first), std::distance(m.begin(), e.first)) <<
+					"Start of the equal range is not in the right position";
+				ASSERT_EQ(seg::distance(r.first, r.second), std::distance(e.first, e.second)) <<
+					"Equal range doesn't have the right size";
+			}
+		}
+	}
+}
+
+#endif // INTERNAL_HASHED_INDEX_TEST && SEG_POD_TEST
+
+
+#ifdef INTERNAL_FROZEN_SET_TEST
+
+using frozen_multiset = seg::multiset_tmp<
+	value_type,
+	std::less<value_type>,
+	seg::list_tmp<value_type, index>,
+	flat::find_adaptor_linear,
+	flat::equal_range_adaptor_linear>;
+
+struct TestFrozenSet : public InternalTestBase
+{
+	static frozen_multiset set;
+	static std::vector<value_type> v;
+
+	void TearDownSeg() override {
+		set.clear();
+		v.clear();
+	}
+
+	void InsertRand(size_t n) {
+		while (n) {
+			value_type x = value_type(static_cast<int>(rand(1000)));
+			set.insert(x);
+			v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+			--n;
+		}
+	}
+
+	void EraseRand(size_t n) {
+		size_t i = rand(v.size() - n);
+		set.erase(seg::successor(set.begin(), i), seg::successor(set.begin(), i + n));
+		v.erase(v.begin() + i, v.begin() + (i + n));
+	}
+
+	void CheckBounds() {
+		ASSERT_EQ(set.size(), v.size()) <<
+			"Size of the set is not correct";
+
+		for (int k = -1; k <= 1001; ++k) {
+			value_type x = value_type(k);
+			std::ptrdiff_t l = std::lower_bound(v.begin(), v.end(), x) - v.begin();
+			std::ptrdiff_t u = std::upper_bound(v.begin(), v.end(), x) - v.begin();
+			ASSERT_EQ(seg::distance(set.begin(), set.lower_bound(x)), l) <<
+				"Lower bound is not in the right position";
+			ASSERT_EQ(seg::distance(set.begin(), set.upper_bound(x)), u) <<
+				"Upper bound is not in the right position";
+
+			auto r = set.equal_range(x);
+			ASSERT_TRUE(r.first == set.lower_bound(x) && r.second == set.upper_bound(x)) <<
+				"Equal range is not correct";
+		}
+	}
+};
+
+frozen_multiset TestFrozenSet::set;
+std::vector<value_type> TestFrozenSet::v;
+
+TEST_F(TestFrozenSet, Bounds) {
+	for (int i = 0; i < 30; ++i) {
+		InsertRand(rand(300));
+		set.freeze();
+		ASSERT_TRUE(set.frozen()) <<
+			"Set is not frozen after freeze";
+		CheckBounds();
+		EraseRand(rand(v.size()));
+		ASSERT_FALSE(set.frozen()) <<
+			"Erasure didn't thaw the set";
+		set.freeze();
+		CheckBounds();
+		InsertRand(1);
+		ASSERT_FALSE(set.frozen()) <<
+			"Insertion didn't thaw the set";
+		CheckBounds();
+	}
+}
+
+TEST_F(TestFrozenSet, Copy) {
+	InsertRand(500);
+	set.freeze();
+	frozen_multiset copy(set);
+	ASSERT_FALSE(copy.frozen()) <<
+		"Copy of a frozen set is frozen";
+	frozen_multiset moved(std::move(copy));
+	moved.freeze();
+	ASSERT_TRUE(moved.size() == set.size() && std::equal(moved.begin(), moved.end(), set.begin())) <<
+		"Copy is not equal to the original";
+	for (int k = -1; k <= 1001; ++k) {
+		value_type x = value_type(k);
+		ASSERT_EQ(seg::distance(moved.begin(), moved.lower_bound(x)), seg::distance(set.begin(), set.lower_bound(x))) <<
+			"Lower bounds of the copy and the original differ";
+	}
+}
+
+#endif // INTERNAL_FROZEN_SET_TEST
+
+
+#ifdef INTERNAL_SMALL_INDEX_TEST
+
+struct TestSmallIndex : public InternalTestBase
+{
+	using small_list = seg::list_small_header<value_type, capacity, std::allocator<value_type>>;
+
+	static small_list list;
+	static std::vector<value_type> v;
+
+	void TearDownSeg() override {
+		list.clear();
+		v.clear();
+	}
+
+	void InsertRand(size_t n) {
+		size_t i = rand(v.size());
+		std::vector<value_type> x(n);
+		std::generate(x.begin(), x.end(), []() { return value_type(static_cast<int>(rand(1000))); });
+		list.insert(seg::successor(list.begin(), i), x.begin(), n);
+		v.insert(v.begin() + i, x.begin(), x.end());
+	}
+
+	void EraseRand(size_t n) {
+		size_t i = rand(v.size() - n);
+		list.erase(seg::successor(list.begin(), i), seg::successor(list.begin(), i + n));
+		v.erase(v.begin() + i, v.begin() + (i + n));
+	}
+
+	static void CheckEqual(const small_list& l, const std::vector<value_type>& x) {
+		ASSERT_EQ(l.size(), x.size()) <<
+			"Size of the list is not correct";
+		ASSERT_EQ(static_cast<size_t>(seg::distance(l.cbegin(), l.cend())), x.size()) <<
+			"Number of elements in segments is not correct";
+		ASSERT_TRUE(std::equal(x.begin(), x.end(), l.cbegin())) <<
+			"Elements of the list are not correct";
+	}
+};
+
+TestSmallIndex::small_list TestSmallIndex::list;
+std::vector<value_type> TestSmallIndex::v;
+
+TEST_F(TestSmallIndex, InsertErase) {
+	for (int i = 0; i < 50; ++i) {
+		InsertRand(rand(500));
+		CheckEqual(list, v);
+		EraseRand(rand(v.size()));
+		CheckEqual(list, v);
+	}
+}
+
+TEST_F(TestSmallIndex, CopyMove) {
+	InsertRand(1000);
+
+	small_list copy(list);
+	CheckEqual(copy, v);
+
+	small_list moved(std::move(copy));
+	CheckEqual(moved, v);
+	CheckEqual(copy, std::vector<value_type>());
+
+	copy.insert(copy.end(), value_type(1));
+	CheckEqual(copy, std::vector<value_type>(1, value_type(1)));
+
+	copy = moved;
+	CheckEqual(copy, v);
+
+	moved = std::move(copy);
+	CheckEqual(moved, v);
+	CheckEqual(copy, std::vector<value_type>());
+
+	small_list empty;
+	small_list empty_copy(empty);
+	CheckEqual(empty_copy, std::vector<value_type>());
+}
+
+#endif // INTERNAL_SMALL_INDEX_TEST
+
+
+#ifdef INTERNAL_COMPACT_INDEX_TEST
+
+struct TestCompactIndex : public InternalTestBase
+{
+	using compact_list = seg::list_compact_header<value_type, capacity, std::allocator<value_type>>;
+	using compact_header = typename compact_list::index::header_type;
+
+	static_assert(sizeof(compact_header) == 8, "Compact header must fit in 8 bytes");
+
+	static compact_list list;
+	static std::vector<value_type> v;
+
+	void TearDownSeg() override {
+		list.clear();
+		v.clear();
+	}
+
+	void InsertRand(size_t n) {
+		size_t i = rand(v.size());
+		std::vector<value_type> x(n);
+		std::generate(x.begin(), x.end(), []() { return value_type(static_cast<int>(rand(1000))); });
+		list.insert(seg::successor(list.begin(), i), x.begin(), n);
+		v.insert(v.begin() + i, x.begin(), x.end());
+	}
+
+	void EraseRand(size_t n) {
+		size_t i = rand(v.size() - n);
+		list.erase(seg::successor(list.begin(), i), seg::successor(list.begin(), i + n));
+		v.erase(v.begin() + i, v.begin() + (i + n));
+	}
+
+	void CheckEqual() {
+		ASSERT_EQ(list.size(), v.size()) <<
+			"Size of the list is not correct";
+		ASSERT_TRUE(std::equal(v.begin(), v.end(), list.cbegin())) <<
+			"Elements of the list are not correct";
+
+		std::vector<typename compact_header::handle_type> handles;
+		for (auto it = list.segment_index().begin(); it != list.segment_index().end(); ++it)
+			handles.push_back(handle(*it));
+		std::sort(handles.begin(), handles.end());
+		ASSERT_TRUE(std::adjacent_find(handles.begin(), handles.end()) == handles.end()) <<
+			"Two segments share the same area handle";
+	}
+};
+
+TestCompactIndex::compact_list TestCompactIndex::list;
+std::vector<value_type> TestCompactIndex::v;
+
+TEST_F(TestCompactIndex, InsertErase) {
+	for (int i = 0; i < 50; ++i) {
+		InsertRand(rand(500));
+		CheckEqual();
+		EraseRand(rand(v.size()));
+		CheckEqual();
+	}
+}
+
+// Allocator with state; counts the elements it has allocated and not yet deallocated
+template<typename T>
+struct counting_allocator : std::allocator<T>
+{
+	template<typename O>
+	struct rebind { using other = counting_allocator<O>; };
+
+	std::ptrdiff_t* live;
+
+	counting_allocator(std::ptrdiff_t* live) : live(live) {}
+	template<typename O>
+	counting_allocator(const counting_allocator<O>& x) : live(x.live) {}
+
+	T* allocate(std::size_t n) {
+		*live = *live + static_cast<std::ptrdiff_t>(n);
+		return std::allocator<T>::allocate(n);
+	}
+
+	void deallocate(T* p, std::size_t n) {
+		*live = *live - static_cast<std::ptrdiff_t>(n);
+		std::allocator<T>::deallocate(p, n);
+	}
+};
+
+TEST_F(TestCompactIndex, Allocator) {
+	using counted_list = seg::list_compact_header<value_type, capacity, counting_allocator<value_type>>;
+	std::ptrdiff_t live = 0;
+	{
+		counted_list l{ typename counted_list::allocator(&live) };
+		std::vector<value_type> x(5000);
+		for (size_t i = 0; i < x.size(); ++i) x[i] = value_type(static_cast<int>(i));
+		l.insert(l.begin(), x.begin(), x.size());
+		ASSERT_GT(live, 0) <<
+			"Areas were not allocated with the allocator of the list";
+
+		counted_list m(std::move(l));
+		l.insert(l.begin(), x.begin(), x.size());
+		ASSERT_TRUE(std::equal(x.begin(), x.end(), m.cbegin())) <<
+			"Elements of the moved list are not correct";
+		ASSERT_TRUE(std::equal(x.begin(), x.end(), l.cbegin())) <<
+			"Elements of the list are not correct";
+	}
+	ASSERT_EQ(live, 0) <<
+		"Areas were not given back to the allocator of the list";
+}
+
+TEST_F(TestCompactIndex, PoolLimit) {
+	// Two bits select the pool, so only three lists can hold areas at the same time
+	using limited_list = seg::list_compact_header<value_type, capacity, std::allocator<value_type>, 2>;
+	static_assert(limited_list::index::pool_type::max_pools == 3, "Pool bits don't limit the number of pools");
+	value_type x = value_type(1);
+	std::vector<limited_list> lists(4);
+	for (size_t i = 0; i < 3; ++i) lists[i].insert(lists[i].begin(), x);
+	ASSERT_THROW(lists[3].insert(lists[3].begin(), x), std::length_error) <<
+		"Pool which goes over the limit is not refused";
+	lists[0] = limited_list();
+	lists[3].insert(lists[3].begin(), x);
+	ASSERT_EQ(lists[3].size(), size_t(1)) <<
+		"Pool number is not reused after another pool has given its areas back";
+}
+
+#endif // INTERNAL_COMPACT_INDEX_TEST
+
+
+#define MEMORY_OVERFLOW_BUG
+
+
+#if defined(INTERNAL_SEGMENTED_INSERT_TEST) || defined(INTERNAL_SEGMENTED_ERASE_TEST)
+
+struct TestSegmentRangeBase : public InternalTestBase
+{
+	static std::vector<value_type> v;
+	static index in;
+	static segmented_coordinate first_inserted;
+	static segmented_coordinate last_inserted;
+
+	void SetUpSeg() override {
+		first_inserted = begin();
+		last_inserted = begin();
+	}
+
+	void TearDownSeg() override {
+		seg::destruct(begin(), first_inserted);
+		seg::destruct(last_inserted, end());
+		in.clear();
+		v.clear();
+	}
+
+	segmented_coordinate begin() { return segmented_coordinate(in.begin(), seg::begin(*in.begin())); }
+	segmented_coordinate end() { return segmented_coordinate(in.end(), seg::begin(*in.end())); }
+	header_iterator left() { return in.begin(); }
+	header_iterator right() { return --in.end(); }
+
+	size_t InitRandRange(size_t nm_segments) {
+		in.insert(in.begin(), static_cast<SizeType<index>>(nm_segments));
+		size_t s = create_rand_range(in.begin(), nm_segments);
+		v.resize(static_cast<SizeType<std::vector<value_type>>>(s));
+		seg::copy_seg_flat(begin(), end(), v.begin());
+		return s;
+	}
+
+	void InitLeft(size_t _first_init_index, size_t _last_init_index) {
+		header_iterator it = in.insert(in.begin(), 1);
+		create_segment(*it, _first_init_index, _last_init_index);
+		v.insert(v.begin(), seg::begin(*it), seg::end(*it));
+	}
+
+	void InitRight(size_t _first_init_index, size_t _last_init_index) {
+		header_iterator it = in.insert(in.end(), 1);
+		create_segment(*it, _first_init_index, _last_init_index);
+		v.insert(v.end(), seg::begin(*it), seg::end(*it));
+	}
+
+	void InitLeft(std::pair<size_t, size_t> p) {
+		InitLeft(p.first, p.second);
+	}
+
+	void InitRight(std::pair<size_t, size_t> p) {
+		InitRight(p.first, p.second);
+	}
+};
+
+index TestSegmentRangeBase::in;
+std::vector<value_type> TestSegmentRangeBase::v;
+segmented_coordinate TestSegmentRangeBase::first_inserted;
+segmented_coordinate TestSegmentRangeBase::last_inserted;
+
+#endif 
+
+
+
+#ifdef INTERNAL_SEGMENTED_INSERT_TEST 
+
+
+struct TestSegmentInsert : public TestSegmentRangeBase
+{
+	void TestRangeInsertedCorrectly(
+		segmented_coordinate first,
+		segmented_coordinate last,
+		size_t insert_nm,
+		header_iterator first_balance,
+		header_iterator last_balance) {
+
+		first_inserted = first;
+		last_inserted = last;
+		test_correct_segment_and_range_size(in.begin(), in.end(), insert_nm + v.size());
+		test_per_segment_balance(first_balance, last_balance);
+
+		ASSERT_LE(first, last) <<
+			"First element of the inserted rage is after last";
+
+		check_equal(
+			seg::distance(first, last),
+			insert_nm,
+			"Inserted range is smaller than it should be",
+			"Inserted range is larger than it should be");
+
+		ASSERT_LE(begin(), first) <<
+			"First element of the inserted range is before the first element of the entire range";
+		ASSERT_GE(end(), last) <<
+			"Last element of the inserted range is after the last element of the entire range";
+
+		size_t left_size = seg::distance(begin(), first);
+
+		ASSERT_TRUE(seg::equal_flat_n_seg(v.begin(), left_size, begin(), first)) <<
+			"Left range is no longer the same";
+
+		ASSERT_TRUE(seg::equal_flat_n_seg(flat::successor(v.begin(), left_size), static_cast<size_t>(v.size()) - left_size, last, end())) <<
+			"Right range is no longer the same";
+	}
+
+	void TestRangeInsertedCorrectly(
+		pair2<header_iterator, size_t> r,
+		size_t insert_nm,
+		header_iterator first_balance,
+		header_iterator last_balance) {
+
+		segment_iterator fseg = segment_iterator(r.first.first);
+		segmented_coordinate first(fseg, std::begin(fseg) + r.first.second);
+		segment_iterator lseg = segment_iterator(r.second.first);
+		segmented_coordinate last(lseg, std::begin(lseg) + r.second.second);
+
+		TestRangeInsertedCorrectly(first, last, insert_nm, first_balance, last_balance);
+	}
+
+	void TestRangeInsertedCorrectly(
+		pair2<header_iterator, size_t> r,
+		size_t insert_nm) {
+
+		TestRangeInsertedCorrectly(r, insert_nm, in.end(), in.end());
+	}
+};
+
+TEST_F(TestSegmentInsert, InsertCurrentAvailable)
+{
+	InitRandRange(1);
+	size_t left_size = seg::size(*left());
+	size_t insert_nm = rand(capacity - left_size);
+	size_t insert_at = rand(left_size);
+
+	TestRangeInsertedCorrectly(
+		seg::insert_current_available_aux(left(), insert_at, insert_nm),
+		insert_nm);
+}
+
+TEST_F(TestSegmentInsert, InsertBalanceLeftSimple)
+{
+	auto [left_first, left_last] = rand_begin_and_end_not_full_edge(capacity);
+	InitLeft(left_first, left_last);
+	auto [right_first, right_last] = rand_begin_and_end_not_full(capacity);
+	InitRight(right_first, right_last);
+
+	size_t left_size = left_last - left_first;
+	size_t right_size = right_last - right_first;
+	size_t insert_at = rand(right_size);
+	size_t available_right = capacity - right_size;
+	size_t insert_nm = rand(available_right + 1, available_right + (capacity - left_size));
+
+	TestRangeInsertedCorrectly(
+		seg::insert_balance_left_simple(right(), left(), (seg::size(*left()) + seg::size(*right()) + insert_nm) >> 1, insert_at, insert_nm),
+		insert_nm);
+}
+
+TEST_F(TestSegmentInsert, InsertBalanceRightSimple)
+{
+	auto [left_first, left_last] = rand_begin_and_end_not_full(capacity);
+	InitLeft(left_first, left_last);
+	auto [right_first, right_last] = rand_begin_and_end_not_full_edge(capacity);
+	InitRight(right_first, right_last);
+
+	size_t left_size = left_last - left_first;
+	size_t right_size = right_last - right_first;
+	size_t insert_at = rand(left_size);
+	size_t available_left = capacity - left_size;
+	size_t insert_nm = rand(available_left + 1, available_left + (capacity - right_size));
+
+	TestRangeInsertedCorrectly(
+		seg::insert_balance_right_simple(left(), right(), (seg::size(*left()) + seg::size(*right()) + insert_nm) >> 1, insert_at, insert_nm),
+		insert_nm);
+}
+
+TEST_F(TestSegmentInsert, InsertBalanceLeftIncreaseEmpty)
+{
+	auto [right_first, right_last] = rand_begin_and_end_not_full(capacity);
+	InitRight(right_first, right_last);
+	size_t nm_used_segments = rand(2, 10);
+	size_t right_size = right_last - right_first;
+	size_t max_size = capacity * nm_used_segments;
+	size_t min_size = ((nm_used_segments - 1) * capacity) + 1;
+	size_t size = rand(min_size, max_size);
+	size_t insert_nm = size - right_size;
+
+	auto [nm_segments, m, s] = seg::segment_range_info(capacity, 0, seg::size(*right()), insert_nm);
+	header_iterator first = in.insert(right(), nm_segments - 1);
+	std::pair<header_iterator, size_t> p = seg::insert_balance_left_increase_empty(first, right(), m, s, insert_nm);
+	segment_iterator it(p.first);
+
+	TestRangeInsertedCorrectly(
+		begin(), 
+		segmented_coordinate(it, std::begin(it) + p.second), 
+		insert_nm,
+		left(), 
+		right());
+}
+
+TEST_F(TestSegmentInsert, InsertBalanceLeftIncrease)
+{
+	auto [right_first, right_last] = rand_begin_and_end_not_full(capacity);
+	InitRight(right_first, right_last);
+	size_t nm_used_segments = rand(2, 10);
+	size_t right_size = right_last - right_first;
+	size_t max_size = capacity * nm_used_segments;
+	size_t min_size = ((nm_used_segments - 1) * capacity) + 1;
+	size_t size = rand(min_size, max_size);
+	size_t insert_nm = size - right_size;
+	size_t insert_at = rand(right_size);
+
+	auto [nm_segments, m, s] = seg::segment_range_info(capacity, 0, seg::size(*right()), insert_nm);
+	size_t left_final_size = m > 0 ? s + 1 : s;
+	size_t left_size = rand(1, left_final_size - 1);
+	if (left_size >= insert_nm) 
+		left_size = insert_nm >> 1;
+	insert_nm = insert_nm - left_size;
+	size_t left_first = balanced_begin(capacity, left_final_size);
+	InitLeft(left_first, left_first + left_size);
+
+	in.insert(right(), nm_segments - 2);
+	TestRangeInsertedCorrectly(
+		seg::insert_balance_left_increase(left(), right(), m, s, insert_at, insert_nm),
+		insert_nm,
+		left(),
+		right());
+}
+
+TEST_F(TestSegmentInsert, InsertBalanceLeft)
+{
+	auto [right_first, right_last] = rand_begin_and_end_not_full(capacity);
+	InitRight(right_first, right_last);
+
+	auto [left_first, left_last] = rand_begin_and_end_not_full_edge(capacity);
+	InitLeft(left_first, left_last);
+
+	size_t right_size = right_last - right_first;
+	size_t left_size = left_last - left_first;
+	size_t init_size = right_size + left_size;
+	size_t left_available = capacity - left_size;
+	size_t right_available = capacity - right_size;
+	size_t nm_used_segments = rand(2, 10);
+	size_t max_size = (capacity * nm_used_segments);
+	size_t min_size = (nm_used_segments - 1) * capacity + 1;
+	size_t size = rand(min_size, max_size);
+	if (size < init_size) {
+		size = init_size + right_available + (left_available >> 1);
+	}
+	size_t insert_nm = size - (left_size + right_size);
+	if (insert_nm <= right_available) {
+		insert_nm = right_available + (left_available >> 1);
+	}
+	size_t insert_at = rand(right_size);
+
+	auto [nm_segments, m, s] = seg::segment_range_info(capacity, seg::size(*left()), seg::size(*right()), insert_nm);
+	header_iterator first = in.insert(right(), nm_segments - 2);
+
+	size_t _insert_at = insert_at;
+	size_t _insert_nm = insert_nm;
 	size_t _nm_segments = nm_segments;
 	header _left = *left();
 	header _right = *right();
 
-	TestRangeInsertedCorrectly(
-		seg::insert_balance_left(left(), right(), m, s, insert_at, insert_nm),
-		insert_nm,
-		++left(),
-		right());
+	TestRangeInsertedCorrectly(
+		seg::insert_balance_left(left(), right(), m, s, insert_at, insert_nm),
+		insert_nm,
+		++left(),
+		right());
+}
+
+TEST_F(TestSegmentInsert, InsertEmpty)
+{
+	size_t insert_nm = rand(1, 1000);
+	auto r = seg::insert_empty(in, insert_nm);
+	TestRangeInsertedCorrectly(
+		r,
+		insert_nm,
+		left(),
+		++right());
+}
+
+TEST_F(TestSegmentInsert, Insert)
+{
+	size_t segment_insert_nm = rand(0, 10);
+	size_t insert_at_segment = 0;
+	if (segment_insert_nm > 0) {
+		InitRandRange(segment_insert_nm);
+		size_t insert_at_segment = rand(0, segment_insert_nm - 1);
+	}
+	header_iterator insert_it = flat::successor(in.begin(), insert_at_segment);
+	size_t insert_at_index = rand(seg::size(*insert_it));
+	size_t insert_nm = rand(0, 1000);
+
+	TestRangeInsertedCorrectly(
+		seg::insert_to_segment_range(in, insert_it, insert_at_index, insert_nm),
+		insert_nm);
+}
+
+#endif // INTERNAL_SEGMENTED_INSERT_TEST
+
+
+
+#ifdef INTERNAL_SEGMENTED_ERASE_TEST
+
+struct TestSegmentErase : public TestSegmentRangeBase
+{
+	void TestRangeErasedCorrectly(segmented_coordinate erase_pos, size_t left_size, size_t right_size)
+	{
+		first_inserted = begin();
+		last_inserted = first_inserted;
+		test_correct_segment_and_range_size(in.begin(), in.end());
+
+		ASSERT_GE(erase_pos, begin()) <<
+			"Erase pos is before the beginning of the range";
+
+		ASSERT_LE(erase_pos, end()) <<
+			"Erase pos is after the ending of the range";
+
+		ASSERT_TRUE(seg::equal_flat_n_seg(v.begin(), left_size, begin(), erase_pos)) <<
+			"Left range is not the same as before";
+
+		ASSERT_TRUE(seg::equal_flat_n_seg(v.end() - right_size, right_size, erase_pos, end())) <<
+			"Right range is not the same as before";
+	}
+
+	void TestRangeErasedCorrectly(
+		std::pair<header_iterator, size_t> erase_pos,
+		size_t left_size,
+		size_t right_size)
+	{
+		segment_iterator it(erase_pos.first);
+		return TestRangeErasedCorrectly(segmented_coordinate(it, flat::successor(std::begin(it), erase_pos.second)), left_size, right_size);
+	}
+};
+
+
+TEST_F(TestSegmentErase, EraseCurrent)
+{
+	auto [first, last] = rand_begin_and_end(capacity);
+	size_t size = last - first;
+	size_t erase_nm = rand(size);
+	size_t erase_at = rand(size - erase_nm);
+	InitLeft(first, last);
+	seg::erase_current(*left(), erase_at, erase_nm);
+	TestRangeErasedCorrectly(seg::erase_balance_current(in, left(), erase_at), erase_at, size - (erase_at + erase_nm));
+}
+
+TEST_F(TestSegmentErase, Erase)
+{
+	size_t size = InitRandRange(rand(10));
+	auto [firste, laste] = rand_begin_and_end(size);
+	size_t erase_nm = laste - firste;
+	segmented_coordinate first_erase = seg::successor(begin(), firste);
+	segmented_coordinate last_erase = seg::successor(first_erase, erase_nm);
+
+	header_iterator _first_erase = seg::segment(first_erase).h;
+	size_t _first_i = seg::flat(first_erase) - seg::begin(*_first_erase);
+	header_iterator _last_erase;
+	size_t _last_i;
+
+	if (last_erase == end() && begin() != end()) {
+		_last_erase = --seg::segment(last_erase).h;
+		_last_i = seg::size(*_last_erase);
+	}
+	else {
+		_last_erase = seg::segment(last_erase).h;
+		_last_i = seg::flat(last_erase) - seg::begin(*_last_erase);
+	}
+	auto [_it, _i, _s] = seg::erase_from_segment_range(in, _first_erase, _first_i, _last_erase, _last_i);
+	TestRangeErasedCorrectly(std::make_pair(_it, _i), firste, size - laste);
+}
+
+
+#endif // INTERNAL_SEGMENTED_ERASE_TEST
+
+
+#ifdef INTERNAL_SEARCH_TEST
+
+struct TestSegmentContainerSearch : public InternalTestBase
+{
+	static multiset set;
+
+	void SetUpSeg() override {
+	}
+
+	void TearDownSeg() override {
+		set.clear();
+	}
+
+	void InitRand(size_t nm_segments) {
+		index in;
+		in.insert(in.begin(), static_cast<SizeType<index>>(nm_segments));
+		size_t s = create_rand_range(in.begin(), nm_segments);
+		set.swap(in, s);
+	}
+};
+
+multiset TestSegmentContainerSearch::set;
+
+TEST_F(TestSegmentContainerSearch, LowerBound)
+{
+	InitRand(rand(10));
+	int size = static_cast<int>(set.size());
+	segmented_coordinate end = set.end();
+	for (int i = 0; i < size; ++i) {
+		segmented_coordinate c = set.lower_bound(value_type(i));
+		ASSERT_NE(c, end) << 
+			"LowerBound was not found";
+		ASSERT_GE(*c, value_type(i)) <<
+			"Lesser element than LowerBound was found";
+		ASSERT_EQ(*c, value_type(i)) <<
+			"Greater element than LowerBound was found";
+	}
+}
+
+TEST_F(TestSegmentContainerSearch, UpperBound)
+{
+	InitRand(10);
+	int size = static_cast<int>(set.size());
+	segmented_coordinate end = set.end();
+	for (int i = 0; i < size; ++i) {
+		segmented_coordinate c = set.upper_bound(value_type(i));
+		if (i != size - 1) {
+			ASSERT_NE(c, end) <<
+				"UpperBound was not found";
+			ASSERT_GE(*c, value_type(i + 1)) <<
+				"Lesser element than UpperBound was found";
+			ASSERT_EQ(*c, value_type(i + 1)) <<
+				"Greater element than UpperBound was found";
+		}
+		else {
+			ASSERT_EQ(c, end) <<
+				"UpperBound was not found";
+		}
+	}
+}
+
+TEST_F(TestSegmentContainerSearch, EqualRange)
+{
+	InitRand(10);
+	int size = static_cast<int>(set.size());
+	segmented_coordinate end = set.end();
+	for (int i = 0; i < size; ++i) {
+		auto [lb, ub] = set.equal_range(value_type(i));
+		ASSERT_NE(lb, end) <<
+			"LowerBound was not found";
+		ASSERT_GE(*lb, value_type(i)) <<
+			"Lesser element than LowerBound was found";
+		ASSERT_EQ(*lb, value_type(i)) <<
+			"Greater element than LowerBound was found";
+
+		if (i != size - 1) {
+			ASSERT_GE(*ub, value_type(i + 1)) <<
+				"Lesser element than UpperBound was found";
+			ASSERT_EQ(*ub, value_type(i + 1)) <<
+				"Greater element than UpperBound was found";
+		}
+		else {
+			ASSERT_EQ(ub, end) <<
+				"UpperBound was not found";
+		}
+	}
+}
+
+#endif
+
+
+#ifdef INTERNAL_SIMD_SEARCH_TEST
+
+struct TestSimdSearch : public InternalTestBase
+{
+	// Sorted keys with runs of equal ones, searched for keys inside, between and outside of them
+	template<typename T>
+	void CheckKeys(T offset) {
+		for (size_t n = 0; n < 300; n = n + 1 + rand(7)) {
+			std::vector<T> v(n);
+			for (size_t i = 0; i < n; ++i) v[i] = static_cast<T>(offset + static_cast<T>(rand(n)));
+			std::sort(v.begin(), v.end());
+
+			T* first = v.data();
+			T* last = v.data() + n;
+			for (size_t k = 0; k <= n + 1; ++k) {
+				T x = static_cast<T>(offset + static_cast<T>(k) - 1);
+				T* l = std::lower_bound(first, last, x);
+				T* u = std::upper_bound(first, last, x);
+				ASSERT_EQ(flat::find_adaptor_simd()(first, last, lower_bound_predicate<T, std::less<T>>(x, std::less<T>())), l) <<
+					"Lower bound is not in the right position";
+				ASSERT_EQ(flat::find_adaptor_simd()(first, last, upper_bound_predicate<T, std::less<T>>(x, std::less<T>())), u) <<
+					"Upper bound is not in the right position";
+
+				auto r = flat::equal_range_adaptor_simd()(static_cast<const T*>(first), static_cast<const T*>(last), x, std::less<T>());
+				ASSERT_TRUE(r.first == l && r.second == u) <<
+					"Equal range is not correct";
+			}
+		}
+	}
+};
+
+TEST_F(TestSimdSearch, Integral) {
+	CheckKeys<std::int32_t>(-100);
+	CheckKeys<std::uint32_t>(std::numeric_limits<std::uint32_t>::max() - 200);
+	CheckKeys<std::int64_t>(-100);
+	CheckKeys<std::uint64_t>(std::numeric_limits<std::uint64_t>::max() - 200);
+}
+
+TEST_F(TestSimdSearch, Floating) {
+	CheckKeys<float>(-100.0f);
+	CheckKeys<double>(-100.0);
+}
+
+TEST_F(TestSimdSearch, Set) {
+	using simd_multiset = seg::multiset_big_header<std::int64_t, std::less<std::int64_t>, 64, std::allocator<std::int64_t>,
+		flat::find_adaptor_simd, flat::equal_range_adaptor_simd>;
+
+	simd_multiset set;
+	std::vector<std::int64_t> v;
+	for (int i = 0; i < 3000; ++i) {
+		std::int64_t x = static_cast<std::int64_t>(rand(1000));
+		set.insert(x);
+		v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+	}
+	for (std::int64_t x = -1; x <= 1001; ++x) {
+		std::ptrdiff_t l = std::lower_bound(v.begin(), v.end(), x) - v.begin();
+		std::ptrdiff_t u = std::upper_bound(v.begin(), v.end(), x) - v.begin();
+		ASSERT_EQ(seg::distance(set.begin(), set.lower_bound(x)), l) <<
+			"Lower bound is not in the right position";
+		ASSERT_EQ(seg::distance(set.begin(), set.upper_bound(x)), u) <<
+			"Upper bound is not in the right position";
+		auto r = set.equal_range(x);
+		ASSERT_TRUE(r.first == set.lower_bound(x) && r.second == set.upper_bound(x)) <<
+			"Equal range is not correct";
+	}
+}
+
+#endif // INTERNAL_SIMD_SEARCH_TEST
+
+#ifdef INTERNAL_INTERPOLATION_SEARCH_TEST
+
+struct TestInterpolationSearch : public InternalTestBase
+{
+	using interpolation_multiset = seg::multiset_big_header<std::int64_t, std::less<std::int64_t>, 64, std::allocator<std::int64_t>,
+		flat::find_adaptor_interpolation, flat::equal_range_adaptor_interpolation>;
+
+	// Uniform keys, and skewed ones where most keys are crowded at the start of the range
+	static std::int64_t Key(size_t i, bool skewed) {
+		std::int64_t k = static_cast<std::int64_t>(i);
+		return skewed ? k * k * k : k * 1000;
+	}
+
+	void CheckFlat(bool skewed) {
+		for (size_t n = 0; n < 500; n = n + 1 + rand(13)) {
+			std::vector<std::int64_t> v(n);
+			for (size_t i = 0; i < n; ++i) v[i] = Key(rand(n), skewed);
+			std::sort(v.begin(), v.end());
+
+			for (size_t k = 0; k <= n + 1; ++k) {
+				for (std::int64_t d = -1; d <= 1; ++d) {
+					std::int64_t x = Key(k, skewed) + d;
+					auto l = std::lower_bound(v.begin(), v.end(), x);
+					auto u = std::upper_bound(v.begin(), v.end(), x);
+					ASSERT_EQ(flat::find_adaptor_interpolation()(v.data(), v.data() + n,
+						lower_bound_predicate<std::int64_t, std::less<std::int64_t>>(x, std::less<std::int64_t>())), v.data() + (l - v.begin())) <<
+						"Lower bound is not in the right position";
+					ASSERT_EQ(flat::find_adaptor_interpolation()(v.data(), v.data() + n,
+						upper_bound_predicate<std::int64_t, std::less<std::int64_t>>(x, std::less<std::int64_t>())), v.data() + (u - v.begin())) <<
+						"Upper bound is not in the right position";
+				}
+			}
+		}
+	}
+
+	void CheckSet(bool skewed) {
+		interpolation_multiset set;
+		std::vector<std::int64_t> v;
+		for (int i = 0; i < 3000; ++i) {
+			std::int64_t x = Key(rand(1000), skewed);
+			set.insert(x);
+			v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+		}
+		for (size_t k = 0; k <= 1001; ++k) {
+			for (std::int64_t d = -1; d <= 1; ++d) {
+				std::int64_t x = Key(k, skewed) + d;
+				std::ptrdiff_t l = std::lower_bound(v.begin(), v.end(), x) - v.begin();
+				std::ptrdiff_t u = std::upper_bound(v.begin(), v.end(), x) - v.begin();
+				ASSERT_EQ(seg::distance(set.begin(), set.lower_bound(x)), l) <<
+					"Lower bound is not in the right position";
+				ASSERT_EQ(seg::distance(set.begin(), set.upper_bound(x)), u) <<
+					"Upper bound is not in the right position";
+				auto r = set.equal_range(x);
+				ASSERT_TRUE(r.first == set.lower_bound(x) && r.second == set.upper_bound(x)) <<
+					"Equal range is not correct";
+			}
+		}
+	}
+};
+
+TEST_F(TestInterpolationSearch, Uniform) {
+	CheckFlat(false);
+	CheckSet(false);
+}
+
+TEST_F(TestInterpolationSearch, Skewed) {
+	CheckFlat(true);
+	CheckSet(true);
+}
+
+#endif // INTERNAL_INTERPOLATION_SEARCH_TEST
+
+#ifdef INTERNAL_ADAPTIVE_SEARCH_TEST
+
+struct TestAdaptiveSearch : public InternalTestBase
+{
+	// Ranges both shorter and longer than the crossover, with runs of equal keys
+	template<typename T, typename F>
+	void CheckKeys(F make_key) {
+		size_t max_size = 3 * flat::adaptive_crossover<T>() + 20;
+		for (size_t n = 0; n < max_size; n = n + 1 + rand(5)) {
+			std::vector<T> v(n);
+			for (size_t i = 0; i < n; ++i) v[i] = make_key(rand(n));
+			std::sort(v.begin(), v.end());
+
+			for (size_t k = 0; k <= n + 1; ++k) {
+				T x = make_key(k);
+				auto l = std::lower_bound(v.begin(), v.end(), x);
+				auto u = std::upper_bound(v.begin(), v.end(), x);
+				ASSERT_EQ(flat::find_adaptor_adaptive()(v.begin(), v.end(), lower_bound_predicate<T, std::less<T>>(x, std::less<T>())), l) <<
+					"Lower bound is not in the right position";
+				ASSERT_EQ(flat::find_adaptor_adaptive()(v.begin(), v.end(), upper_bound_predicate<T, std::less<T>>(x, std::less<T>())), u) <<
+					"Upper bound is not in the right position";
+
+				auto r = flat::equal_range_adaptor_adaptive()(v.begin(), v.end(), x, std::less<T>());
+				ASSERT_TRUE(r.first == l && r.second == u) <<
+					"Equal range is not correct";
+			}
+		}
+	}
+};
+
+TEST_F(TestAdaptiveSearch, Crossover) {
+	ASSERT_EQ(flat::adaptive_crossover<unsigned short>(), flat::adaptive_arithmetic_crossover) <<
+		"Crossover is measured before it's calibrated";
+	flat::calibrate<std::int64_t, signed char>();
+	size_t c = flat::adaptive_crossover<std::int64_t>();
+	ASSERT_EQ(c, flat::adaptive_crossover<std::int64_t>()) <<
+		"Crossover is measured more than once";
+	ASSERT_TRUE(c <= 2048 && (c & (c - 1)) == 0) <<
+		"Crossover is not one of the measured sizes";
+	ASSERT_LE(flat::adaptive_crossover<signed char>(), size_t(127)) <<
+		"Crossover is measured over keys which don't fit into the key type";
+	c = flat::calibrate_adaptive_crossover<std::int32_t>(0);
+	ASSERT_TRUE(c <= 2048 && (c & (c - 1)) == 0) <<
+		"Crossover is not measured over a buffer smaller than a single range";
+	using pair = std::pair<int, int>;
+	ASSERT_EQ(flat::adaptive_crossover<pair>(), flat::adaptive_default_crossover) <<
+		"Crossover of keys which aren't arithmetic is not the default one";
+}
+
+TEST_F(TestAdaptiveSearch, Bounds) {
+	CheckKeys<std::int64_t>([](size_t i) { return static_cast<std::int64_t>(i) - 10; });
+	CheckKeys<double>([](size_t i) { return static_cast<double>(i) / 4; });
+	CheckKeys<std::pair<int, int>>([](size_t i) { return std::pair<int, int>(static_cast<int>(i / 3), static_cast<int>(i % 3)); });
+}
+
+TEST_F(TestAdaptiveSearch, Set) {
+	seg::multiset_adaptive<std::int64_t> set;
+	std::vector<std::int64_t> v;
+	for (int i = 0; i < 3000; ++i) {
+		std::int64_t x = static_cast<std::int64_t>(rand(1000));
+		set.insert(x);
+		v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+	}
+	for (std::int64_t x = -1; x <= 1001; ++x) {
+		std::ptrdiff_t l = std::lower_bound(v.begin(), v.end(), x) - v.begin();
+		std::ptrdiff_t u = std::upper_bound(v.begin(), v.end(), x) - v.begin();
+		ASSERT_EQ(seg::distance(set.begin(), set.lower_bound(x)), l) <<
+			"Lower bound is not in the right position";
+		ASSERT_EQ(seg::distance(set.begin(), set.upper_bound(x)), u) <<
+			"Upper bound is not in the right position";
+		auto r = set.equal_range(x);
+		ASSERT_TRUE(r.first == set.lower_bound(x) && r.second == set.upper_bound(x)) <<
+			"Equal range is not correct";
+	}
+}
+
+#endif // INTERNAL_ADAPTIVE_SEARCH_TEST
+
+#ifdef INTERNAL_BRANCHLESS_SEARCH_TEST
+
+using branchless_multiset = seg::multiset_tmp<
+	value_type,
+	std::less<value_type>,
+	segmented_list,
+	flat::branchless_segments<flat::find_adaptor_linear>,
+	flat::branchless_segments<flat::equal_range_adaptor_linear>>;
+
+struct TestBranchlessSearch : public InternalTestBase
+{
+	static branchless_multiset set;
+	static std::vector<value_type> v;
+
+	void TearDownSeg() override {
+		set.clear();
+		v.clear();
+	}
+
+	void InsertRand(size_t n) {
+		while (n) {
+			value_type x = value_type(static_cast<int>(rand(1000)));
+			set.insert(x);
+			v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+			--n;
+		}
+	}
+
+	// Bounds searched from the "from"-th element on
+	void CheckBounds(size_t from) {
+		auto first = seg::successor(set.begin(), from);
+		for (int k = -1; k <= 1001; ++k) {
+			value_type x = value_type(k);
+			std::ptrdiff_t l = std::lower_bound(v.begin() + from, v.end(), x) - v.begin();
+			std::ptrdiff_t u = std::upper_bound(v.begin() + from, v.end(), x) - v.begin();
+			ASSERT_EQ(seg::distance(set.begin(), set.lower_bound(first, x)), l) <<
+				"Lower bound is not in the right position";
+			ASSERT_EQ(seg::distance(set.begin(), set.upper_bound(first, x)), u) <<
+				"Upper bound is not in the right position";
+
+			auto r = seg::equal_range(first, set.end(), x, std::less<value_type>(), flat::branchless_segments<flat::equal_range_adaptor_linear>());
+			ASSERT_TRUE(seg::distance(set.begin(), r.first) == l && seg::distance(set.begin(), r.second) == u) <<
+				"Equal range is not correct";
+		}
+	}
+};
+
+branchless_multiset TestBranchlessSearch::set;
+std::vector<value_type> TestBranchlessSearch::v;
+
+TEST_F(TestBranchlessSearch, Bounds) {
+	for (int i = 0; i < 10; ++i) {
+		InsertRand(rand(600));
+		CheckBounds(0);
+		CheckBounds(rand(v.size()));
+	}
+}
+
+#endif // INTERNAL_BRANCHLESS_SEARCH_TEST
+
+#ifdef INTERNAL_BATCH_SEARCH_TEST
+
+using batch_multiset = seg::multiset_tmp<
+	value_type,
+	std::less<value_type>,
+	segmented_list,
+	flat::find_adaptor_binary,
+	flat::equal_range_adaptor_binary>;
+
+struct TestBatchSearch : public InternalTestBase
+{
+	static batch_multiset set;
+	static std::vector<value_type> v;
+
+	void TearDownSeg() override {
+		set.clear();
+		v.clear();
+	}
+
+	void InsertRand(size_t n) {
+		while (n) {
+			value_type x = value_type(static_cast<int>(rand(1000)));
+			set.insert(x);
+			v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+			--n;
+		}
+	}
+
+	// Batch of "n" random keys, some of them outside of the range of the elements
+	std::vector<value_type> RandKeys(size_t n) {
+		std::vector<value_type> keys;
+		while (n) {
+			keys.push_back(value_type(static_cast<int>(rand(1003)) - 1));
+			--n;
+		}
+		return keys;
+	}
+};
+
+batch_multiset TestBatchSearch::set;
+std::vector<value_type> TestBatchSearch::v;
+
+TEST_F(TestBatchSearch, Set) {
+	for (int i = 0; i < 10; ++i) {
+		InsertRand(rand(600));
+		std::vector<value_type> keys = RandKeys(rand(5 * seg::batch_group_size));
+		std::vector<batch_multiset::segmented_coordinate> r;
+		set.lower_bound_batch(keys.begin(), keys.end(), std::back_inserter(r));
+		ASSERT_EQ(r.size(), keys.size()) <<
+			"Not every key has a lower bound";
+		for (size_t j = 0; j < keys.size(); ++j)
+			ASSERT_EQ(seg::distance(set.begin(), r[j]), std::lower_bound(v.begin(), v.end(), keys[j]) - v.begin()) <<
+				"Lower bound is not in the right position";
+	}
+}
+
+TEST_F(TestBatchSearch, Range) {
+	for (int i = 0; i < 10; ++i) {
+		InsertRand(rand(600));
+		size_t from = rand(v.size());
+		size_t to = from + rand(v.size() - from);
+		auto first = seg::successor(set.begin(), from);
+		auto last = seg::successor(set.begin(), to);
+		std::vector<value_type> keys = RandKeys(rand(5 * seg::batch_group_size));
+		std::vector<batch_multiset::segmented_coordinate> r(keys.size());
+		seg::lower_bound_batch(first, last, keys.begin(), keys.end(), r.begin(), std::less<value_type>());
+		for (size_t j = 0; j < keys.size(); ++j)
+			ASSERT_EQ(seg::distance(set.begin(), r[j]), std::lower_bound(v.begin() + from, v.begin() + to, keys[j]) - v.begin()) <<
+				"Lower bound is not in the right position";
+	}
+}
+
+TEST_F(TestBatchSearch, Sorted) {
+	for (int i = 0; i < 10; ++i) {
+		InsertRand(rand(600));
+		std::vector<value_type> keys = RandKeys(rand(600));
+		std::sort(keys.begin(), keys.end());
+		std::vector<batch_multiset::segmented_coordinate> l;
+		std::vector<std::pair<batch_multiset::segmented_coordinate, batch_multiset::segmented_coordinate>> r;
+		set.lower_bound_sorted_batch(keys.begin(), keys.end(), std::back_inserter(l));
+		set.equal_range_sorted_batch(keys.begin(), keys.end(), std::back_inserter(r));
+		ASSERT_TRUE(l.size() == keys.size() && r.size() == keys.size()) <<
+			"Not every key has a lower bound or an equal range";
+		for (size_t j = 0; j < keys.size(); ++j) {
+			std::ptrdiff_t lj = std::lower_bound(v.begin(), v.end(), keys[j]) - v.begin();
+			std::ptrdiff_t uj = std::upper_bound(v.begin(), v.end(), keys[j]) - v.begin();
+			ASSERT_EQ(seg::distance(set.begin(), l[j]), lj) <<
+				"Lower bound is not in the right position";
+			ASSERT_TRUE(seg::distance(set.begin(), r[j].first) == lj && seg::distance(set.begin(), r[j].second) == uj) <<
+				"Equal range is not correct";
+		}
+	}
+}
+
+TEST_F(TestBatchSearch, SortedRange) {
+	for (int i = 0; i < 10; ++i) {
+		InsertRand(rand(600));
+		size_t from = rand(v.size());
+		size_t to = from + rand(v.size() - from);
+		auto first = seg::successor(set.begin(), from);
+		auto last = seg::successor(set.begin(), to);
+		std::vector<value_type> keys = RandKeys(rand(600));
+		std::sort(keys.begin(), keys.end());
+		std::vector<batch_multiset::segmented_coordinate> r(keys.size());
+		seg::lower_bound_sorted_batch(first, last, keys.begin(), keys.end(), r.begin(), std::less<value_type>());
+		for (size_t j = 0; j < keys.size(); ++j)
+			ASSERT_EQ(seg::distance(set.begin(), r[j]), std::lower_bound(v.begin() + from, v.begin() + to, keys[j]) - v.begin()) <<
+				"Lower bound is not in the right position";
+	}
+}
+
+#endif // INTERNAL_BATCH_SEARCH_TEST
+
+#ifdef INTERNAL_HINTED_SEARCH_TEST
+
+using hinted_multiset = seg::multiset_tmp<
+	value_type,
+	std::less<value_type>,
+	segmented_list,
+	flat::find_adaptor_binary,
+	flat::equal_range_adaptor_binary>;
+
+struct TestHintedSearch : public InternalTestBase
+{
+	static hinted_multiset set;
+	static std::vector<value_type> v;
+
+	void TearDownSeg() override {
+		set.clear();
+		v.clear();
+	}
+
+	void InsertRand(size_t n) {
+		while (n) {
+			value_type x = value_type(static_cast<int>(rand(1000)));
+			set.insert(x);
+			v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+			--n;
+		}
+	}
+};
+
+hinted_multiset TestHintedSearch::set;
+std::vector<value_type> TestHintedSearch::v;
+
+TEST_F(TestHintedSearch, Bounds) {
+	for (int i = 0; i < 10; ++i) {
+		InsertRand(rand(600));
+		for (int j = 0; j < 200; ++j) {
+			value_type x = value_type(static_cast<int>(rand(1003)) - 1);
+			auto hint = seg::successor(set.begin(), rand(v.size()));
+			ASSERT_EQ(seg::distance(set.begin(), set.lower_bound_from(hint, x)), std::lower_bound(v.begin(), v.end(), x) - v.begin()) <<
+				"Lower bound is not in the right position";
+			ASSERT_EQ(seg::distance(set.begin(), set.upper_bound_from(hint, x)), std::upper_bound(v.begin(), v.end(), x) - v.begin()) <<
+				"Upper bound is not in the right position";
+		}
+	}
+}
+
+TEST_F(TestHintedSearch, Insert) {
+	// Nearly sorted stream, every element hinted with the position of the previous one
+	auto hint = set.cbegin();
+	for (int i = 0; i < 3000; ++i) {
+		value_type x = value_type(i / 2 + static_cast<int>(rand(20)));
+		auto it = set.insert_hint(hint, x);
+		v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+		ASSERT_EQ(seg::distance(set.begin(), it), std::upper_bound(v.begin(), v.end(), x) - v.begin() - 1) <<
+			"Element is not inserted in the right position";
+		hint = it;
+	}
+	auto it = set.cbegin();
+	for (size_t i = 0; i < v.size(); ++i) {
+		ASSERT_TRUE(!(*it < v[i]) && !(v[i] < *it)) <<
+			"Elements are not sorted";
+		it = seg::successor(it, 1);
+	}
+}
+
+#endif // INTERNAL_HINTED_SEARCH_TEST
+
+#ifdef INTERNAL_SEGMENT_CACHE_TEST
+
+using cached_multiset = seg::multiset_tmp<
+	value_type,
+	std::less<value_type>,
+	segmented_list,
+	flat::find_adaptor_binary,
+	flat::equal_range_adaptor_binary>;
+
+struct TestSegmentCache : public InternalTestBase
+{
+	static cached_multiset set;
+	static std::vector<value_type> v;
+
+	void SetUpSeg() override {
+		set.enable_segment_cache();
+	}
+
+	void TearDownSeg() override {
+		set.clear();
+		v.clear();
+	}
+
+	// Elements are inserted around "center", so that consecutive insertions hit the same or nearby segments
+	void InsertAround(int center, size_t n) {
+		while (n) {
+			value_type x = value_type(center + static_cast<int>(rand(20)) - 10);
+			set.insert(x);
+			v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+			--n;
+		}
+	}
+
+	void CheckBounds(int k) {
+		value_type x = value_type(k);
+		ASSERT_EQ(seg::distance(set.begin(), set.lower_bound(x)), std::lower_bound(v.begin(), v.end(), x) - v.begin()) <<
+			"Lower bound is not in the right position";
+		ASSERT_EQ(seg::distance(set.begin(), set.upper_bound(x)), std::upper_bound(v.begin(), v.end(), x) - v.begin()) <<
+			"Upper bound is not in the right position";
+	}
+};
+
+cached_multiset TestSegmentCache::set;
+std::vector<value_type> TestSegmentCache::v;
+
+TEST_F(TestSegmentCache, Bounds) {
+	ASSERT_TRUE(set.segment_cache_enabled()) <<
+		"Segment cache is not enabled";
+	CheckBounds(0);
+	for (int i = 0; i < 20; ++i) {
+		InsertAround(static_cast<int>(rand(1000)), rand(300));
+		if (i % 2) set.freeze();
+		// Clustered lookups, then lookups anywhere
+		int center = static_cast<int>(rand(1000));
+		for (int j = 0; j < 100; ++j) CheckBounds(center + static_cast<int>(rand(30)) - 15);
+		for (int j = 0; j < 100; ++j) CheckBounds(static_cast<int>(rand(1003)) - 1);
+		// Cached segment may no longer exist
+		size_t n = rand(v.size());
+		size_t from = rand(v.size() - n);
+		set.erase(seg::successor(set.begin(), from), seg::successor(set.begin(), from + n));
+		v.erase(v.begin() + from, v.begin() + from + n);
+		CheckBounds(static_cast<int>(rand(1003)) - 1);
+	}
 }
 
-TEST_F(TestSegmentInsert, InsertEmpty)
-{
-	size_t insert_nm = rand(1, 1000);
-	auto r = seg::insert_empty(in, insert_nm);
-	TestRangeInsertedCorrectly(
-		r,
-		insert_nm,
-		left(),
-		++right());
+TEST_F(TestSegmentCache, Copy) {
+	InsertAround(500, 300);
+	cached_multiset copy(set);
+	ASSERT_TRUE(copy.segment_cache_enabled()) <<
+		"Segment cache is not enabled in the copy";
+	copy.disable_segment_cache();
+	ASSERT_FALSE(copy.segment_cache_enabled()) <<
+		"Segment cache is not disabled";
+	for (int k = 480; k < 520; ++k)
+		ASSERT_EQ(seg::distance(copy.begin(), copy.lower_bound(value_type(k))), seg::distance(set.begin(), set.lower_bound(value_type(k)))) <<
+			"Lower bound is not the same with and without the cache";
 }
 
-TEST_F(TestSegmentInsert, Insert)
+TEST_F(TestSegmentCache, Move) {
+	InsertAround(500, 300);
+	cached_multiset moved(std::move(set));
+	ASSERT_TRUE(moved.segment_cache_enabled()) <<
+		"Segment cache is not enabled in the moved container";
+	set = std::move(moved);
+	ASSERT_TRUE(set.segment_cache_enabled()) <<
+		"Segment cache is not enabled in the container moved back";
+	for (int k = 480; k < 520; ++k) CheckBounds(k);
+}
+
+#endif // INTERNAL_SEGMENT_CACHE_TEST
+
+#ifdef INTERNAL_MERGE_INSERT_TEST
+
+using merge_multiset = seg::multiset_tmp<
+	value_type,
+	std::less<value_type>,
+	segmented_list,
+	flat::find_adaptor_binary,
+	flat::equal_range_adaptor_binary>;
+
+using merge_fenced_multiset = seg::multiset_tmp<
+	value_type,
+	std::less<value_type>,
+	seg::list_tmp<value_type, fenced_index<index, seg::set_value_to_key>>,
+	flat::find_adaptor_binary,
+	flat::equal_range_adaptor_binary>;
+
+struct TestMergeInsert : public InternalTestBase
 {
-	size_t segment_insert_nm = rand(0, 10);
-	size_t insert_at_segment = 0;
-	if (segment_insert_nm > 0) {
-		InitRandRange(segment_insert_nm);
-		size_t insert_at_segment = rand(0, segment_insert_nm - 1);
+	static std::vector<value_type> v;
+
+	void TearDownSeg() override {
+		v.clear();
 	}
-	header_iterator insert_it = flat::successor(in.begin(), insert_at_segment);
-	size_t insert_at_index = rand(seg::size(*insert_it));
-	size_t insert_nm = rand(0, 1000);
 
-	TestRangeInsertedCorrectly(
-		seg::insert_to_segment_range(in, insert_it, insert_at_index, insert_nm),
-		insert_nm);
+	// Sorted batch of "n" elements in [lo, lo + range)
+	std::vector<value_type> SortedBatch(size_t n, int lo, int range) {
+		std::vector<value_type> b;
+		for (size_t i = 0; i < n; ++i) b.push_back(value_type(lo + static_cast<int>(rand(static_cast<size_t>(range)))));
+		std::sort(b.begin(), b.end());
+		std::vector<value_type> r;
+		std::merge(v.begin(), v.end(), b.begin(), b.end(), std::back_inserter(r));
+		v = std::move(r);
+		return b;
+	}
+
+	template<typename S>
+	void CheckSet(const S& set) {
+		ASSERT_EQ(set.size(), v.size()) <<
+			"Size of the set is not correct";
+		auto it = set.cbegin();
+		for (size_t i = 0; i < v.size(); ++i) {
+			ASSERT_TRUE(!(*it < v[i]) && !(v[i] < *it)) <<
+				"Elements are not merged in the right order";
+			it = seg::successor(it, 1);
+		}
+		for (int k = -1; k <= 1001; k += 7) {
+			value_type x = value_type(k);
+			ASSERT_EQ(seg::distance(set.begin(), set.lower_bound(x)), std::lower_bound(v.begin(), v.end(), x) - v.begin()) <<
+				"Lower bound is not in the right position";
+		}
+	}
+
+	template<typename S>
+	void MergeRand() {
+		S set;
+		for (int i = 0; i < 30; ++i) {
+			// Batches are either spread over all the elements or clustered in a narrow range
+			int range = rand(2) ? 1000 : 20;
+			int lo = static_cast<int>(rand(static_cast<size_t>(1001 - range)));
+			std::vector<value_type> b = SortedBatch(rand(400), lo, range);
+			if (i % 2) set.insert_sorted(b.begin(), b.size());
+			else set.insert_move_sorted(b.begin(), b.size());
+			CheckSet(set);
+		}
+	}
+};
+
+std::vector<value_type> TestMergeInsert::v;
+
+TEST_F(TestMergeInsert, Merge) {
+	MergeRand<merge_multiset>();
 }
 
-#endif // INTERNAL_SEGMENTED_INSERT_TEST
+TEST_F(TestMergeInsert, Fenced) {
+	MergeRand<merge_fenced_multiset>();
+}
 
+TEST_F(TestMergeInsert, Ends) {
+	merge_multiset set;
+	std::vector<value_type> b = SortedBatch(100, 400, 200);
+	set.insert_sorted(b.begin(), b.size());
+	CheckSet(set);
+	// Whole batches before and after all the elements
+	b = SortedBatch(300, 0, 400);
+	set.insert_sorted(b.begin(), b.size());
+	CheckSet(set);
+	b = SortedBatch(300, 600, 400);
+	set.insert_sorted(b.begin(), b.size());
+	CheckSet(set);
+	set.insert_sorted(b.begin(), 0);
+	CheckSet(set);
+}
 
+#endif // INTERNAL_MERGE_INSERT_TEST
 
-#ifdef INTERNAL_SEGMENTED_ERASE_TEST
+#ifdef INTERNAL_BULK_LOAD_TEST
 
-struct TestSegmentErase : public TestSegmentRangeBase
+using bulk_multiset = seg::multiset_tmp<
+	value_type,
+	std::less<value_type>,
+	segmented_list,
+	flat::find_adaptor_binary,
+	flat::equal_range_adaptor_binary>;
+
+using bulk_fenced_multiset = seg::multiset_tmp<
+	value_type,
+	std::less<value_type>,
+	seg::list_tmp<value_type, fenced_index<index, seg::set_value_to_key>>,
+	flat::find_adaptor_binary,
+	flat::equal_range_adaptor_binary>;
+
+struct TestBulkLoad : public InternalTestBase
 {
-	void TestRangeErasedCorrectly(segmented_coordinate erase_pos, size_t left_size, size_t right_size)
-	{
-		first_inserted = begin();
-		last_inserted = first_inserted;
-		test_correct_segment_and_range_size(in.begin(), in.end());
+	static std::vector<value_type> v;
 
-		ASSERT_GE(erase_pos, begin()) <<
-			"Erase pos is before the beginning of the range";
+	void TearDownSeg() override {
+		v.clear();
+	}
 
-		ASSERT_LE(erase_pos, end()) <<
-			"Erase pos is after the ending of the range";
+	void SortedRand(size_t n) {
+		v.clear();
+		for (size_t i = 0; i < n; ++i) v.push_back(value_type(static_cast<int>(rand(1000))));
+		std::sort(v.begin(), v.end());
+	}
 
-		ASSERT_TRUE(seg::equal_flat_n_seg(v.begin(), left_size, begin(), erase_pos)) <<
-			"Left range is not the same as before";
+	// Number of segments, which are all checked to be at least half full and not fuller than "fill" allows
+	template<typename S>
+	size_t CheckSegments(const S& set, double fill) {
+		size_t most = std::max(static_cast<size_t>(static_cast<double>(capacity) * fill), capacity / 2);
+		size_t nm = 0;
+		for (auto sg = seg::segment(set.cbegin()); sg != seg::segment(set.cend()); ++sg) {
+			size_t size = static_cast<size_t>(std::end(sg) - std::begin(sg));
+			EXPECT_LE(size, capacity) <<
+				"Segment holds more elements than its capacity";
+			if (set.size() >= capacity) {
+				EXPECT_GE(size, capacity / 2) <<
+					"Segment is less than half full";
+			}
+			// At one half, keeping the segments at least half full takes precedence over the fill factor
+			if (fill > 0.5) {
+				EXPECT_LE(size, most) <<
+					"Segment is fuller than the fill factor";
+			}
+			++nm;
+		}
+		return nm;
+	}
 
-		ASSERT_TRUE(seg::equal_flat_n_seg(v.end() - right_size, right_size, erase_pos, end())) <<
-			"Right range is not the same as before";
+	template<typename S>
+	void CheckSet(const S& set) {
+		ASSERT_EQ(set.size(), v.size()) <<
+			"Size of the set is not correct";
+		auto it = set.cbegin();
+		for (size_t i = 0; i < v.size(); ++i) {
+			ASSERT_TRUE(!(*it < v[i]) && !(v[i] < *it)) <<
+				"Elements are not loaded in the right order";
+			it = seg::successor(it, 1);
+		}
+		for (int k = -1; k <= 1001; k += 7) {
+			value_type x = value_type(k);
+			ASSERT_EQ(seg::distance(set.begin(), set.lower_bound(x)), std::lower_bound(v.begin(), v.end(), x) - v.begin()) <<
+				"Lower bound is not in the right position";
+		}
 	}
 
-	void TestRangeErasedCorrectly(
-		std::pair<header_iterator, size_t> erase_pos,
-		size_t left_size,
-		size_t right_size)
-	{
-		segment_iterator it(erase_pos.first);
-		return TestRangeErasedCorrectly(segmented_coordinate(it, flat::successor(std::begin(it), erase_pos.second)), left_size, right_size);
+	template<typename S>
+	void Load() {
+		S set;
+		for (size_t n : { size_t(0), size_t(1), capacity / 2, capacity, capacity + 1, 20 * capacity + 7 }) {
+			SortedRand(n);
+			size_t full = 0;
+			for (double fill : { 1.0, 0.75, 0.5, 0.1 }) {
+				set.assign_sorted(v.begin(), v.size(), fill);
+				CheckSet(set);
+				size_t nm = CheckSegments(set, fill);
+				if (fill == 1.0) {
+					full = nm;
+					ASSERT_EQ(nm, (n + capacity - 1) / capacity) <<
+						"Fully packed segments are not the fewest possible";
+				}
+				ASSERT_GE(nm, full) <<
+					"Lower fill factor doesn't leave more room";
+			}
+			// Loaded set is an ordinary one
+			value_type x = value_type(static_cast<int>(rand(1000)));
+			set.insert(x);
+			v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+			CheckSet(set);
+		}
 	}
 };
 
+std::vector<value_type> TestBulkLoad::v;
 
-TEST_F(TestSegmentErase, EraseCurrent)
-{
-	auto [first, last] = rand_begin_and_end(capacity);
-	size_t size = last - first;
-	size_t erase_nm = rand(size);
-	size_t erase_at = rand(size - erase_nm);
-	InitLeft(first, last);
-	seg::erase_current(*left(), erase_at, erase_nm);
-	TestRangeErasedCorrectly(seg::erase_balance_current(in, left(), erase_at), erase_at, size - (erase_at + erase_nm));
+TEST_F(TestBulkLoad, Assign) {
+	Load<bulk_multiset>();
 }
 
-TEST_F(TestSegmentErase, Erase)
+TEST_F(TestBulkLoad, Fenced) {
+	Load<bulk_fenced_multiset>();
+}
+
+TEST_F(TestBulkLoad, Construct) {
+	SortedRand(10 * capacity);
+	std::vector<value_type> w(v);
+	bulk_multiset set(w.begin(), w.size(), 0.75);
+	CheckSet(set);
+	CheckSegments(set, 0.75);
+	bulk_multiset moved;
+	moved.assign_move_sorted(w.begin(), w.size());
+	CheckSet(moved);
+	// List is loaded the same way as the set
+	segmented_list list(v.begin(), v.size(), 0.75);
+	ASSERT_EQ(list.size(), v.size()) <<
+		"Size of the loaded list is not correct";
+	auto it = list.cbegin();
+	for (size_t i = 0; i < v.size(); ++i) {
+		ASSERT_EQ(*it, v[i]) <<
+			"Elements are not loaded into the list in the right order";
+		it = seg::successor(it, 1);
+	}
+	ASSERT_EQ(std::size(list.segment_index()), std::size(set.segment_index())) <<
+		"List is not split into segments the same way as the set";
+}
+
+#endif // INTERNAL_BULK_LOAD_TEST
+
+#ifdef INTERNAL_BATCH_INSERT_TEST
+
+using batch_multiset = seg::multiset_tmp<
+	value_type,
+	std::less<value_type>,
+	segmented_list,
+	flat::find_adaptor_binary,
+	flat::equal_range_adaptor_binary>;
+
+using batch_fenced_multiset = seg::multiset_tmp<
+	value_type,
+	std::less<value_type>,
+	seg::list_tmp<value_type, fenced_index<index, seg::set_value_to_key>>,
+	flat::find_adaptor_binary,
+	flat::equal_range_adaptor_binary>;
+
+using batch_pair = std::pair<int, int>;
+using batch_multimap = seg::multimap_tmp<
+	int,
+	int,
+	std::less<int>,
+	seg::list_tmp<batch_pair, seg::big_header_index<batch_pair, 16, std::allocator<batch_pair>>>,
+	flat::find_adaptor_binary,
+	flat::equal_range_adaptor_binary>;
+
+struct TestBatchInsert : public InternalTestBase
 {
-	size_t size = InitRandRange(rand(10));
-	auto [firste, laste] = rand_begin_and_end(size);
-	size_t erase_nm = laste - firste;
-	segmented_coordinate first_erase = seg::successor(begin(), firste);
-	segmented_coordinate last_erase = seg::successor(first_erase, erase_nm);
+	static std::vector<value_type> v;
 
-	header_iterator _first_erase = seg::segment(first_erase).h;
-	size_t _first_i = seg::flat(first_erase) - seg::begin(*_first_erase);
-	header_iterator _last_erase;
-	size_t _last_i;
+	void TearDownSeg() override {
+		v.clear();
+	}
 
-	if (last_erase == end() && begin() != end()) {
-		_last_erase = --seg::segment(last_erase).h;
-		_last_i = seg::size(*_last_erase);
+	// Batch of "n" elements in [lo, lo + range), in no particular order
+	std::vector<value_type> Batch(size_t n, int lo, int range) {
+		std::vector<value_type> b;
+		for (size_t i = 0; i < n; ++i) {
+			value_type x = value_type(lo + static_cast<int>(rand(static_cast<size_t>(range))));
+			b.push_back(x);
+			v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+		}
+		return b;
 	}
-	else {
-		_last_erase = seg::segment(last_erase).h;
-		_last_i = seg::flat(last_erase) - seg::begin(*_last_erase);
+
+	template<typename S>
+	void CheckSet(const S& set) {
+		ASSERT_EQ(set.size(), v.size()) <<
+			"Size of the set is not correct";
+		auto it = set.cbegin();
+		for (size_t i = 0; i < v.size(); ++i) {
+			ASSERT_TRUE(!(*it < v[i]) && !(v[i] < *it)) <<
+				"Elements are not inserted in the right order";
+			it = seg::successor(it, 1);
+		}
+		for (int k = -1; k <= 1001; k += 7) {
+			value_type x = value_type(k);
+			ASSERT_EQ(seg::distance(set.begin(), set.lower_bound(x)), std::lower_bound(v.begin(), v.end(), x) - v.begin()) <<
+				"Lower bound is not in the right position";
+		}
 	}
-	auto [_it, _i, _s] = seg::erase_from_segment_range(in, _first_erase, _first_i, _last_erase, _last_i);
-	TestRangeErasedCorrectly(std::make_pair(_it, _i), firste, size - laste);
+
+	template<typename S>
+	void InsertRand() {
+		S set;
+		for (int i = 0; i < 30; ++i) {
+			// Batches are either spread over all the elements or clustered in a narrow range
+			int range = rand(2) ? 1000 : 20;
+			int lo = static_cast<int>(rand(static_cast<size_t>(1001 - range)));
+			std::vector<value_type> b = Batch(rand(500), lo, range);
+			set.insert_batch(b.begin(), b.size());
+			CheckSet(set);
+		}
+	}
+};
+
+std::vector<value_type> TestBatchInsert::v;
+
+TEST_F(TestBatchInsert, Insert) {
+	InsertRand<batch_multiset>();
 }
 
+TEST_F(TestBatchInsert, Fenced) {
+	InsertRand<batch_fenced_multiset>();
+}
 
-#endif // INTERNAL_SEGMENTED_ERASE_TEST
+TEST_F(TestBatchInsert, Stable) {
+	// Elements with equal keys keep their order, and go after the ones already there
+	batch_multimap map;
+	int order = 0;
+	for (int i = 0; i < 10; ++i) {
+		std::vector<batch_pair> b;
+		for (size_t j = rand(300); j; --j) b.push_back(batch_pair(static_cast<int>(rand(200)) - 100, order++));
+		map.insert_batch(b.begin(), b.size());
+	}
+	ASSERT_EQ(map.size(), static_cast<size_t>(order)) <<
+		"Size of the map is not correct";
+	auto it = map.cbegin();
+	auto next = seg::successor(it, 1);
+	for (size_t i = 1; i < map.size(); ++i) {
+		ASSERT_TRUE(it->first < next->first || (it->first == next->first && it->second < next->second)) <<
+			"Elements with equal keys are not in the order of their insertion";
+		it = next;
+		next = seg::successor(next, 1);
+	}
+}
 
+TEST_F(TestBatchInsert, RadixSort) {
+	std::vector<std::int64_t> a;
+	for (int i = 0; i < 5000; ++i) a.push_back(static_cast<std::int64_t>(rand(1 << 20)) * (rand(2) ? -977 : 1013));
+	a.push_back(std::numeric_limits<std::int64_t>::min());
+	a.push_back(std::numeric_limits<std::int64_t>::max());
+	std::vector<std::int64_t> e(a);
+	std::sort(e.begin(), e.end());
+	std::vector<std::int64_t> buffer(a.size());
+	flat::radix_sort(a.data(), a.data() + a.size(), buffer.data(), [](std::int64_t x) { return flat::radix_key(x); });
+	ASSERT_TRUE(a == e) <<
+		"Radix sort doesn't sort signed keys";
+}
 
-#ifdef INTERNAL_SEARCH_TEST
+#endif // INTERNAL_BATCH_INSERT_TEST
+
+#ifdef INTERNAL_APPLY_BATCH_TEST
+
+using apply_multiset = seg::multiset_tmp<
+	value_type,
+	std::less<value_type>,
+	segmented_list,
+	flat::find_adaptor_binary,
+	flat::equal_range_adaptor_binary>;
+
+using apply_fenced_multiset = seg::multiset_tmp<
+	value_type,
+	std::less<value_type>,
+	seg::list_tmp<value_type, fenced_index<index, seg::set_value_to_key>>,
+	flat::find_adaptor_binary,
+	flat::equal_range_adaptor_binary>;
+
+using apply_pair = std::pair<int, int>;
+using apply_multimap = seg::multimap_tmp<
+	int,
+	int,
+	std::less<int>,
+	seg::list_tmp<apply_pair, seg::big_header_index<apply_pair, 16, std::allocator<apply_pair>>>,
+	flat::find_adaptor_binary,
+	flat::equal_range_adaptor_binary>;
+
+// Mapped type which can't be default constructed
+struct apply_mapped
+{
+	int x;
+	explicit apply_mapped(int x) : x(x) {}
+};
 
-struct TestSegmentContainerSearch : public InternalTestBase
+using apply_mapped_pair = std::pair<int, apply_mapped>;
+using apply_mapped_multimap = seg::multimap_tmp<
+	int,
+	apply_mapped,
+	std::less<int>,
+	seg::list_tmp<apply_mapped_pair, seg::big_header_index<apply_mapped_pair, 16, std::allocator<apply_mapped_pair>>>,
+	flat::find_adaptor_binary,
+	flat::equal_range_adaptor_binary>;
+
+struct TestApplyBatch : public InternalTestBase
 {
-	static multiset set;
+	static std::vector<value_type> v;
+	static std::vector<apply_pair> w;
 
-	void SetUpSeg() override {
+	void TearDownSeg() override {
+		v.clear();
+		w.clear();
 	}
 
-	void TearDownSeg() override {
-		set.clear();
+	// Sorted batch of "n" operations with keys in [lo, lo + range), half of them insertions; it's also applied to "r",
+	// one operation at a time. Elements are made by "make", and their keys are taken by "key".
+	template<typename S, typename T, typename M, typename K>
+	std::vector<typename S::operation> Batch(size_t n, int lo, int range, std::vector<T>& r, M make, K key) {
+		using operation = typename S::operation;
+		std::vector<operation> b;
+		for (size_t i = 0; i < n; ++i) {
+			int k = lo + static_cast<int>(rand(static_cast<size_t>(range)));
+			size_t kind = rand(4);
+			if (kind < 2) b.push_back(operation::insert(make(k)));
+			else if (kind == 2) b.push_back(operation::erase(key(make(k))));
+			else b.push_back(operation::erase_range(key(make(k)), key(make(k + static_cast<int>(rand(10))))));
+		}
+		std::stable_sort(b.begin(), b.end(), [](const operation& x, const operation& y) { return x.first() < y.first(); });
+		auto lower = [&](const auto& k) {
+			return std::partition_point(r.begin(), r.end(), [&](const T& y) { return key(y) < k; });
+		};
+		auto upper = [&](const auto& k) {
+			return std::partition_point(r.begin(), r.end(), [&](const T& y) { return !(k < key(y)); });
+		};
+		for (const operation& op : b) {
+			if (op.kind() == operation::insert_value) r.insert(upper(op.first()), op.value());
+			else if (op.kind() == operation::erase_key) r.erase(lower(op.first()), upper(op.first()));
+			else if (op.first() < op.last()) r.erase(lower(op.first()), lower(op.last()));
+		}
+		return b;
 	}
 
-	void InitRand(size_t nm_segments) {
-		index in;
-		in.insert(in.begin(), static_cast<SizeType<index>>(nm_segments));
-		size_t s = create_rand_range(in.begin(), nm_segments);
-		set.swap(in, s);
+	template<typename S>
+	void CheckSet(const S& set) {
+		ASSERT_EQ(set.size(), v.size()) <<
+			"Size of the set is not correct";
+		auto it = set.cbegin();
+		for (size_t i = 0; i < v.size(); ++i) {
+			ASSERT_TRUE(!(*it < v[i]) && !(v[i] < *it)) <<
+				"Operations are not applied in the right order";
+			it = seg::successor(it, 1);
+		}
+		for (int k = -1; k <= 1001; k += 7) {
+			value_type x = value_type(k);
+			ASSERT_EQ(seg::distance(set.begin(), set.lower_bound(x)), std::lower_bound(v.begin(), v.end(), x) - v.begin()) <<
+				"Lower bound is not in the right position";
+		}
+	}
+
+	template<typename S>
+	void ApplyRand() {
+		S set;
+		for (int i = 0; i < 40; ++i) {
+			// Batches are either spread over all the elements or clustered in a narrow range
+			int range = rand(2) ? 1000 : 20;
+			int lo = static_cast<int>(rand(static_cast<size_t>(1001 - range)));
+			std::vector<typename S::operation> b = Batch<S>(rand(600), lo, range, v,
+				[](int k) { return value_type(k); }, [](const value_type& x) { return x; });
+			set.apply_batch(b.begin(), b.size());
+			CheckSet(set);
+		}
 	}
 };
 
-multiset TestSegmentContainerSearch::set;
+std::vector<value_type> TestApplyBatch::v;
+std::vector<apply_pair> TestApplyBatch::w;
 
-TEST_F(TestSegmentContainerSearch, LowerBound)
-{
-	InitRand(rand(10));
-	int size = static_cast<int>(set.size());
-	segmented_coordinate end = set.end();
-	for (int i = 0; i < size; ++i) {
-		segmented_coordinate c = set.lower_bound(value_type(i));
-		ASSERT_NE(c, end) << 
-			"LowerBound was not found";
-		ASSERT_GE(*c, value_type(i)) <<
-			"Lesser element than LowerBound was found";
-		ASSERT_EQ(*c, value_type(i)) <<
-			"Greater element than LowerBound was found";
-	}
+TEST_F(TestApplyBatch, Apply) {
+	ApplyRand<apply_multiset>();
 }
 
-TEST_F(TestSegmentContainerSearch, UpperBound)
-{
-	InitRand(10);
-	int size = static_cast<int>(set.size());
-	segmented_coordinate end = set.end();
-	for (int i = 0; i < size; ++i) {
-		segmented_coordinate c = set.upper_bound(value_type(i));
-		if (i != size - 1) {
-			ASSERT_NE(c, end) <<
-				"UpperBound was not found";
-			ASSERT_GE(*c, value_type(i + 1)) <<
-				"Lesser element than UpperBound was found";
-			ASSERT_EQ(*c, value_type(i + 1)) <<
-				"Greater element than UpperBound was found";
-		}
-		else {
-			ASSERT_EQ(c, end) <<
-				"UpperBound was not found";
+TEST_F(TestApplyBatch, Fenced) {
+	ApplyRand<apply_fenced_multiset>();
+}
+
+TEST_F(TestApplyBatch, Ordered) {
+	// Operations on equal keys take effect in their order in the batch
+	apply_multimap map;
+	int order = 0;
+	for (int i = 0; i < 20; ++i) {
+		std::vector<apply_multimap::operation> b = Batch<apply_multimap>(rand(400), -100, 200, w,
+			[&](int k) { return apply_pair(k, order++); }, [](const apply_pair& x) { return x.first; });
+		map.apply_batch(b.begin(), b.size());
+		ASSERT_EQ(map.size(), w.size()) <<
+			"Size of the map is not correct";
+		auto it = map.cbegin();
+		for (size_t j = 0; j < w.size(); ++j) {
+			ASSERT_TRUE(*it == w[j]) <<
+				"Operations on equal keys are not applied in their order";
+			it = seg::successor(it, 1);
 		}
 	}
 }
 
-TEST_F(TestSegmentContainerSearch, EqualRange)
+TEST_F(TestApplyBatch, NoDefaultMapped) {
+	using operation = apply_mapped_multimap::operation;
+	apply_mapped_multimap map;
+	std::vector<operation> b;
+	for (int k = 0; k < 100; ++k) b.push_back(operation::insert(apply_mapped_pair(k, apply_mapped(k))));
+	map.apply_batch(b.begin(), b.size());
+	b = { operation::erase_range(10, 20), operation::erase(50), operation::insert(apply_mapped_pair(50, apply_mapped(-1))) };
+	map.apply_batch(b.begin(), b.size());
+	ASSERT_EQ(map.size(), size_t(90)) <<
+		"Size of the map is not correct";
+	auto it = map.cbegin();
+	for (int k = 0; k < 100; ++k) {
+		if (10 <= k && k < 20) continue;
+		ASSERT_TRUE(it->first == k && it->second.x == (k == 50 ? -1 : k)) <<
+			"Operations are not applied to the map";
+		it = seg::successor(it, 1);
+	}
+}
+
+#endif // INTERNAL_APPLY_BATCH_TEST
+
+#ifdef INTERNAL_BUFFERED_SET_TEST
+
+using buffered_multiset = seg::buffered_container_tmp<seg::multiset_tmp<
+	value_type,
+	std::less<value_type>,
+	segmented_list,
+	flat::find_adaptor_binary,
+	flat::equal_range_adaptor_binary>>;
+
+using buffered_fenced_multiset = seg::buffered_container_tmp<seg::multiset_tmp<
+	value_type,
+	std::less<value_type>,
+	seg::list_tmp<value_type, fenced_index<index, seg::set_value_to_key>>,
+	flat::find_adaptor_binary,
+	flat::equal_range_adaptor_binary>>;
+
+struct TestBufferedSet : public InternalTestBase
 {
-	InitRand(10);
-	int size = static_cast<int>(set.size());
-	segmented_coordinate end = set.end();
-	for (int i = 0; i < size; ++i) {
-		auto [lb, ub] = set.equal_range(value_type(i));
-		ASSERT_NE(lb, end) <<
-			"LowerBound was not found";
-		ASSERT_GE(*lb, value_type(i)) <<
-			"Lesser element than LowerBound was found";
-		ASSERT_EQ(*lb, value_type(i)) <<
-			"Greater element than LowerBound was found";
+	static std::vector<value_type> v;
 
-		if (i != size - 1) {
-			ASSERT_GE(*ub, value_type(i + 1)) <<
-				"Lesser element than UpperBound was found";
-			ASSERT_EQ(*ub, value_type(i + 1)) <<
-				"Greater element than UpperBound was found";
+	void TearDownSeg() override {
+		v.clear();
+	}
+
+	template<typename S>
+	void CheckSet(const S& set) {
+		ASSERT_EQ(set.size(), v.size()) <<
+			"Size of the set is not correct";
+		ASSERT_LT(set.buffered(), set.buffer_threshold()) <<
+			"Buffer is not merged once it's full";
+		auto it = set.begin();
+		for (size_t i = 0; i < v.size(); ++i) {
+			ASSERT_TRUE(!(*it < v[i]) && !(v[i] < *it)) <<
+				"Merged view of the buffer and the set is not in the right order";
+			++it;
 		}
-		else {
-			ASSERT_EQ(ub, end) <<
-				"UpperBound was not found";
+		ASSERT_TRUE(it == set.end()) <<
+			"Merged view of the buffer and the set doesn't end with the elements";
+		for (int k = -1; k <= 1001; k += 7) {
+			value_type x = value_type(k);
+			auto lb = std::lower_bound(v.begin(), v.end(), x);
+			auto ub = std::upper_bound(v.begin(), v.end(), x);
+			ASSERT_EQ(std::distance(set.begin(), set.lower_bound(x)), lb - v.begin()) <<
+				"Lower bound is not in the right position";
+			ASSERT_EQ(std::distance(set.begin(), set.upper_bound(x)), ub - v.begin()) <<
+				"Upper bound is not in the right position";
+			ASSERT_EQ(static_cast<std::ptrdiff_t>(set.count(x)), ub - lb) <<
+				"Count of the elements is not correct";
+		}
+	}
+
+	template<typename S>
+	void InsertRand(S& set, size_t n) {
+		for (size_t i = 0; i < n; ++i) {
+			value_type x = value_type(static_cast<int>(rand(1001)));
+			set.insert(x);
+			v.insert(std::upper_bound(v.begin(), v.end(), x), x);
+		}
+	}
+
+	template<typename S>
+	void InsertEraseRand() {
+		// Small buffers are merged run by run into large sets, and large ones linearly
+		for (size_t threshold : { 1, 3, 50, 700 }) {
+			S set(threshold);
+			for (int i = 0; i < 6; ++i) {
+				InsertRand(set, rand(3000));
+				CheckSet(set);
+				for (size_t j = rand(40); j; --j) {
+					value_type x = value_type(static_cast<int>(rand(1001)));
+					auto [lb, ub] = std::equal_range(v.begin(), v.end(), x);
+					ASSERT_EQ(static_cast<std::ptrdiff_t>(set.erase(x)), ub - lb) <<
+						"Number of the erased elements is not correct";
+					v.erase(lb, ub);
+				}
+				CheckSet(set);
+			}
+			v.clear();
 		}
 	}
+};
+
+std::vector<value_type> TestBufferedSet::v;
+
+TEST_F(TestBufferedSet, InsertErase) {
+	InsertEraseRand<buffered_multiset>();
 }
 
-#endif
+TEST_F(TestBufferedSet, Fenced) {
+	InsertEraseRand<buffered_fenced_multiset>();
+}
+
+TEST_F(TestBufferedSet, Flush) {
+	buffered_multiset set(1000);
+	InsertRand(set, 500);
+	ASSERT_EQ(set.buffered(), 500u) <<
+		"Elements are merged before the buffer is full";
+	set.flush();
+	ASSERT_EQ(set.buffered(), 0u) <<
+		"Buffer is not empty after it's merged";
+	ASSERT_EQ(set.base().size(), 500u) <<
+		"Merged elements are not in the set";
+	CheckSet(set);
+}
+
+#endif // INTERNAL_BUFFERED_SET_TEST
 
 #ifdef EXTERNAL_COMPLETE_TEST
 